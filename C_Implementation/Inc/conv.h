@@ -4,9 +4,49 @@
 
 #include <stdlib.h>
 #include <malloc.h>
+#include <string.h>
+#include "workspace.h"
+#include "simd.h"
+
+// Largest filter with a specialized kernel in convPlane, larger (odd) filters take the generic border path everywhere
+#define MAX_FILTER_SIZE 7
+
+// How the channels of a multi-channel result are stored
+enum ChannelLayout
+{
+	LAYOUT_PLANAR,		// [R... G... B...]
+	LAYOUT_INTERLEAVED	// [RGB RGB ...]
+};
 
 void padMatrix(float* input, float* pad_mat, const int input_num_row, const int input_num_col, const int filter_size);
-void convHelper(float* input, float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size);
+// Interior columns [first, last) of one output row of a 3 x 3 convolution, "rows" points at the three input rows of the window
+typedef void (*ConvRow3Kernel)(const float* const rows[3], const float* filter, float* output, const int first, const int last);
+
+void convPlane(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size);
+void convPlaneSimd(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size,
+    const enum SimdLevel level);
+float convPlaneAbsMax(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size);
+void convHelper(float* input, float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size, struct Workspace* ws);
+void convSeparable(const float* input, const float* row_filter, const float* col_filter, float* output, const int input_num_row, const int input_num_col,
+    const int filter_size, struct Workspace* ws);
+void convSeparableChannels(const float* input, const int num_channels, const size_t plane_stride, const int row_stride, const float* row_filter,
+    const float* col_filter, float* output, const enum ChannelLayout layout, const int input_num_row, const int input_num_col, const int filter_size,
+    struct Workspace* ws);
 float* conv2D(float* input, float* filter, const int input_num_row, const int input_num_col, const int filter_size);
 
+// 3 x 3 row kernels (SIMD ones in convsimd.c) and the benchmark comparing them
+void convRow3Scalar(const float* const rows[3], const float* filter, float* output, const int first, const int last);
+#if SIMD_X86
+void convRow3SSE2(const float* const rows[3], const float* filter, float* output, const int first, const int last);
+void convRow3AVX2(const float* const rows[3], const float* filter, float* output, const int first, const int last);
+void convRow3AVX512(const float* const rows[3], const float* filter, float* output, const int first, const int last);
+#endif
+ConvRow3Kernel getConvRow3Kernel(const enum SimdLevel level);
+int runConvBenchmark(void);
+
+// Fixed point versions for 16 bit planes
+void padMatrixFixed(const uint16_t* input, uint16_t* pad_mat, const int input_num_row, const int input_num_col, const int filter_size);
+void convHelperFixed(const uint16_t* input, const int16_t* filter, uint16_t* output, const int input_num_row, const int input_num_col, const int filter_size,
+    const int shift, const int absolute, struct Workspace* ws);
+
 #endif // !CONV_H
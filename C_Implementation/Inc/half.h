@@ -0,0 +1,26 @@
+#pragma once
+#ifndef HALF_H
+#define HALF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// IEEE 754 binary16, weight maps are between [0,3] so 11 significant bits (about 3 decimal digits) are plenty
+typedef uint16_t half;
+
+// Values converted at a time when half planes are mixed with float arithmetic (floats kept on the stack)
+#define HALF_BLOCK 1024
+
+// Scalar Conversion
+half floatToHalf(const float value);
+float halfToFloat(const half value);
+
+// Plane Conversion (F16C when the CPU has it, scalar otherwise)
+void packHalf(const float* input, half* output, const size_t num_values);
+void unpackHalf(const half* input, float* output, const size_t num_values);
+int hasF16C(void);
+
+// Plane Arithmetic
+void addHalf(half* total, const float* values, const size_t num_values);
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <string.h>
+#include <stdio.h>
+#include "parallel.h"
+
+// Largest histogram that can be built, per channel and in channels
+#define MAX_HISTOGRAM_BINS 2048
+#define MAX_HISTOGRAM_CHANNELS 3
+
+// Pixels read from each channel at a time, so all the channels of a block are counted while it is in cache
+#define HISTOGRAM_BLOCK 1024
+
+// Smallest number of pixels counted on several threads
+#define MIN_PARALLEL_HISTOGRAM (1 << 16)
+
+// Writes the values of one channel of the pixels [first, first + count) to be counted, for histograms of something
+// computed from the planes (see calcMaskHistogram). NULL counts the planes of the image as they are.
+typedef void (*HistogramSource)(const float* image, const int num_pixels, const int channel, const int first, const int count, float* values);
+
+// Histograms of up to MAX_HISTOGRAM_CHANNELS planes, a value v goes to bin (int)(v * scale) % num_bins
+struct Histogram
+{
+	int num_bins;
+	int num_channels;
+	float scale;
+	int counts[MAX_HISTOGRAM_CHANNELS][MAX_HISTOGRAM_BINS];
+	int cumulative[MAX_HISTOGRAM_CHANNELS][MAX_HISTOGRAM_BINS];	// Number of values in bins [0, b], for percentile queries
+};
+
+struct histogram_args
+{
+	const float* image;
+	int num_pixels;
+	int first;
+	int last;
+	const struct Histogram* hist;	// Bin layout
+	HistogramSource source;
+	int* bins;						// Counters private to the thread, num_channels rows of "stride" entries
+	int stride;
+};
+
+// Histogram Building
+void initHistogram(struct Histogram* hist, const int num_bins, const int num_channels, const float scale);
+void buildHistogram(struct Histogram* hist, const float* image, const int num_pixels, const int first, const int last, HistogramSource source);
+void* histogramWorker(void* vargs);
+void mergeHistograms(int* bins, const int num_copies, const int copy_size);
+
+// Percentile Queries
+int findHistogramBin(const struct Histogram* hist, const int channel, const float count);
+
+#endif
@@ -1,29 +1,49 @@
-#pragma once
-#ifndef HSI_H
-#define HSI_H
-
-#include "imfunc.h"
-
-struct rgbPacket
-{
-    int max_rgb;
-    int max_color;
-};
-
-// Main Conversion Functions
-float* rgb2hsi(float* rgb_image, const int num_pixels);
-float* hsi2rgb(float* hsi, const int num_pixels);
-
-// Conversion of Individual Components
-void calcHue(float* rgb, float* hsi, const int num_pixels);
-void calcSaturation(float* rgb, float* hsi, const int num_pixels);
-void calcIntensity(float* rgb, float* hsi, const int num_pixels);
-
-// Helper Functions
-float getRGBAverage(const float red, const float green, const float blue);
-float getRGBMin(const float red, const float green, const float blue);
-
-void permuteColors(const float hue, const float primary, const float secondary, const float tertiary, float* red, float* green, float* blue);
-struct rgbPacket getRGBMaxIndex(const float red, const float green, const float blue);
-
+#pragma once
+#ifndef HSI_H
+#define HSI_H
+
+#include "imfunc.h"
+#include "parallel.h"
+#include "simd.h"
+
+// Smallest image converted with more than one thread
+#define MIN_PARALLEL_HSI (1 << 16)
+
+struct rgbPacket
+{
+    int max_rgb;
+    int max_color;
+};
+
+// Pixels [first, last) of a planar image for rgb2hsiWorker and hsi2rgbWorker
+struct hsi_args
+{
+    const float* input;
+    float* output;
+    int num_pixels;
+    int first;
+    int last;
+};
+
+// Main Conversion Functions
+float* rgb2hsi(float* rgb_image, const int num_pixels);
+float* hsi2rgb(float* hsi, const int num_pixels);
+void rgb2hsiRef(float* rgb_image, float* hsi, const int num_pixels);
+void hsi2rgbRef(float* hsi, float* rgb, const int num_pixels);
+void* rgb2hsiWorker(void* vargs);
+void* hsi2rgbWorker(void* vargs);
+
+// Conversion of Individual Components
+void calcHue(float* rgb, float* hsi, const int num_pixels);
+void calcSaturation(float* rgb, float* hsi, const int num_pixels);
+void calcIntensity(float* rgb, float* hsi, const int num_pixels);
+
+// Helper Functions
+float getRGBAverage(const float red, const float green, const float blue);
+float getRGBMin(const float red, const float green, const float blue);
+float getHSIIntensity(const float red, const float green, const float blue);
+
+void permuteColors(const float hue, const float primary, const float secondary, const float tertiary, float* red, float* green, float* blue);
+struct rgbPacket getRGBMaxIndex(const float red, const float green, const float blue);
+
 #endif
\ No newline at end of file
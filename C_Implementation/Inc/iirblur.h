@@ -0,0 +1,31 @@
+#pragma once
+#ifndef IIRBLUR_H
+#define IIRBLUR_H
+
+#include <math.h>
+#include "workspace.h"
+
+// Smallest sigma the recursive coefficients are defined for, smaller ones are raised to it
+#define MIN_RECURSIVE_SIGMA 0.5f
+
+// Zeros run past the end of each row / column, the impulse response is below 1e-4 of its peak after 4 sigma
+#define RECURSIVE_MARGIN(sigma) ((int)ceil(4.0 * (sigma)) + 3)
+
+// Coefficients of the third order recursive Gaussian of Young and van Vliet (1995), normalized by b0:
+// w[n] = B * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3], run forward and then backward
+struct RecursiveGaussian
+{
+	float B;
+	float a1;
+	float a2;
+	float a3;
+	int margin;		// See RECURSIVE_MARGIN, so the backward pass starts from a settled state
+};
+
+// Recursive Gaussian
+void calcRecursiveGaussian(const float sigma, struct RecursiveGaussian* coef);
+void applyRecursiveGaussianRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma,
+	struct Workspace* ws);
+int runBlurBenchmark(void);
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef IMBATCH_H
+#define IMBATCH_H
+
+#include "imfusion.h"
+#include "imtext.h"
+#include "parallel.h"
+
+// Number of images that may wait between two stages
+#define QUEUE_CAPACITY 2
+
+// Default memory budget for images in flight (MB)
+#define DEFAULT_MEMORY_BUDGET 2048
+
+struct BatchOptions
+{
+	const char* input;				// Directory, or "@" followed by a file with one image path per line
+	const char* output_dir;			// Directory for the corrected images
+	const char* output_format;		// Output extension without the dot ("txt", "uwi", "ppm", "pgm"), NULL keeps the input format
+	enum TextFormat text_format;	// Format of text bitmap output
+	size_t memory_budget;			// Bytes that images in flight may use
+	int num_workers;				// Maximum number of images enhanced at once
+};
+
+struct BatchJob
+{
+	char input[FILENAME_MAX];
+	char output[FILENAME_MAX];
+	struct Image image;
+	float* result;
+	size_t reserved_bytes;
+	double start_time;
+	double latency;
+	int status;
+};
+
+struct JobQueue
+{
+	struct BatchJob* items[QUEUE_CAPACITY];
+	int head;
+	int count;
+	int closed;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+struct MemoryBudget
+{
+	size_t available;
+	size_t in_use;
+	pthread_mutex_t lock;
+	pthread_cond_t released;
+};
+
+struct batch_args
+{
+	struct BatchOptions* options;
+	struct BatchJob* jobs;
+	int num_jobs;
+	struct JobQueue* compute_queue;
+	struct JobQueue* write_queue;
+	struct MemoryBudget* budget;
+	int* active_workers;
+	pthread_mutex_t* worker_lock;
+	int worker_threads;				// Threads each worker may use per stage (see setThreadLimit)
+};
+
+// Batch Processing
+int runBatch(struct BatchOptions* options);
+int listBatchInputs(const char input[], char*** file_names);
+int isImageFile(const char file_name[]);
+void buildOutputName(const char input[], struct BatchOptions* options, char output[], const size_t output_size);
+
+// Pipeline Stages
+void* batchReader(void* vargs);
+void* batchWorker(void* vargs);
+void* batchWriter(void* vargs);
+
+// Bounded Queue
+void initQueue(struct JobQueue* queue);
+void destroyQueue(struct JobQueue* queue);
+void pushQueue(struct JobQueue* queue, struct BatchJob* job);
+struct BatchJob* popQueue(struct JobQueue* queue);
+void closeQueue(struct JobQueue* queue);
+
+// Memory Budget
+void reserveMemory(struct MemoryBudget* budget, const size_t bytes);
+void releaseMemory(struct MemoryBudget* budget, const size_t bytes);
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef IMBINARY_H
+#define IMBINARY_H
+
+#include "imfunc.h"
+
+// Binary image container (.uwi)
+// The header is followed by num_channels planes of num_row x row_stride samples
+#define UWI_MAGIC "UWI1"
+#define UWI_VERSION 1
+#define UWI_BYTE_ORDER 0x01020304
+#define UWI_HEADER_SIZE 64
+#define UWI_EXTENSION ".uwi"
+
+enum SampleType
+{
+	SAMPLE_UINT8 = 1,
+	SAMPLE_UINT16 = 2,
+	SAMPLE_FLOAT32 = 4
+};
+
+// On disk header, always UWI_HEADER_SIZE bytes
+struct BinaryHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t num_row;
+	uint32_t num_col;
+	uint32_t num_channels;
+	uint32_t sample_type;
+	uint32_t row_stride;
+	uint64_t plane_stride;
+	uint64_t data_offset;
+	uint8_t reserved[16];
+};
+
+// Binary Image Reading and writing
+struct Image readImageBinary(const char file_name[]);
+int writeImageBinary(const char file_name[], float* image, const int num_row, const int num_col, const enum SampleType sample_type);
+
+// Helper Functions
+int checkBinaryHeader(const struct BinaryHeader* header, const size_t file_size);
+int isBinaryImageFile(const char file_name[]);
+size_t sampleSize(const uint32_t sample_type);
+void initBinaryHeader(struct BinaryHeader* header, const int num_row, const int num_col, const enum SampleType sample_type);
+void convertBinaryRow(const uint8_t* src, float* dst, const int num_col, const uint32_t sample_type);
+void* mapImageFile(const char file_location[], size_t* mapping_size);
+void unmapImageFile(void* mapping, const size_t mapping_size);
+
+#endif
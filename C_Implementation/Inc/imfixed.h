@@ -0,0 +1,42 @@
+#pragma once
+#ifndef IMFIXED_H
+#define IMFIXED_H
+
+#include "imfusion.h"
+#include "parallel.h"
+
+// Fixed point formats, a value x is stored as round(x * 2^shift) in a uint16_t
+#define Q15_SHIFT 15	// Images, 1.0 = 32768 so white balance may overshoot up to 2.0
+#define Q14_SHIFT 14	// Combined weights, the sum of three normalized weights is at most 3.0
+#define Q12_SHIFT 12	// Laplacian magnitude, at most 8 * 2.0 = 16.0
+#define LAB_SHIFT 7		// LAB planes and saliency distances (int16_t / uint16_t), all well below 256
+#define Q15_ONE (1 << Q15_SHIFT)
+
+// Pixels converted to floats at a time for the nonlinear color conversions
+#define FIXED_BLOCK_PIXELS 1024
+
+// Peak number of full frame planes (sized for floats) taken from the workspace by enhanceImageFixedRef,
+// plus the two gamma tables. The 16 bit planes take half a plane each.
+#define FIXED_WORKSPACE_PLANES 8
+
+// Fixed point enhancement
+float* enhanceImageFixed(float* image, const int num_row, const int num_col);
+void enhanceImageFixedRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws);
+size_t calcFixedWorkspace(const int num_row, const int num_col);
+int runFixed(const char input_name[], const char output_name[], const int report);
+
+// Fixed point stages
+void getWeightsFixed(uint16_t* image, uint16_t* weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws);
+void calcLuminanceFixed(uint16_t* image, uint16_t* lum, const int num_pixels, const int lum_option);
+void calcSaliencyWeightFixed(uint16_t* image, uint16_t* sal_weight, const int num_row, const int num_col, struct Workspace* ws);
+void calcSaturationWeightFixed(uint16_t* image, uint16_t* lum, uint16_t* sat_weight, const int num_pixels);
+void normalizeWeightFixed(uint16_t* weight, const int num_pixels);
+void applyUnsharpMaskFixed(uint16_t* image, uint16_t* sharp, const int num_row, const int num_col, struct Workspace* ws);
+void applyFusionFixed(uint16_t* white_image, uint16_t* gamma_weight, uint16_t* sharp_weight, float* corrected, const int num_pixels, struct Workspace* ws);
+
+// Helper Functions
+void quantizeQ15(const float* image, uint16_t* fixed, const int num_samples);
+void dequantizeQ15(const uint16_t* fixed, float* image, const int num_samples);
+double calcPSNR(const float* reference, const float* image, const size_t num_samples, const int levels);
+
+#endif
@@ -10,12 +10,40 @@
 #define READ_THREADS 3
 #define NUM_CHANNELS 3
 
+// Gaussian blur of the unsharp mask and saliency weight (see applyGaussianBlurSeparableRef).
+// The support is 2 * radius + 1 taps, about 3 * sigma is enough for the tails.
+#ifndef GAUSSIAN_SIGMA
+#define GAUSSIAN_SIGMA 0.5f
+#endif
+#ifndef GAUSSIAN_RADIUS
+#define GAUSSIAN_RADIUS 1
+#endif
+#define MAX_GAUSSIAN_RADIUS 64
+
+// Blur of the unsharp mask and of the saliency weight. BLUR_DIRECT convolves with 2 * GAUSSIAN_RADIUS + 1 taps,
+// BLUR_RECURSIVE and BLUR_BOX approximate the Gaussian with a cost that does not depend on GAUSSIAN_SIGMA,
+// with a recursive filter (see iirblur.h) or a stack of box blurs (see integral.h)
+#define BLUR_DIRECT 0
+#define BLUR_RECURSIVE 1
+#define BLUR_BOX 2
+#ifndef UNSHARP_BLUR
+#define UNSHARP_BLUR BLUR_DIRECT
+#endif
+#ifndef SALIENCY_BLUR
+#define SALIENCY_BLUR BLUR_DIRECT
+#endif
+
 // Standard includes
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "conv.h"
+#include "iirblur.h"
+#include "integral.h"
+#include "histogram.h"
+#include "transfer.h"
+#include "simdmath.h"
 #include <stdint.h>
 #include <pthread.h>
 
@@ -24,14 +52,20 @@ struct Image
 	int num_row;
 	int num_col;
 	float* rgb_image;
+
+	// Set when rgb_image points into a mapped file rather than malloc'd memory
+	void* mapping;
+	size_t mapping_size;
 };
 
 struct arg_struct {
 	float* output;
-	FILE* image_file;
+	const char* file_location;
 	int check_num_row;
 	int check_num_col;
 	int id;
+	int num_threads;
+	int error;
 };
 
 
@@ -39,16 +73,31 @@ struct arg_struct {
 float Q_rsqrt(float number);
 float calcAverage(float* image, const int num_pixels);
 float* correctGamma(float* image, const int num_pixels, const float gamma);
+void correctGammaRef(float* image, float* gamma_image, const int num_pixels, const float gamma);
 float* applyGaussianBlur(float* image, const int num_row, const int num_col);
-void applyGaussianBlurRef(float* image, float* output, const int num_row, const int num_col);
+void applyGaussianBlurRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws);
+float* applyGaussianBlurSeparable(float* image, const int num_row, const int num_col, const float sigma, const int radius);
+void applyGaussianBlurSeparableRef(float* image, float* output, const int num_row, const int num_col, const float sigma, const int radius, struct Workspace* ws);
+void applyGaussianBlurChannelsRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, const int radius,
+    struct Workspace* ws);
+void applyGaussianBlurModeRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, const int radius,
+    const int blur_mode, struct Workspace* ws);
+int calcGaussianKernel(const float sigma, const int radius, float* kernel);
 float* applyLaplacian(float* image, const int num_row, const int num_col);
+void applyLaplacianRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws);
+float applyLaplacianAbsRef(float* image, float* output, const int num_row, const int num_col);
 float calcNormSquare(const float x1, const float x2, const float y1, const float y2, const float z1, const float z2);
 
 // Image Reading and writing
 struct Image readImage(const char file_name[]);
+struct Image loadImage(const char file_name[]);
+int readImageSize(const char file_name[], int* num_row, int* num_col);
+void freeImage(struct Image* im);
+int saveImage(const char file_name[], float* image, const int num_row, const int num_col);
+FILE* getImageStdout(void);
 int writeImage(const char file_name[], float* image, const int num_row, const int num_col);
 
 struct Image readImageParallel(const char base_file_name[]);
-void readSingleChannel(void* vargs);
+void* readSingleChannel(void* vargs);
 
 #endif
\ No newline at end of file
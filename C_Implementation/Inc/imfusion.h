@@ -5,6 +5,14 @@
 #define REGULARIZATION 0.1
 #define LUM_OPTION 1
 
+// 1 to store the gamma and sharpened weight maps as half floats (see half.h), halving their footprint and bandwidth (strip mode included)
+#ifndef HALF_WEIGHTS
+#define HALF_WEIGHTS 0
+#endif
+
+// Peak number of full frame planes taken from the workspace by enhanceImageRef (reached by the saliency weight of the sharpened image)
+#define FUSION_WORKSPACE_PLANES 19
+
 // Standard includes
 #include <time.h>
 #include "imsharp.h"
@@ -14,10 +22,17 @@
 
 // Fusion Functions
 float* applyFusion(float* white_image, float* gamma_weight, float* sharp_weight, const int num_row, const int num_col);
+void applyFusionRef(float* white_image, float* gamma_weight, float* sharp_weight, float* corrected, const int num_row, const int num_col);
+void applyFusionHalfRef(float* white_image, half* gamma_weight, half* sharp_weight, float* corrected, const int num_row, const int num_col);
 void normalizeFusionWeights(float* gamma_weight, float* sharp_weight, const int num_row, const int num_col);
 
 // Helper function to perform all steps of fusion
-float* imageFusionSeqFull(char filename[]);
+float* imageFusionSeqFull(char filename[], char output_name[]);
+float* enhanceImage(float* image, const int num_row, const int num_col);
+void enhanceImageRef(float* image, float* reconstructed, const int num_row, const int num_col, struct Workspace* ws);
+void enhanceImageHalfRef(float* image, float* reconstructed, const int num_row, const int num_col, struct Workspace* ws);
+size_t calcFusionWorkspace(const int num_row, const int num_col);
+size_t estimateFusionMemory(const int num_row, const int num_col);
 float* imageFusionParFull(char filename[]);
 
 // Combination functions to be performed in paralllel
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef IMNETPBM_H
+#define IMNETPBM_H
+
+#include "imfunc.h"
+
+// Binary Netpbm images: P5 (greyscale PGM) and P6 (colour PPM) with 8 or 16 bit samples
+// The file name "-" reads from stdin / writes to stdout
+#define NETPBM_STDIO "-"
+
+// Number of pixels converted at a time while streaming the payload
+#define NETPBM_BLOCK_PIXELS (1 << 16)
+
+// Netpbm Image Reading and writing
+struct Image readImageNetpbm(const char file_name[]);
+int writeImageNetpbm(const char file_name[], float* image, const int num_row, const int num_col, const int max_val);
+
+struct Image readNetpbmStream(FILE* image_file);
+int writeNetpbmStream(FILE* image_file, float* image, const int num_row, const int num_col, const int max_val, const int greyscale);
+
+// Helper Functions
+int isNetpbmFile(const char file_name[]);
+int readNetpbmHeader(FILE* image_file, int* magic, int* num_row, int* num_col, int* max_val);
+int writeNetpbmHeader(FILE* image_file, const int num_row, const int num_col, const int max_val, const int greyscale);
+void interleavedToPlanar(const uint8_t* samples, float* image, const size_t plane_size, const size_t num_pixels, const int num_channels, const int max_val);
+void planarToInterleaved(float* image, const size_t plane_size, uint8_t* samples, const size_t num_pixels, const int num_channels, const int max_val);
+
+#endif
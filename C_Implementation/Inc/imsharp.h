@@ -4,8 +4,40 @@
 
 #include "imfunc.h"
 #include "hsi.h"
+#include "parallel.h"
+
+// Number of grey levels used by histogram equalization
+#define EQUALIZATION_BINS 256
+
+// Pixels of the mask converted to HSI and back at a time, small enough for the blocks to stay in cache
+#define UNSHARP_BLOCK 1024
+
+// Smallest image blended with more than one thread
+#define MIN_PARALLEL_UNSHARP (1 << 16)
+
+// Pixels [first, last) for unsharpBlendWorker
+struct unsharp_args
+{
+	const float* image;
+	const float* mask;
+	float* sharp;
+	int num_pixels;
+	int first;
+	int last;
+	int* new_grey;
+};
 
 float* applyUnsharpMask(float* image, const int num_row, const int num_col);
+void applyUnsharpMaskRef(float* image, float* sharp, const int num_row, const int num_col, struct Workspace* ws);
+void calcUnsharpMaskRef(float* image, float* mask, const int num_row, const int num_col, struct Workspace* ws);
+void calcMaskHistogram(const float* mask, const int num_pixels, const int first, const int last, int64_t* histogram);
+void blendUnsharpMaskRef(const float* image, const float* mask, float* sharp, const int num_pixels, int* new_grey);
+void* unsharpBlendWorker(void* vargs);
+
+// Histogram Equalization
 void histogramEqualization(float* image, const int num_pixels);
+void calcIntensityHistogram(float* intensity, const int num_pixels, int64_t* histogram);
+void calcEqualizationTable(const int64_t* histogram, const int64_t num_pixels, int* new_grey);
+void applyEqualizationTable(float* intensity, const int num_pixels, int* new_grey);
 
 #endif // ! IMSARP_H
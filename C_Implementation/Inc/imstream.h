@@ -0,0 +1,62 @@
+#pragma once
+#ifndef IMSTREAM_H
+#define IMSTREAM_H
+
+#include "imfusion.h"
+#include "imnetpbm.h"
+#include "parallel.h"
+
+// Frames buffered between each pair of stages (double buffering)
+#define STREAM_SLOTS 2
+
+// Milliseconds the reader waits for input before checking whether the stream was stopped
+#define STREAM_POLL_MS 100
+
+struct StreamOptions
+{
+	int num_row;
+	int num_col;
+	long max_frames;	// Stop after this many frames, 0 for the whole stream
+};
+
+// Hand off between two stages, frame i always uses slot i % STREAM_SLOTS
+struct FrameRing
+{
+	int filled[STREAM_SLOTS];
+	int finished;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
+
+struct stream_args
+{
+	const struct StreamOptions* options;
+	FILE* input;
+	FILE* output;
+	uint8_t* raw_in;
+	float* planar[STREAM_SLOTS];
+	uint8_t* raw_out[STREAM_SLOTS];
+	struct FrameRing* read_ring;
+	struct FrameRing* write_ring;
+	long frames_written;
+	int error;
+};
+
+// Raw RGB24 Streaming
+int runStream(const struct StreamOptions* options);
+
+// Pipeline Stages
+void* streamReader(void* vargs);
+void* streamWriter(void* vargs);
+
+// Frame Hand Off
+void initRing(struct FrameRing* ring);
+void destroyRing(struct FrameRing* ring);
+int acquireEmpty(struct FrameRing* ring, const long frame);
+void publishFrame(struct FrameRing* ring, const long frame);
+int acquireFilled(struct FrameRing* ring, const long frame);
+void releaseFrame(struct FrameRing* ring, const long frame);
+void finishRing(struct FrameRing* ring);
+int isRingFinished(struct FrameRing* ring);
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef IMSTRIP_H
+#define IMSTRIP_H
+
+#include "imfusion.h"
+#include "imbinary.h"
+#include "imnetpbm.h"
+#include "parallel.h"
+#include <limits.h>
+
+// Rows of context read above and below each band (see calcStripHalo)
+#define STRIP_HALO calcStripHalo()
+
+// Most rows of a band whose planes (with the halo) can be indexed with an int
+#define MAX_STRIP_ROWS(num_col) ((long)(INT_MAX / NUM_CHANNELS / (num_col)) - 2 * STRIP_HALO)
+
+// Default memory budget for strip mode (MB)
+#define DEFAULT_STRIP_BUDGET 256
+
+enum StripFormat
+{
+	STRIP_NETPBM,
+	STRIP_BINARY
+};
+
+// The passes over the image, each one needs the statistics of the ones before it
+enum StripPass
+{
+	PASS_CHANNELS,			// Channel averages for white balance
+	PASS_FIRST_STATS,		// Gamma weight maxima and LAB averages, histogram of the unsharp mask intensity
+	PASS_SHARP_STATS,		// Gamma saliency maximum, sharpened weight maxima and LAB averages
+	PASS_SHARP_SALIENCY,	// Sharpened saliency maximum
+	PASS_FUSION,			// Final weights, fusion and output
+	NUM_STRIP_PASSES
+};
+
+// What to compute from the weights of a band
+enum WeightStage
+{
+	WEIGHT_NONE,
+	WEIGHT_FIRST_STATS,		// Laplacian and saturation maxima, LAB sums
+	WEIGHT_SALIENCY_STATS,	// Saliency maximum, needs the LAB averages
+	WEIGHT_APPLY			// Combined normalized weight, needs everything
+};
+
+// Row access to an image file so that only one band of it is in memory at a time
+struct StripFile
+{
+	FILE* file;
+	int is_stdout;
+	enum StripFormat format;
+	int num_row;
+	int num_col;
+	int num_channels;				// Netpbm only: 1 for greyscale or 3 for RGB
+	int max_val;					// Netpbm only: largest sample value
+	struct BinaryHeader header;		// Binary only
+	uint64_t data_offset;
+};
+
+// Global statistics of one of the two weight maps (see getWeightsRef)
+struct WeightStats
+{
+	double lab_sum[NUM_CHANNELS];
+	float lab_avg[NUM_CHANNELS];
+	float max_laplacian;
+	float max_saliency;
+	float max_saturation;
+};
+
+// Global statistics of the whole image, filled in pass by pass
+struct StripStats
+{
+	double channel_sum[NUM_CHANNELS];
+	float channel_avg[NUM_CHANNELS];
+	float transformation[NUM_CHANNELS * NUM_CHANNELS];
+	int64_t histogram[EQUALIZATION_BINS];
+	int new_grey[EQUALIZATION_BINS];
+	struct WeightStats gamma;
+	struct WeightStats sharp;
+};
+
+// Strip Processing
+int enhanceImageStrips(const char input_name[], const char output_name[], const size_t memory_budget);
+int calcStripHalo(void);
+int calcStripRows(const int num_row, const int num_col, const size_t memory_budget);
+int processStrip(struct StripFile* input, struct StripFile* output, struct StripStats* stats, const enum StripPass pass,
+	const int first_row, const int last_row, struct Workspace* ws);
+void processStripWeights(float* image, float* weight, const int num_row, const int num_col, const int offset, const int band_pixels,
+	struct WeightStats* stats, const enum WeightStage stage, const int first_band, struct Workspace* ws);
+
+// Row Access
+int openStripInput(const char file_name[], struct StripFile* input);
+int openStripOutput(const char file_name[], struct StripFile* output, const int num_row, const int num_col);
+int closeStripFile(struct StripFile* strip);
+int readStripRows(struct StripFile* input, const int first_row, const int num_rows, float* image, struct Workspace* ws);
+int writeStripRows(struct StripFile* output, const int first_row, const int num_rows, float* image, const size_t plane_size, struct Workspace* ws);
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef IMTEXT_H
+#define IMTEXT_H
+
+#include "imfunc.h"
+#include "imbinary.h"
+#include "parallel.h"
+
+// Smallest chunk of text worth handing to its own thread
+#define MIN_PARSE_CHUNK (1 << 16)
+
+// Number of samples each thread formats before the chunks are written out
+#define FORMAT_CHUNK_SAMPLES (1 << 18)
+
+// Longest line formatSample can produce ("-999999999999.999999\n")
+#define MAX_SAMPLE_CHARS 24
+
+enum TextFormat
+{
+	TEXT_FLOAT6 = 0,
+	TEXT_UINT8 = 1
+};
+
+struct parse_args
+{
+	const char* start;
+	const char* end;
+	float* output;
+	size_t num_tokens;
+	int error;
+};
+
+struct format_args
+{
+	const float* samples;
+	size_t num_samples;
+	char* buffer;
+	size_t length;
+	enum TextFormat format;
+};
+
+// Fast Text Image Reading
+struct Image readImageText(const char file_name[]);
+const char* parseTextHeader(const char* text, const char* end, int* num_row, int* num_col);
+int parseTextSamples(const char* text, const char* end, float* output, const size_t num_samples, int num_threads);
+
+// Fast Text Image Writing
+int writeImageText(const char file_location[], float* image, const int num_row, const int num_col, const enum TextFormat format);
+
+// Helper Functions
+const char* scanSample(const char* text, const char* end, float* value);
+const char* skipSeparators(const char* text, const char* end);
+void* countTokensWorker(void* vargs);
+void* parseTokensWorker(void* vargs);
+char* formatSample(char* text, const float value, const enum TextFormat format);
+void* formatSamplesWorker(void* vargs);
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include "workspace.h"
+#include "parallel.h"
+
+// Number of box blurs stacked to approximate a Gaussian (3 is within a few percent)
+#define STACKED_BOXES 3
+
+// Smallest table built on several threads
+#define MIN_PARALLEL_INTEGRAL (1 << 20)
+
+// A summed-area table is (num_row + 1) x (num_col + 1) doubles, entry (y, x) is the sum of the pixels in rows [0, y) and columns [0, x).
+// Doubles keep box sums of very large images exact to well below the precision of a float pixel.
+struct integral_args
+{
+	const float* plane;
+	double* table;
+	int num_row;
+	int num_col;
+	int first;		// First row (first phase) or column (second phase) of this thread
+	int last;
+	int squared;
+};
+
+// Summed-Area Tables
+size_t calcIntegralFloats(const int num_row, const int num_col);
+void buildIntegralImage(const float* plane, double* table, const int num_row, const int num_col, const int squared);
+double calcBoxSum(const double* table, const int num_row, const int num_col, const int top, const int left, const int bottom, const int right);
+void* integralRowsWorker(void* vargs);
+void* integralColumnsWorker(void* vargs);
+
+// Box Filters
+void applyBoxBlurRef(float* plane, float* output, const int num_row, const int num_col, const int radius, double* table);
+void applyStackedBoxBlurRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, struct Workspace* ws);
+int calcStackedBoxRadii(const float sigma, int radii[STACKED_BOXES]);
+void calcLocalStatsRef(float* plane, float* mean, float* variance, const int num_row, const int num_col, const int radius, struct Workspace* ws);
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdlib.h>
+#include <pthread.h>
+
+// Upper bound on the number of worker threads used by a single stage
+#define MAX_THREADS 64
+
+// Thread local storage, for the per thread limit of getNumThreads
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Thread Helpers
+int getNumThreads(void);
+void setThreadLimit(const int limit);
+int runParallel(void* (*worker)(void*), void* args, const size_t arg_size, const int num_threads);
+
+// Timing
+double getWallTime(void);
+
+#endif
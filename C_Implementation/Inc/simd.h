@@ -0,0 +1,31 @@
+#pragma once
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// SIMD kernels need GCC / Clang on x86 for the target attribute, everything else uses the scalar code
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+// Instruction sets with dedicated kernels, in increasing order so a level also supports everything below it
+enum SimdLevel
+{
+	SIMD_SCALAR,
+	SIMD_SSE2,		// 4 floats per instruction
+	SIMD_AVX2,		// 8 floats per instruction
+	SIMD_AVX512,	// 16 floats per instruction
+	NUM_SIMD_LEVELS
+};
+
+// CPU Dispatch
+enum SimdLevel getSimdLevel(void);
+enum SimdLevel detectSimdLevel(void);
+const char* getSimdName(const enum SimdLevel level);
+
+#endif
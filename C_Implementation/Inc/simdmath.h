@@ -0,0 +1,36 @@
+#pragma once
+#ifndef SIMDMATH_H
+#define SIMDMATH_H
+
+#include <stdint.h>
+#include "simd.h"
+
+// 1 to use the polynomial pow and cube root below for the gamma corrections and the LAB conversion instead of libm
+// (TRANSFER_TABLES takes precedence where both are set). The square roots are exact and always used.
+#ifndef SIMD_MATH
+#define SIMD_MATH 0
+#endif
+
+// Every function has a scalar version and an AVX2 one computing 8 values with the same operations in the same order,
+// so both give bit identical results. Errors are for normal (not subnormal) inputs, against the correctly rounded result:
+//	fastCbrt		any sign, at most 2 ULP
+//	fastLog2		x > 0, at most 2 ULP for |log2(x)| > 0.5, below 1e-7 absolute closer to x = 1
+//	fastExp2		y in [-126, 128), at most 1 ULP (results below 2^-126 lose precision like any subnormal)
+//	fastPow			x >= 0 (0 gives 0, negatives NaN), at most 1 + |y * log2(x)| / 2 ULP since the error of the logarithm
+//					is scaled by y, so 3 ULP for the gammas of pixels down to 2^-4 and 12 ULP at 2^-20
+//	fastRsqrt		x > 0, at most 2 ULP, extends Q_rsqrt with two more Newton steps
+//	sqrtArray		correctly rounded (the hardware square root)
+float fastCbrt(const float x);
+float fastLog2(const float x);
+float fastExp2(const float y);
+float fastPow(const float x, const float y);
+float fastRsqrt(const float x);
+
+// Arrays, the output may be the same as the input
+void cbrtArray(const float* input, float* output, const int num_values);
+void powArray(const float* input, float* output, const int num_values, const float exponent);
+void rsqrtArray(const float* input, float* output, const int num_values);
+void sqrtArray(const float* input, float* output, const int num_values, const double scale);
+int runMathBenchmark(void);
+
+#endif
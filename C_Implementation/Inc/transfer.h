@@ -0,0 +1,53 @@
+#pragma once
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdint.h>
+#include "simd.h"
+#include "parallel.h"
+
+// 1 to read the gamma, sRGB linearization and LAB function from interpolated tables instead of calling pow for every sample
+#ifndef TRANSFER_TABLES
+#define TRANSFER_TABLES 0
+#endif
+
+// Each power of two in [2^TRANSFER_MIN_EXPONENT, 2^TRANSFER_MAX_EXPONENT) is split into 2^TRANSFER_MANTISSA_BITS segments, so the
+// segments get finer towards zero and the relative error of the linear interpolation is about the same everywhere.
+// Inputs outside that range (zero, negatives, NaNs, tiny or large values) are computed exactly.
+#define TRANSFER_MANTISSA_BITS 8
+#define TRANSFER_MIN_EXPONENT -20
+#define TRANSFER_MAX_EXPONENT 2
+#define TRANSFER_ENTRIES (((TRANSFER_MAX_EXPONENT - TRANSFER_MIN_EXPONENT) << TRANSFER_MANTISSA_BITS) + 1)
+
+// Tables kept for the life of the process, one per function and parameter
+#define TRANSFER_CACHE_SIZE 16
+
+// Samples converted at a time when a table is applied in the middle of a per pixel loop (kept on the stack)
+#define TRANSFER_BLOCK 1024
+
+enum TransferFunction
+{
+	TRANSFER_POWER,			// x^parameter, as in correctGammaRef
+	TRANSFER_SRGB_LINEAR,	// sRGB to linear RGB, as in linearizerHelper
+	TRANSFER_LAB			// Cube root with a linear toe, as in labFunction
+};
+
+struct TransferTable
+{
+	enum TransferFunction function;
+	float parameter;
+	float max_error;		// Largest absolute error against libm, measured between the entries when the table is built
+	float max_relative;		// Largest relative error against libm
+	float values[TRANSFER_ENTRIES];
+};
+
+// Transfer Functions
+float calcTransferExact(const enum TransferFunction function, const float parameter, const float value);
+const struct TransferTable* getTransferTable(const enum TransferFunction function, const float parameter);
+float lookupTransfer(const struct TransferTable* table, const float value);
+void applyTransfer(const enum TransferFunction function, const float parameter, const float* input, float* output, const int num_values);
+void applyTransferTable(const struct TransferTable* table, const float* input, float* output, const int num_values, const enum SimdLevel level);
+const char* getTransferName(const enum TransferFunction function);
+int runTransferBenchmark(void);
+
+#endif
@@ -3,6 +3,30 @@
 #define WEIGHTS_H
 
 #include "imfunc.h"
+#include "half.h"
+
+// Planes written by rgb2LABPlanesRef, they can be combined
+#define LAB_PLANE_L 1
+#define LAB_PLANE_A 2
+#define LAB_PLANE_B 4
+#define LAB_PLANES_ALL (LAB_PLANE_L | LAB_PLANE_A | LAB_PLANE_B)
+
+// Smallest image converted to LAB on several threads
+#define MIN_PARALLEL_LAB (1 << 16)
+
+// Pixel range [first, last) of the fused RGB to LAB kernels, either the LAB planes or the distance to lab_avg is written
+struct lab_args
+{
+	const float* image;
+	float* lab;
+	float* distance;
+	const float* lab_avg;
+	int num_pixels;
+	int first;
+	int last;
+	int planes;
+	const struct TransferTable* table;	// LAB transfer table looked up once per stage (see getLABTable), NULL without one
+};
 
 // Weight Functions
 float* calcLaplacianWeight(float* lum, const int num_row, const int num_col);
@@ -10,15 +34,35 @@ float* calcSaliencyWeight(float* image, const int num_row, const int num_col);
 float* calcSaturationWeight(float* image, float* lum, const int num_pixels);
 float* calcLuminance(float* image, const int num_pixels, const int lum_option);
 
+float calcLaplacianWeightRef(float* lum, float* w_lap, const int num_row, const int num_col, struct Workspace* ws);
+void calcSaliencyWeightRef(float* image, float* sal_weight, const int num_row, const int num_col, struct Workspace* ws);
+void calcSaliencyBlurRef(float* image, float* blurred, const int num_row, const int num_col, struct Workspace* ws);
+void calcSaturationWeightRef(float* image, float* lum, float* sat_weight, const int num_pixels);
+void calcLuminanceRef(float* image, float* lum, const int num_pixels, const int lum_option);
+
 // Helper Functions
 void normalizeWeight(float* weight, const int num_pixels);
+float calcMaxWeight(const float* weight, const int num_pixels);
 float* getWeights(float* image, const int num_row, const int num_col, const int lum_option);
+void getWeightsRef(float* image, float* total_weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws);
+half* getWeightsHalf(float* image, const int num_row, const int num_col, const int lum_option);
+void getWeightsHalfRef(float* image, half* total_weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws);
 
 // Color Conversion Functions
 float* rgb2LAB(float* image, const int num_pixels);
 float* xyz2LAB(float* image, const int num_pixels);
 float* rgb2XYZ(float* image, const int num_pixels);
 float* xyz2rgb(float* image, const int num_pixels);
+
+void rgb2LABRef(float* image, float* lab_image, const int num_pixels, struct Workspace* ws);
+void rgb2LABPlanesRef(const float* image, float* lab_image, const int num_pixels, const int planes);
+void calcLABSums(const float* image, const int num_pixels, const int first, const int last, double* lab_sum);
+void calcLABDistanceRef(const float* image, float* distance, const int num_pixels, const float* lab_avg);
+void* rgb2LABWorker(void* vargs);
+const struct TransferTable* getLABTable(void);
+void xyz2LABRef(float* image, float* lab_image, const int num_pixels);
+void rgb2XYZRef(float* image, float* xyz_image, const int num_pixels);
+void xyz2rgbRef(float* image, float* rgb, const int num_pixels);
 float labFunction(const float a, const float b);
 
 #endif
\ No newline at end of file
@@ -4,17 +4,63 @@
 
 #include "imfunc.h"
 #include "weights.h"
+#include "parallel.h"
 
 #define NUM_BINS (2 << 10)
 
+// Smallest image white balanced on several threads
+#define MIN_PARALLEL_WHITE (1 << 16)
+
+// Illuminant used by applyGreyWorldFull in place of the one measured by calcIlluminantRGB
+#define FIXED_ILLUMINANT_RED 0.689697867312801
+#define FIXED_ILLUMINANT_GREEN 1.0
+#define FIXED_ILLUMINANT_BLUE 0.844054675120857
+
+// Pixel range [first, last) of the single pass white balance (see applyWhiteBalancePixels)
+struct white_args
+{
+	const float* image;
+	float* output;
+	int num_pixels;
+	int first;
+	int last;
+	const float* averages;
+	float alpha;
+	const float* transformation;
+};
+
+// Pixels [first, last) of every channel averaged by illuminantWorker, values within [low, high] are added up
+struct illuminant_args
+{
+	const float* image;
+	int num_pixels;
+	int first;
+	int last;
+	int num_channels;
+	double low[NUM_CHANNELS];
+	double high[NUM_CHANNELS];
+	float sum[NUM_CHANNELS];
+	int count[NUM_CHANNELS];
+};
+
 float* applyWhiteBalance(float* image, const int num_row, const int num_col, const float alpha);
+void applyWhiteBalanceRef(float* image, float* corrected, const int num_row, const int num_col, const float alpha, struct Workspace* ws);
+void applyWhiteBalancePixels(const float* image, float* output, const int num_pixels, const float* averages, const float alpha, const float* transformation);
+void* whiteBalanceWorker(void* vargs);
+void calcChannelAverages(const float* image, const int num_pixels, float* averages);
+void compensateChannels(float* image, const int num_pixels, const float* averages, const float alpha);
 void  applyGreyWorld(float* image, const int num_pixels);
 void linearizeRGB(float* image, const int num_pixels);
 float linearizerHelper(const float pixel);
 
 float* applyGreyWorldFull(float* image, const int num_pixels, const int percentile);
+void applyGreyWorldFullRef(float* image, float* output, const int num_pixels, const int percentile, struct Workspace* ws);
+void calcGreyWorldTransform(float* illuminants, float* transformation);
+void applyGreyWorldTransformRef(float* image, float* output, const int num_pixels, float* transformation, struct Workspace* ws);
 float calcIlluminant(float* image, const int num_pixels, const int percentile);
-float* calcIlluminantRGB(float* image, const int num_pixels, const int percentile);
+void calcIlluminantRGB(float* image, const int num_pixels, const int percentile, float* illuminants);
+void calcIlluminants(const float* image, const int num_pixels, const int num_channels, const int percentile, float* illuminants);
+void* illuminantWorker(void* vargs);
 float* multiplyFlatMatrix(float* left_mat, float* right_mat, const int left_num_row, const int left_num_col, const int right_num_row, const int right_num_col);
 int multiplyFlatMatrixRef(float* left_mat, float* right_mat, float* output, const int left_num_row, const int left_num_col, const int right_num_row, const int right_num_col);
 
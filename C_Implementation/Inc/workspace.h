@@ -0,0 +1,32 @@
+#pragma once
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Alignment of every block handed out by a workspace (one cache line, enough for AVX-512 loads)
+#define WORKSPACE_ALIGNMENT 64
+
+// Stack-like arena for the full frame planes used by the pipeline. Blocks must be released in the reverse order they were taken.
+// Functions that take a workspace also accept NULL, in which case their temporaries come from malloc / free.
+struct Workspace
+{
+	void* memory;
+	uint8_t* base;
+	size_t capacity;
+	size_t offset;
+	size_t peak;
+};
+
+// Workspace Management
+int initWorkspace(struct Workspace* ws, const size_t capacity);
+void freeWorkspace(struct Workspace* ws);
+size_t calcPlaneBytes(const int num_row, const int num_col);
+
+// Taking and releasing planes
+float* takePlanes(struct Workspace* ws, const size_t num_floats);
+void releasePlanes(struct Workspace* ws, float* planes);
+
+#endif
@@ -40,6 +40,218 @@ void padMatrix(float* input, float* pad_mat, const int input_num_row, const int
     return;
 }
 
+/**
+ * Convolves a single output pixel near the border. Taps that fall outside the image are skipped, which gives the same
+ * sum as multiplying them by zero padding since the remaining products are added in the same order.
+ */
+static inline float convBorderPixel(const float* input, const float* filter, const int num_row, const int num_col, const int filter_size,
+    const int row, const int col)
+{
+    const int pad = (filter_size - 1) / 2;
+    float sum = 0;
+
+    for (int i = 0; i < filter_size; i++)
+    {
+        const int y = row + i - pad;
+
+        if (y < 0 || y >= num_row)
+            continue;
+
+        for (int j = 0; j < filter_size; j++)
+        {
+            const int x = col + j - pad;
+
+            if (x >= 0 && x < num_col)
+                sum += input[y * num_col + x] * filter[i * filter_size + j];
+        }
+    }
+
+    return sum;
+}
+
+/**
+ * Convolves the interior columns [first, last) of one output row with a 3 x 3 filter, fully unrolled.
+ * The SIMD kernels (see convsimd.c) do the same additions in the same order on several columns at once.
+ */
+void convRow3Scalar(const float* const rows[3], const float* filter, float* output, const int first, const int last)
+{
+    const float* above = rows[0];
+    const float* center = rows[1];
+    const float* below = rows[2];
+
+    const float f0 = filter[0], f1 = filter[1], f2 = filter[2];
+    const float f3 = filter[3], f4 = filter[4], f5 = filter[5];
+    const float f6 = filter[6], f7 = filter[7], f8 = filter[8];
+
+    for (int col = first; col < last; col++)
+    {
+        // Same order as the padded loop, starting from zero so the result is bit identical
+        float sum = 0;
+        sum += above[col - 1] * f0;
+        sum += above[col] * f1;
+        sum += above[col + 1] * f2;
+        sum += center[col - 1] * f3;
+        sum += center[col] * f4;
+        sum += center[col + 1] * f5;
+        sum += below[col - 1] * f6;
+        sum += below[col] * f7;
+        sum += below[col + 1] * f8;
+
+        output[col] = sum;
+    }
+
+    return;
+}
+
+/**
+ * Convolves the interior columns [first, last) of one output row with a filter_size x filter_size filter.
+ * Called with a constant size so the compiler can unroll the taps.
+ */
+static inline void convRowN(const float* const* rows, const float* filter, float* output, const int first, const int last, const int filter_size)
+{
+    const int pad = (filter_size - 1) / 2;
+
+    for (int col = first; col < last; col++)
+    {
+        float sum = 0;
+
+        for (int i = 0; i < filter_size; i++)
+            for (int j = 0; j < filter_size; j++)
+                sum += rows[i][col + j - pad] * filter[i * filter_size + j];
+
+        output[col] = sum;
+    }
+
+    return;
+}
+
+/**
+ * Convolves an image with a square filter with zero padding, without making a padded copy. The window of input rows
+ * slides down one row per output row; the interior of each row uses a kernel specialized for 3 x 3, 5 x 5 or 7 x 7 filters
+ * and the border pixels skip the taps outside the image. The result is bit identical to convolving a padded copy.
+ * 3 x 3 filters use the widest SIMD kernel the CPU supports (see getSimdLevel).
+ * 
+ * @param   input           The input image flattened out to 1D in column-row order. ie: left to right, top to bottom
+ * @param   filter          The fitler to convolve with the input image, also flattened
+ * @param   output          Memory location of the output, may not overlap the input
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The dimension of the filter (odd, note that the filter is assumed to be square)
+ * 
+ * @return                  Places the result of conv2D(input, filter) in "output"
+ */
+void convPlane(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size)
+{
+    convPlaneSimd(input, filter, output, input_num_row, input_num_col, filter_size, getSimdLevel());
+
+    return;
+}
+
+/**
+ * Convolves one output row of an image with a square filter (see convPlaneSimd)
+ */
+static inline void convPlaneRow(const float* input, const float* filter, float* output_row, const int input_num_row, const int input_num_col,
+    const int filter_size, const int row, const ConvRow3Kernel row3)
+{
+    const int pad = (filter_size - 1) / 2;
+    const float* rows[MAX_FILTER_SIZE];
+    const int specialized = (filter_size == 3 || filter_size == 5 || filter_size == 7);
+
+    // Columns whose window lies entirely inside the image (empty for images narrower than the filter)
+    const int first = pad;
+    const int last = (input_num_col > 2 * pad) ? input_num_col - pad : pad;
+
+    // Rows whose window runs off the top or bottom, or sizes without a specialized kernel
+    if (!specialized || row < pad || row >= input_num_row - pad)
+    {
+        for (int col = 0; col < input_num_col; col++)
+            output_row[col] = convBorderPixel(input, filter, input_num_row, input_num_col, filter_size, row, col);
+
+        return;
+    }
+
+    // Slide the window down to this row
+    for (int i = 0; i < filter_size; i++)
+        rows[i] = &input[(row + i - pad) * input_num_col];
+
+    for (int col = 0; col < first && col < input_num_col; col++)
+        output_row[col] = convBorderPixel(input, filter, input_num_row, input_num_col, filter_size, row, col);
+
+    if (filter_size == 3)
+        row3(rows, filter, output_row, first, last);
+
+    else if (filter_size == 5)
+        convRowN(rows, filter, output_row, first, last, 5);
+
+    else
+        convRowN(rows, filter, output_row, first, last, 7);
+
+    for (int col = (last > first) ? last : first; col < input_num_col; col++)
+        output_row[col] = convBorderPixel(input, filter, input_num_row, input_num_col, filter_size, row, col);
+
+    return;
+}
+
+/**
+ * Convolves an image with a square filter (see convPlane), with the 3 x 3 row kernel of a given instruction set
+ * 
+ * @param   input           The input image flattened out to 1D in column-row order. ie: left to right, top to bottom
+ * @param   filter          The fitler to convolve with the input image, also flattened
+ * @param   output          Memory location of the output, may not overlap the input
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The dimension of the filter (odd, note that the filter is assumed to be square)
+ * @param   level           Instruction set of the 3 x 3 kernel, it must be supported by the CPU
+ * 
+ * @return                  Places the result of conv2D(input, filter) in "output"
+ */
+void convPlaneSimd(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size,
+    const enum SimdLevel level)
+{
+    const ConvRow3Kernel row3 = getConvRow3Kernel(level);
+
+    for (int row = 0; row < input_num_row; row++)
+        convPlaneRow(input, filter, &output[row * input_num_col], input_num_row, input_num_col, filter_size, row, row3);
+
+    return;
+}
+
+/**
+ * Convolves an image with a square filter (see convPlane) and stores the absolute value of the result, keeping track of its
+ * maximum. Each row is finished while it is still in cache, so the filter, the absolute value and the maximum take a
+ * single pass over the image instead of three.
+ * 
+ * @param   input           The input image flattened out to 1D in column-row order. ie: left to right, top to bottom
+ * @param   filter          The fitler to convolve with the input image, also flattened
+ * @param   output          Memory location of the output, may not overlap the input
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The dimension of the filter (odd, note that the filter is assumed to be square)
+ * 
+ * @return                  Places |conv2D(input, filter)| in "output" and returns its maximum
+ */
+float convPlaneAbsMax(const float* input, const float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size)
+{
+    const ConvRow3Kernel row3 = getConvRow3Kernel(getSimdLevel());
+    float max = 0;
+
+    for (int row = 0; row < input_num_row; row++)
+    {
+        float* output_row = &output[row * input_num_col];
+        convPlaneRow(input, filter, output_row, input_num_row, input_num_col, filter_size, row, row3);
+
+        for (int col = 0; col < input_num_col; col++)
+        {
+            const float value = (output_row[col] < 0) ? -output_row[col] : output_row[col];
+
+            output_row[col] = value;
+            max = (value > max) ? value : max;
+        }
+    }
+
+    return max;
+}
+
 /**
  * This function handles the convolution operation for a single filter.
  * 
@@ -49,42 +261,179 @@ void padMatrix(float* input, float* pad_mat, const int input_num_row, const int
  * @param   input_num_row   Number of rows in the input image
  * @param   input_num_col   Number of columns in the input image
  * @param   filter_size     The dimension of the filter (note that the filter is assumed to be square)
+ * @param   ws              Unused since the convolution no longer needs a padded copy of the input, kept for the callers
  * 
  * @return                  Assuming that enough memory was allocated to "output", this function places the result of
  *                          conv2D(input, filter) while preserving the dimension of "input"
  */
-void convHelper(float* input, float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size)
+void convHelper(float* input, float* filter, float* output, const int input_num_row, const int input_num_col, const int filter_size, struct Workspace* ws)
 {
-    // Create padded matrix
-    const int pad_num_row = input_num_row + (filter_size - 1);
-    const int pad_num_col = input_num_col + (filter_size - 1);
-    const int pad_offset = pad_num_row * pad_num_col;
+    (void)ws;
+    convPlane(input, filter, output, input_num_row, input_num_col, filter_size);
 
-    const int filter_offset = filter_size * filter_size;
-
-    // Allocate memory for the new padded matrix
-    float* pad_mat = malloc(sizeof(float) * pad_offset);
-    padMatrix(input, pad_mat, input_num_row, input_num_col, filter_size);
+    return;
+}
 
+/**
+ * Convolves a single pixel near the end of a row with a 1D filter, skipping the taps outside the row
+ */
+static inline float convRowEdgePixel(const float* input_row, const float* filter, const int num_col, const int filter_size, const int col)
+{
+    const int pad = (filter_size - 1) / 2;
     float sum = 0;
 
-    // Padding is 'same' so the output height and width is the same as the input's
-    // Loop through each convolution operation
+    for (int j = 0; j < filter_size; j++)
+    {
+        const int x = col + j - pad;
+
+        if (x >= 0 && x < num_col)
+            sum += input_row[x] * filter[j];
+    }
+
+    return sum;
+}
+
+/**
+ * Horizontal pass of a separable convolution on one row: convolves it with a 1D filter, zero padding the ends
+ */
+static void convRow1D(const float* input_row, const float* filter, float* output_row, const int num_col, const int filter_size)
+{
+    const int pad = (filter_size - 1) / 2;
+    const int first = (pad < num_col) ? pad : num_col;
+    const int last = (num_col - pad > first) ? num_col - pad : first;
+
+    // Interior columns have every tap inside the row
+    for (int col = first; col < last; col++)
+    {
+        float sum = 0;
+
+        for (int j = 0; j < filter_size; j++)
+            sum += input_row[col + j - pad] * filter[j];
+
+        output_row[col] = sum;
+    }
+
+    // The ends skip the taps outside the row
+    for (int col = 0; col < first; col++)
+        output_row[col] = convRowEdgePixel(input_row, filter, num_col, filter_size, col);
+
+    for (int col = last; col < num_col; col++)
+        output_row[col] = convRowEdgePixel(input_row, filter, num_col, filter_size, col);
+
+    return;
+}
+
+/**
+ * Convolves an image with a separable filter, the outer product of a column filter and a row filter, with zero padding.
+ * The cost per pixel is 2 * filter_size instead of filter_size^2.
+ * 
+ * @param   input           The input image flattened out to 1D in column-row order. ie: left to right, top to bottom
+ * @param   row_filter      1D filter applied along each row (horizontal pass)
+ * @param   col_filter      1D filter applied along each column (vertical pass)
+ * @param   output          Memory location of the output, may not overlap the input
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The length of both 1D filters (odd)
+ * @param   ws              Workspace for the rows of the horizontal pass, NULL to allocate them
+ * 
+ * @return                  Places the result in "output" while preserving the dimension of "input"
+ */
+void convSeparable(const float* input, const float* row_filter, const float* col_filter, float* output, const int input_num_row, const int input_num_col,
+    const int filter_size, struct Workspace* ws)
+{
+    convSeparableChannels(input, 1, 0, input_num_col, row_filter, col_filter, output, LAYOUT_PLANAR, input_num_row, input_num_col, filter_size, ws);
+
+    return;
+}
+
+/**
+ * Convolves every plane of a planar image with the same separable filter (see convSeparable) in a single pass over the rows.
+ * Each input row is filtered horizontally once, for all channels, into a ring of the last filter_size rows; the vertical pass
+ * then accumulates whole ring rows scaled by one tap at a time, so every access is sequential and no transpose is needed.
+ * The result of each plane is bit identical to convolving it on its own.
+ * 
+ * @param   input           First plane of the input image
+ * @param   num_channels    Number of planes to convolve
+ * @param   plane_stride    Number of floats from one input plane to the next
+ * @param   row_stride      Number of floats from one input row to the next (at least input_num_col)
+ * @param   row_filter      1D filter applied along each row (horizontal pass)
+ * @param   col_filter      1D filter applied along each column (vertical pass)
+ * @param   output          Memory location of the output, may not overlap the input. Planes (or pixels) are packed without padding
+ * @param   layout          LAYOUT_PLANAR for [R... G... B...] output, LAYOUT_INTERLEAVED for [RGB RGB ...]
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The length of both 1D filters (odd)
+ * @param   ws              Workspace for the ring of rows, NULL to allocate it
+ * 
+ * @return                  Places the result in "output" while preserving the dimension of "input"
+ */
+void convSeparableChannels(const float* input, const int num_channels, const size_t plane_stride, const int row_stride, const float* row_filter,
+    const float* col_filter, float* output, const enum ChannelLayout layout, const int input_num_row, const int input_num_col, const int filter_size,
+    struct Workspace* ws)
+{
+    const int pad = (filter_size - 1) / 2;
+    const size_t ring_row = (size_t)num_channels * input_num_col;
+    const size_t plane_size = (size_t)input_num_row * input_num_col;
+
+    // Horizontally filtered rows, input row y of channel c is at ring[(y % filter_size) * ring_row + c * num_col]
+    float* ring = takePlanes(ws, filter_size * ring_row);
+
+    // Interleaved output is accumulated planar for one row, then shuffled into place
+    float* accumulated = (layout == LAYOUT_INTERLEAVED) ? takePlanes(ws, ring_row) : NULL;
+
+    int next_row = 0;
+
     for (int row = 0; row < input_num_row; row++)
     {
-        for (int col = 0; col < input_num_col; col++)
+        // Slide the ring down so it holds rows [row - pad, row + pad]
+        const int last_needed = (row + pad < input_num_row) ? row + pad : input_num_row - 1;
+
+        for (; next_row <= last_needed; next_row++)
+        {
+            float* slot = &ring[(next_row % filter_size) * ring_row];
+
+            for (int c = 0; c < num_channels; c++)
+                convRow1D(&input[c * plane_stride + (size_t)next_row * row_stride], row_filter, &slot[c * input_num_col], input_num_col, filter_size);
+        }
+
+        for (int c = 0; c < num_channels; c++)
         {
-            sum = 0;
+            float* output_row = (layout == LAYOUT_PLANAR) ? &output[c * plane_size + (size_t)row * input_num_col] : &accumulated[c * input_num_col];
 
-            // Add up the result of a single convolution
-            for (int i = 0; i < filter_offset; i++)
-                sum += pad_mat[((row + i / filter_size) * pad_num_col) + col + (i % filter_size)] * filter[i];
+            for (int col = 0; col < input_num_col; col++)
+                output_row[col] = 0;
 
-            output[col + row * input_num_col] = sum;
+            // Taps above the top or below the bottom are skipped (zero padding)
+            for (int i = 0; i < filter_size; i++)
+            {
+                const int y = row + i - pad;
+
+                if (y < 0 || y >= input_num_row)
+                    continue;
+
+                const float* ring_row_c = &ring[(y % filter_size) * ring_row + c * input_num_col];
+                const float tap = col_filter[i];
+
+                for (int col = 0; col < input_num_col; col++)
+                    output_row[col] += ring_row_c[col] * tap;
+            }
+        }
+
+        if (layout == LAYOUT_INTERLEAVED)
+        {
+            float* output_row = &output[(size_t)row * ring_row];
+
+            for (int col = 0; col < input_num_col; col++)
+                for (int c = 0; c < num_channels; c++)
+                    output_row[col * num_channels + c] = accumulated[c * input_num_col + col];
         }
     }
 
-    free(pad_mat);
+    // Release in the reverse order they were taken
+    if (accumulated != NULL)
+        releasePlanes(ws, accumulated);
+
+    releasePlanes(ws, ring);
     return;
 }
 
@@ -102,7 +451,87 @@ void convHelper(float* input, float* filter, float* output, const int input_num_
 float* conv2D(float* input, float* filter, const int input_num_row, const int input_num_col, const int filter_size)
 {
     float* output = malloc(sizeof(float) * input_num_col * input_num_row);
-    convHelper(input, filter, output, input_num_row, input_num_col, filter_size);
+    convHelper(input, filter, output, input_num_row, input_num_col, filter_size, NULL);
 
     return output;
-}
\ No newline at end of file
+}
+
+/**
+* Create a matrix of 16 bit samples with zero padding around the edges (see padMatrix).
+* 
+* @param   input           The input array that is flattened by column-row order
+* @param   pad_mat         Array in which the padded matrix is stored
+* @param   input_num_row   The number of rows in the input matrix
+* @param   input_num_col   The number of columns in the input matrix
+* @param   filter_size     The number of rows and columns of the filter. The filter must be square
+* 
+* @return                  Modifies pad_mat with the padded version of input
+*/
+void padMatrixFixed(const uint16_t* input, uint16_t* pad_mat, const int input_num_row, const int input_num_col, const int filter_size)
+{
+    const int pad = (filter_size - 1) / 2;
+    const int output_num_col = input_num_col + 2 * pad;
+
+    // Zero the top and bottom padding rows, then copy each input row between a left and right pad
+    memset(pad_mat, 0, sizeof(uint16_t) * pad * output_num_col);
+    memset(&pad_mat[(input_num_row + pad) * output_num_col], 0, sizeof(uint16_t) * pad * output_num_col);
+
+    for (int j = 0; j < input_num_row; j++)
+    {
+        uint16_t* row = &pad_mat[(j + pad) * output_num_col];
+
+        memset(row, 0, sizeof(uint16_t) * pad);
+        memcpy(&row[pad], &input[j * input_num_col], sizeof(uint16_t) * input_num_col);
+        memset(&row[pad + input_num_col], 0, sizeof(uint16_t) * pad);
+    }
+
+    return;
+}
+
+/**
+ * Convolves a plane of 16 bit samples with an integer filter. The products are summed exactly in 64 bits, then
+ * (optionally) the absolute value is taken and the sum is rounded down by "shift" bits and saturated to [0, 65535].
+ * 
+ * @param   input           The input plane flattened out to 1D in column-row order
+ * @param   filter          The integer filter, also flattened
+ * @param   output          Memory location of the output
+ * @param   input_num_row   Number of rows in the input image
+ * @param   input_num_col   Number of columns in the input image
+ * @param   filter_size     The dimension of the filter (note that the filter is assumed to be square)
+ * @param   shift           Number of fraction bits of the filter, or more to make room for the range of the result
+ * @param   absolute        1 to store the magnitude of the result (needed for filters with negative taps)
+ * @param   ws              Workspace for the padded copy of the input, NULL to allocate it
+ * 
+ * @return                  Places the result in "output" while preserving the dimension of "input"
+ */
+void convHelperFixed(const uint16_t* input, const int16_t* filter, uint16_t* output, const int input_num_row, const int input_num_col, const int filter_size,
+    const int shift, const int absolute, struct Workspace* ws)
+{
+    const int pad_num_row = input_num_row + (filter_size - 1);
+    const int pad_num_col = input_num_col + (filter_size - 1);
+    const int64_t round = (shift > 0) ? ((int64_t)1 << (shift - 1)) : 0;
+
+    // The workspace hands out floats, two samples fit in each
+    uint16_t* pad_mat = (uint16_t*)takePlanes(ws, ((size_t)pad_num_row * pad_num_col + 1) / 2);
+    padMatrixFixed(input, pad_mat, input_num_row, input_num_col, filter_size);
+
+    for (int row = 0; row < input_num_row; row++)
+    {
+        for (int col = 0; col < input_num_col; col++)
+        {
+            int64_t sum = 0;
+
+            for (int i = 0; i < filter_size; i++)
+                for (int j = 0; j < filter_size; j++)
+                    sum += (int64_t)pad_mat[(row + i) * pad_num_col + col + j] * filter[i * filter_size + j];
+
+            sum = (absolute && sum < 0) ? -sum : sum;
+            sum = (sum + round) >> shift;
+
+            output[col + row * input_num_col] = (uint16_t)((sum < 0) ? 0 : (sum > UINT16_MAX) ? UINT16_MAX : sum);
+        }
+    }
+
+    releasePlanes(ws, (float*)pad_mat);
+    return;
+}
@@ -0,0 +1,265 @@
+#include "../Inc/conv.h"
+#include "../Inc/parallel.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+
+/*
+ * Each kernel computes 4, 8 or 16 neighbouring output pixels with one instruction per tap. The products are added
+ * one at a time from zero in the same order as convRow3Scalar, without fused multiply adds, so every variant gives
+ * bit identical results. The columns left over at the end of the row go through the scalar kernel.
+ * GCC treats these intrinsics as plain vector arithmetic and would contract them into FMAs wherever FMA is enabled
+ * (AVX-512 implies it), so contraction is turned off for the kernels.
+ */
+#define CONV_KERNEL_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+
+/**
+ * 3 x 3 row kernel with SSE2, 4 pixels at a time
+ */
+CONV_KERNEL_TARGET("sse2")
+void convRow3SSE2(const float* const rows[3], const float* filter, float* output, const int first, const int last)
+{
+    const float* above = rows[0];
+    const float* center = rows[1];
+    const float* below = rows[2];
+
+    __m128 f[9];
+    for (int i = 0; i < 9; i++)
+        f[i] = _mm_set1_ps(filter[i]);
+
+    int col = first;
+
+    for (; col + 4 <= last; col += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&above[col - 1]), f[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&above[col]), f[1]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&above[col + 1]), f[2]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&center[col - 1]), f[3]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&center[col]), f[4]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&center[col + 1]), f[5]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&below[col - 1]), f[6]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&below[col]), f[7]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&below[col + 1]), f[8]));
+
+        _mm_storeu_ps(&output[col], sum);
+    }
+
+    convRow3Scalar(rows, filter, output, col, last);
+
+    return;
+}
+
+/**
+ * 3 x 3 row kernel with AVX2, 8 pixels at a time
+ */
+CONV_KERNEL_TARGET("avx2")
+void convRow3AVX2(const float* const rows[3], const float* filter, float* output, const int first, const int last)
+{
+    const float* above = rows[0];
+    const float* center = rows[1];
+    const float* below = rows[2];
+
+    __m256 f[9];
+    for (int i = 0; i < 9; i++)
+        f[i] = _mm256_set1_ps(filter[i]);
+
+    int col = first;
+
+    for (; col + 8 <= last; col += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&above[col - 1]), f[0]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&above[col]), f[1]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&above[col + 1]), f[2]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&center[col - 1]), f[3]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&center[col]), f[4]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&center[col + 1]), f[5]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&below[col - 1]), f[6]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&below[col]), f[7]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&below[col + 1]), f[8]));
+
+        _mm256_storeu_ps(&output[col], sum);
+    }
+
+    convRow3Scalar(rows, filter, output, col, last);
+
+    return;
+}
+
+/**
+ * 3 x 3 row kernel with AVX-512, 16 pixels at a time
+ */
+CONV_KERNEL_TARGET("avx512f")
+void convRow3AVX512(const float* const rows[3], const float* filter, float* output, const int first, const int last)
+{
+    const float* above = rows[0];
+    const float* center = rows[1];
+    const float* below = rows[2];
+
+    __m512 f[9];
+    for (int i = 0; i < 9; i++)
+        f[i] = _mm512_set1_ps(filter[i]);
+
+    int col = first;
+
+    for (; col + 16 <= last; col += 16)
+    {
+        __m512 sum = _mm512_setzero_ps();
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&above[col - 1]), f[0]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&above[col]), f[1]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&above[col + 1]), f[2]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&center[col - 1]), f[3]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&center[col]), f[4]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&center[col + 1]), f[5]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&below[col - 1]), f[6]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&below[col]), f[7]));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_loadu_ps(&below[col + 1]), f[8]));
+
+        _mm512_storeu_ps(&output[col], sum);
+    }
+
+    convRow3Scalar(rows, filter, output, col, last);
+
+    return;
+}
+#endif
+
+/**
+ * Returns the 3 x 3 row kernel of an instruction set
+ *
+ * @param   level   Instruction set, levels without a kernel on this compiler fall back to scalar
+ *
+ * @return          The row kernel
+ */
+ConvRow3Kernel getConvRow3Kernel(const enum SimdLevel level)
+{
+#if SIMD_X86
+    if (level == SIMD_AVX512)
+        return convRow3AVX512;
+
+    if (level == SIMD_AVX2)
+        return convRow3AVX2;
+
+    if (level == SIMD_SSE2)
+        return convRow3SSE2;
+#else
+    (void)level;
+#endif
+
+    return convRow3Scalar;
+}
+
+/**
+ * The convolution as it was before convPlane: pad a copy of the input and run the generic filter_size^2 loop.
+ * Kept as the baseline of the benchmark.
+ */
+static void convPadded(float* input, float* filter, float* output, float* pad_mat, const int num_row, const int num_col, const int filter_size)
+{
+    const int pad_num_col = num_col + (filter_size - 1);
+    const int filter_offset = filter_size * filter_size;
+
+    padMatrix(input, pad_mat, num_row, num_col, filter_size);
+
+    for (int row = 0; row < num_row; row++)
+    {
+        for (int col = 0; col < num_col; col++)
+        {
+            float sum = 0;
+
+            for (int i = 0; i < filter_offset; i++)
+                sum += pad_mat[((row + i / filter_size) * pad_num_col) + col + (i % filter_size)] * filter[i];
+
+            output[col + row * num_col] = sum;
+        }
+    }
+
+    return;
+}
+
+/**
+ * Times the 3 x 3 Gaussian and Laplacian convolutions on frames from 640 x 480 to 8K, with the padded baseline and
+ * every SIMD kernel the CPU supports, and checks that every kernel matches the baseline bit for bit.
+ *
+ * @return      Returns 0 if every kernel matched, -1 otherwise (or if memory ran out)
+ */
+int runConvBenchmark(void)
+{
+    const int sizes[][2] = { { 480, 640 }, { 720, 1280 }, { 1080, 1920 }, { 2160, 3840 }, { 4320, 7680 } };
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    float gaussian_filter[9] = { 0.0113, 0.0838, 0.0113, 0.0838, 0.6193, 0.0838, 0.0113, 0.0838, 0.0113 };
+    float lap_filter[9] = { -1.0, -1.0, -1.0, -1.0, 8.0, -1.0, -1.0, -1.0, -1.0 };
+    float* filters[2] = { gaussian_filter, lap_filter };
+    const char* filter_names[2] = { "gaussian", "laplacian" };
+
+    const enum SimdLevel best = detectSimdLevel();
+    int status = 0;
+
+    printf("Best kernel on this CPU: %s (dispatching %s)\n", getSimdName(best), getSimdName(getSimdLevel()));
+    printf("%-11s %-10s %-8s %10s %10s %8s %s\n", "frame", "filter", "kernel", "ms", "Mpixel/s", "speedup", "identical");
+
+    for (int s = 0; s < num_sizes; s++)
+    {
+        const int num_row = sizes[s][0];
+        const int num_col = sizes[s][1];
+        const size_t num_pixels = (size_t)num_row * num_col;
+
+        // Repeat small frames so each measurement covers about 20 million pixels
+        const int repeats = (num_pixels < 20000000) ? (int)(20000000 / num_pixels) : 1;
+
+        float* input = malloc(sizeof(float) * num_pixels);
+        float* reference = malloc(sizeof(float) * num_pixels);
+        float* output = malloc(sizeof(float) * num_pixels);
+        float* pad_mat = malloc(sizeof(float) * (num_row + 2) * (num_col + 2));
+
+        if (input == NULL || reference == NULL || output == NULL || pad_mat == NULL)
+        {
+            printf("Not enough memory to benchmark %d x %d frames.\n", num_col, num_row);
+            free(input);
+            free(reference);
+            free(output);
+            free(pad_mat);
+            return -1;
+        }
+
+        srand(s + 1);
+        for (size_t i = 0; i < num_pixels; i++)
+            input[i] = rand() / (float)RAND_MAX;
+
+        char frame[32];
+        snprintf(frame, sizeof(frame), "%dx%d", num_col, num_row);
+
+        for (int f = 0; f < 2; f++)
+        {
+            double start = getWallTime();
+            for (int r = 0; r < repeats; r++)
+                convPadded(input, filters[f], reference, pad_mat, num_row, num_col, 3);
+            const double padded_time = (getWallTime() - start) / repeats;
+
+            printf("%-11s %-10s %-8s %10.3f %10.1f %8.2f %s\n", frame, filter_names[f], "padded", padded_time * 1e3,
+                num_pixels / padded_time * 1e-6, 1.0, "-");
+
+            for (int level = SIMD_SCALAR; level <= (int)best; level++)
+            {
+                start = getWallTime();
+                for (int r = 0; r < repeats; r++)
+                    convPlaneSimd(input, filters[f], output, num_row, num_col, 3, (enum SimdLevel)level);
+                const double time = (getWallTime() - start) / repeats;
+
+                const int identical = (memcmp(reference, output, sizeof(float) * num_pixels) == 0);
+                status = identical ? status : -1;
+
+                printf("%-11s %-10s %-8s %10.3f %10.1f %8.2f %s\n", frame, filter_names[f], getSimdName((enum SimdLevel)level), time * 1e3,
+                    num_pixels / time * 1e-6, padded_time / time, identical ? "yes" : "NO");
+            }
+        }
+
+        free(input);
+        free(reference);
+        free(output);
+        free(pad_mat);
+    }
+
+    return status;
+}
@@ -0,0 +1,243 @@
+#include "../Inc/half.h"
+#include <string.h>
+
+// F16C needs GCC / Clang on x86 for the target attribute, everything else uses the scalar conversion
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HALF_USE_F16C 1
+#include <immintrin.h>
+#else
+#define HALF_USE_F16C 0
+#endif
+
+/**
+ * Converts a float to a half, rounding to the nearest even like the F16C instructions do
+ *
+ * @param   value   The float to convert
+ *
+ * @return          The closest half. Out of range values become infinity and NaNs stay NaN
+ */
+half floatToHalf(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinity and NaN (quieted)
+    if (((bits >> 23) & 0xff) == 0xff)
+        return (half)(sign | 0x7c00 | (mantissa ? 0x200 | (mantissa >> 13) : 0));
+
+    // Overflow to infinity
+    if (exponent >= 0x1f)
+        return (half)(sign | 0x7c00);
+
+    // Subnormal halves, anything below half of the smallest one rounds to zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return (half)sign;
+
+        mantissa |= 0x800000;
+
+        const int shift = 14 - exponent;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        uint32_t result = mantissa >> shift;
+
+        if (remainder > halfway || (remainder == halfway && (result & 1)))
+            result++;
+
+        return (half)(sign | result);
+    }
+
+    // Normal halves, a carry out of the mantissa correctly bumps the exponent (up to infinity)
+    uint32_t result = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fff;
+
+    if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+        result++;
+
+    return (half)(sign | result);
+}
+
+/**
+ * Converts a half to a float, which is always exact
+ *
+ * @param   value   The half to convert
+ *
+ * @return          The same value as a float
+ */
+float halfToFloat(const half value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    int exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+
+    // Infinity and NaN (quieted)
+    if (exponent == 0x1f)
+        bits = sign | 0x7f800000 | (mantissa ? 0x400000 : 0) | (mantissa << 13);
+
+    else if (exponent != 0)
+        bits = sign | ((uint32_t)(exponent + 112) << 23) | (mantissa << 13);
+
+    else if (mantissa == 0)
+        bits = sign;
+
+    // Subnormal halves are normal floats, shift the leading one into place
+    else
+    {
+        exponent = 1;
+
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+
+        bits = sign | ((uint32_t)(exponent + 112) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+
+    return result;
+}
+
+#if HALF_USE_F16C
+/**
+ * Packs 8 floats at a time with F16C, the tail uses the scalar conversion
+ */
+__attribute__((target("avx,f16c")))
+static void packHalfF16C(const float* input, half* output, const size_t num_values)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+        _mm_storeu_si128((__m128i*)&output[i], _mm256_cvtps_ph(_mm256_loadu_ps(&input[i]), _MM_FROUND_TO_NEAREST_INT));
+
+    for (; i < num_values; i++)
+        output[i] = floatToHalf(input[i]);
+
+    return;
+}
+
+/**
+ * Unpacks 8 halves at a time with F16C, the tail uses the scalar conversion
+ */
+__attribute__((target("avx,f16c")))
+static void unpackHalfF16C(const half* input, float* output, const size_t num_values)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+        _mm256_storeu_ps(&output[i], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&input[i])));
+
+    for (; i < num_values; i++)
+        output[i] = halfToFloat(input[i]);
+
+    return;
+}
+#endif
+
+/**
+ * Checks once whether the CPU (and OS, for the AVX registers) supports the F16C conversions
+ *
+ * @return      1 if packHalf / unpackHalf use F16C, 0 if they use the scalar conversion
+ */
+int hasF16C(void)
+{
+#if HALF_USE_F16C
+    static int supported = -1;
+
+    if (supported < 0)
+    {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    }
+
+    return supported;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Converts floats to halves
+ *
+ * @param   input       Floats to convert
+ * @param   output      Memory to place the halves to, may not overlap the input
+ * @param   num_values  Number of values to convert
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void packHalf(const float* input, half* output, const size_t num_values)
+{
+#if HALF_USE_F16C
+    if (hasF16C())
+    {
+        packHalfF16C(input, output, num_values);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < num_values; i++)
+        output[i] = floatToHalf(input[i]);
+
+    return;
+}
+
+/**
+ * Converts halves to floats
+ *
+ * @param   input       Halves to convert
+ * @param   output      Memory to place the floats to, may not overlap the input
+ * @param   num_values  Number of values to convert
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void unpackHalf(const half* input, float* output, const size_t num_values)
+{
+#if HALF_USE_F16C
+    if (hasF16C())
+    {
+        unpackHalfF16C(input, output, num_values);
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < num_values; i++)
+        output[i] = halfToFloat(input[i]);
+
+    return;
+}
+
+/**
+ * Adds floats to a plane of halves, a block at a time so the sum itself is done in float
+ *
+ * @param   total       Halves to add to
+ * @param   values      Floats to add
+ * @param   num_values  Number of values in each plane
+ *
+ * @return              Modifies the halves directly
+ */
+void addHalf(half* total, const float* values, const size_t num_values)
+{
+    float block[HALF_BLOCK];
+
+    for (size_t first = 0; first < num_values; first += HALF_BLOCK)
+    {
+        const size_t count = (num_values - first < HALF_BLOCK) ? num_values - first : HALF_BLOCK;
+
+        unpackHalf(&total[first], block, count);
+
+        for (size_t i = 0; i < count; i++)
+            block[i] += values[first + i];
+
+        packHalf(block, &total[first], count);
+    }
+
+    return;
+}
@@ -0,0 +1,195 @@
+#include "../Inc/histogram.h"
+
+/**
+ * Prepares an empty histogram
+ *
+ * @param   hist            The histogram
+ * @param   num_bins        Number of bins per channel, at most MAX_HISTOGRAM_BINS
+ * @param   num_channels    Number of channels, at most MAX_HISTOGRAM_CHANNELS
+ * @param   scale           A value v is counted in bin (int)(v * scale) % num_bins
+ *
+ * @return                  Fills in hist
+ */
+void initHistogram(struct Histogram* hist, const int num_bins, const int num_channels, const float scale)
+{
+    hist->num_bins = num_bins;
+    hist->num_channels = num_channels;
+    hist->scale = scale;
+
+    // Only the bins in use are touched, so small histograms stay cheap to set up
+    for (int c = 0; c < num_channels; c++)
+    {
+        memset(hist->counts[c], 0, sizeof(int) * num_bins);
+        memset(hist->cumulative[c], 0, sizeof(int) * num_bins);
+    }
+
+    return;
+}
+
+/**
+ * Counts the values of the pixels [first, last) into the thread's private bins, the argument is a struct histogram_args.
+ * Every channel of a block of HISTOGRAM_BLOCK pixels is counted before moving on, so the image is read in one pass.
+ */
+void* histogramWorker(void* vargs)
+{
+    struct histogram_args* args = (struct histogram_args*)vargs;
+    const int num_bins = args->hist->num_bins;
+    const float scale = args->hist->scale;
+
+    float block[HISTOGRAM_BLOCK];
+
+    for (int first = args->first; first < args->last; first += HISTOGRAM_BLOCK)
+    {
+        const int count = (args->last - first < HISTOGRAM_BLOCK) ? args->last - first : HISTOGRAM_BLOCK;
+
+        for (int c = 0; c < args->hist->num_channels; c++)
+        {
+            const float* values = &args->image[(size_t)c * args->num_pixels + first];
+            int* bins = &args->bins[c * args->stride];
+
+            if (args->source != NULL)
+            {
+                args->source(args->image, args->num_pixels, c, first, count, block);
+                values = block;
+            }
+
+            for (int i = 0; i < count; i++)
+                bins[(int)(values[i] * scale) % num_bins]++;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Adds up copies of the same bins pairwise in a tree, neighbours first and then copies 2, 4, ... apart
+ *
+ * @param   bins        num_copies consecutive copies of copy_size counters
+ * @param   num_copies  Number of copies
+ * @param   copy_size   Number of counters in each copy
+ *
+ * @return              The total is left in the first copy
+ */
+void mergeHistograms(int* bins, const int num_copies, const int copy_size)
+{
+    for (int distance = 1; distance < num_copies; distance *= 2)
+    {
+        for (int i = 0; i + distance < num_copies; i += 2 * distance)
+        {
+            int* target = &bins[(size_t)i * copy_size];
+            const int* source = &bins[(size_t)(i + distance) * copy_size];
+
+            for (int b = 0; b < copy_size; b++)
+                target[b] += source[b];
+        }
+    }
+
+    return;
+}
+
+/**
+ * Adds the pixels [first, last) of an image to a histogram, one channel per plane. Each thread counts its share of the
+ * pixels into private bins, which are merged in a tree (see mergeHistograms) and added to the histogram, and the
+ * cumulative counts are brought up to date. Calling this on consecutive pieces of an image gives the histogram of the
+ * whole image.
+ *
+ * @param   hist        Histogram to add to (see initHistogram)
+ * @param   image       The image, channel c starts at image[c * num_pixels]
+ * @param   num_pixels  Number of pixels in each plane of the image
+ * @param   first       First pixel to count
+ * @param   last        One past the last pixel to count
+ * @param   source      Computes the values to count from the image, NULL to count the planes as they are
+ *
+ * @return              Updates hist
+ */
+void buildHistogram(struct Histogram* hist, const float* image, const int num_pixels, const int first, const int last, HistogramSource source)
+{
+    struct histogram_args args[MAX_THREADS];
+    const int num_values = last - first;
+    const int copy_size = hist->num_channels * hist->num_bins;
+
+    int num_threads = (num_values >= MIN_PARALLEL_HISTOGRAM) ? getNumThreads() : 1;
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+
+    int* private_bins = NULL;
+
+    if (num_threads > 1)
+    {
+        private_bins = calloc((size_t)num_threads * copy_size, sizeof(int));
+
+        if (private_bins == NULL)
+        {
+            printf("Could not allocate the histogram of each thread, counting on one thread.\n");
+            num_threads = 1;
+        }
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].image = image;
+        args[i].num_pixels = num_pixels;
+        args[i].first = first + (int)((long)num_values * i / num_threads);
+        args[i].last = first + (int)((long)num_values * (i + 1) / num_threads);
+        args[i].hist = hist;
+        args[i].source = source;
+
+        // A single thread counts straight into the histogram
+        args[i].bins = (private_bins != NULL) ? &private_bins[(size_t)i * copy_size] : &hist->counts[0][0];
+        args[i].stride = (private_bins != NULL) ? hist->num_bins : MAX_HISTOGRAM_BINS;
+    }
+
+    runParallel(histogramWorker, args, sizeof(struct histogram_args), num_threads);
+
+    if (private_bins != NULL)
+    {
+        mergeHistograms(private_bins, num_threads, copy_size);
+
+        for (int c = 0; c < hist->num_channels; c++)
+            for (int b = 0; b < hist->num_bins; b++)
+                hist->counts[c][b] += private_bins[c * hist->num_bins + b];
+
+        free(private_bins);
+    }
+
+    for (int c = 0; c < hist->num_channels; c++)
+    {
+        int cum_sum = 0;
+
+        for (int b = 0; b < hist->num_bins; b++)
+        {
+            cum_sum += hist->counts[c][b];
+            hist->cumulative[c][b] = cum_sum;
+        }
+    }
+
+    return;
+}
+
+/**
+ * Finds the first bin at which more than count values of a channel have been seen, such as the bin of a percentile.
+ * The cumulative counts never decrease, so this is a binary search.
+ *
+ * @param   hist        The histogram
+ * @param   channel     Channel to search
+ * @param   count       Number of values to exceed
+ *
+ * @return              Index of the bin, -1 if the channel does not have more than count values
+ */
+int findHistogramBin(const struct Histogram* hist, const int channel, const float count)
+{
+    const int* cumulative = hist->cumulative[channel];
+    int low = 0;
+    int high = hist->num_bins;
+
+    while (low < high)
+    {
+        const int middle = low + (high - low) / 2;
+
+        if (cumulative[middle] > count)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    return (low < hist->num_bins) ? low : -1;
+}
@@ -1,5 +1,14 @@
 #include "../Inc/hsi.h"
 
+#if SIMD_X86
+#include <immintrin.h>
+
+// Contraction into FMAs would round differently from the scalar conversions
+#define HSI_KERNEL_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+
+static void runHSIThreads(void* (*worker)(void*), const float* input, float* output, const int num_pixels);
+
 /**
 * Converts from the Hue-Saturation-Intensity color space to the RGB color space.
 *
@@ -12,48 +21,26 @@
 float* rgb2hsi(float* rgb_image, const int num_pixels)
 {
     float* hsi = malloc(sizeof(float) * num_pixels * 3);
+    rgb2hsiRef(rgb_image, hsi, num_pixels);
 
-    float* red = rgb_image;
-    float* green = &rgb_image[num_pixels];
-    float* blue = &rgb_image[num_pixels*2];
-
-    float max_rgb, min_rgb;
-    float delta;
-  
-    enum color { r, g, b };
-    enum color max_color;
-
-    struct rgbPacket max_data_idx;
+    return hsi;
+}
 
-    for (int i = 0; i < num_pixels; i++)
-    {
-        max_data_idx = getRGBMaxIndex(red[i], green[i], blue[i]);
-        max_color = max_data_idx.max_color;
-
-        max_rgb = max_data_idx.max_rgb;
-        min_rgb = getRGBMin(red[i], blue[i], green[i]);
-        delta = max_rgb - min_rgb;
-        
-        switch (max_color)
-        {
-        case r: 
-            hsi[i] = 60.0f * ((int)((green[i] - blue[i]) / (delta)) % 6);
-            break;
-
-        case g: 
-            hsi[i] = 60.0f * (((blue[i] - red[i]) / (delta)) + 2.0f);
-            break;
-
-        case b: 
-            hsi[i] = 60.0f * (((red[i] - green[i]) / (delta)) + 4.0f);
-            break;
-        }
-
-        hsi[i + num_pixels] = (max_rgb == 0) ? 0 : (delta / max_rgb);
-        hsi[i + 2 * num_pixels] = max_rgb;
-    }
+/**
+* Converts from the RGB color space to the Hue-Saturation-Intensity color space by reference. The pixels are split between
+* the threads and converted without branches (see rgb2hsiPixel), 8 at a time when the CPU has AVX2.
+*
+* @param    rgb_image   The RGB image array stored in the form [R1 R2... G1 G2... B1 B2...]
+* @param    hsi         Memory to place the HSI image to, in the form [H1 H2... S1 S2... I1 I2...]
+* @param    num_pixels  The number of pixels in the RGB image
+*
+* @return               Utilizes existing memory for the result
+*/
+void rgb2hsiRef(float* rgb_image, float* hsi, const int num_pixels)
+{
+    runHSIThreads(rgb2hsiWorker, rgb_image, hsi, num_pixels);
 
-    return hsi;
+    return;
 }
 
 /**
@@ -66,28 +53,316 @@ float* rgb2hsi(float* rgb_image, const int num_pixels)
 */
 float* hsi2rgb(float* hsi, const int num_pixels)
 {
-    // Create pointers to make indexing the image easier
-    float* hue = hsi;
-    float* sat = &hsi[num_pixels];
-    float* intensity = &hsi[2 * num_pixels];
-
     // Allocate new memory for the RGB image
     float* rgb = malloc(sizeof(float) * num_pixels * 3);
-    float* red = rgb;
-    float* green = &rgb[num_pixels];
-    float* blue = &rgb[2 * num_pixels];
+    hsi2rgbRef(hsi, rgb, num_pixels);
+
+    return rgb;
+}
+
+/**
+* Converts from the Hue-Saturation-Intensity color space to the RGB color space by reference. The pixels are split between
+* the threads and converted without branches (see hsi2rgbPixel), 8 at a time when the CPU has AVX2.
+*
+* @param    hsi         The Hue-Saturation-Intensity array stored in the form [H1 H2... S1 S2... I1 I2...]
+* @param    rgb         Memory to place the RGB image to, in the form [R1 R2... G1 G2... B1 B2...]
+* @param    num_pixels  The number of pixels in the RGB image
+*
+* @return               Utilizes existing memory for the result
+*/
+void hsi2rgbRef(float* hsi, float* rgb, const int num_pixels)
+{
+    runHSIThreads(hsi2rgbWorker, hsi, rgb, num_pixels);
 
-    float primary, secondary, tertiary;
-    for (int i = 0; i < num_pixels; i++)
+    return;
+}
+
+/**
+* Converts one pixel from RGB to HSI, computing the hue of every case and selecting one instead of branching. The
+* results are the same as the switch on getRGBMaxIndex: the maximum goes through the int of struct rgbPacket, so it is
+* truncated before blue is compared against it and the intensity is the truncated maximum.
+*
+* @param    red         Red value of the pixel
+* @param    green       Green value
+* @param    blue        Blue value
+* @param    hsi         Memory for the pixel's hue, saturation and intensity, num_pixels apart
+* @param    num_pixels  The number of pixels in the image
+*
+* @return               Utilizes existing memory for the result
+*/
+static inline void rgb2hsiPixel(const float red, const float green, const float blue, float* hsi, const int num_pixels)
+{
+    const int red_max = (red > green);
+    const float truncated = (float)(int)((red_max) ? red : green);
+    const int blue_max = (truncated < blue);
+
+    const float max_rgb = (blue_max) ? (float)(int)blue : truncated;
+    const float min_rgb = getRGBMin(red, blue, green);
+    const float delta = max_rgb - min_rgb;
+
+    const float hue_red = 60.0f * ((int)((green - blue) / (delta)) % 6);
+    const float hue_green = 60.0f * (((blue - red) / (delta)) + 2.0f);
+    const float hue_blue = 60.0f * (((red - green) / (delta)) + 4.0f);
+
+    hsi[0] = (blue_max) ? hue_blue : ((red_max) ? hue_red : hue_green);
+    hsi[num_pixels] = (max_rgb == 0) ? 0 : (delta / max_rgb);
+    hsi[2 * num_pixels] = max_rgb;
+
+    return;
+}
+
+/**
+* Converts one pixel from HSI to RGB, selecting the values of permuteColors from the sector of the hue instead of going
+* through its if chain. The secondary value is primary * (1 - ABS((int)(hue / 60.0) % 2 - 1)) as before, which is
+* -primary for even and -2 * primary for odd sectors because ABS does not parenthesize its argument.
+*
+* @param    hue         Hue of the pixel
+* @param    sat         Saturation
+* @param    intensity   Intensity
+* @param    rgb         Memory for the pixel's red, green and blue values, num_pixels apart
+* @param    num_pixels  The number of pixels in the image
+*
+* @return               Utilizes existing memory for the result
+*/
+static inline void hsi2rgbPixel(const float hue, const float sat, const float intensity, float* rgb, const int num_pixels)
+{
+    const float primary = intensity * sat;
+    const float secondary = primary * ((((int)(hue / 60.0)) & 1) ? -2 : -1);
+    const float tertiary = intensity - primary;
+
+    const float full = primary + tertiary;
+    const float part = secondary + tertiary;
+
+    // Sectors 0 to 4 cover [0, 300), everything else (including NaN) falls through to sector 5 like permuteColors
+    const int sector = (0 <= hue && hue < 360) ? (hue >= 60) + (hue >= 120) + (hue >= 180) + (hue >= 240) + (hue >= 300) : 5;
+
+    rgb[0] = (sector == 0 || sector == 5) ? full : ((sector == 1 || sector == 4) ? part : tertiary);
+    rgb[num_pixels] = (sector == 1 || sector == 2) ? full : ((sector == 0 || sector == 3) ? part : tertiary);
+    rgb[2 * num_pixels] = (sector == 3 || sector == 4) ? full : ((sector == 2 || sector == 5) ? part : tertiary);
+
+    return;
+}
+
+#if SIMD_X86
+/**
+ * 8 truncated remainders of a division by 6 at a time, like the % operator. The quotient is taken in double precision,
+ * which holds every int exactly.
+ */
+HSI_KERNEL_TARGET("avx2")
+static inline __m256i mod6AVX2(const __m256i value)
+{
+    const __m256d six = _mm256_set1_pd(6.0);
+    __m128i halves[2];
+
+    for (int h = 0; h < 2; h++)
     {
-        primary = intensity[i] * sat[i];
-        secondary = primary * (1 -ABS((int)(hue[i] / 60.0) % 2 - 1));
-        tertiary = intensity[i] - primary;
+        const __m256d x = _mm256_cvtepi32_pd((h == 0) ? _mm256_castsi256_si128(value) : _mm256_extracti128_si256(value, 1));
+        const __m256d quotient = _mm256_round_pd(_mm256_div_pd(x, six), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
 
-        permuteColors(hue[i], primary, secondary, tertiary, &red[i], &green[i], &blue[i]);
+        halves[h] = _mm256_cvttpd_epi32(_mm256_sub_pd(x, _mm256_mul_pd(quotient, six)));
     }
 
-    return rgb;
+    return _mm256_set_m128i(halves[1], halves[0]);
+}
+
+/**
+ * Converts the pixels [first, last) from RGB to HSI with AVX2, the same steps as rgb2hsiPixel
+ */
+HSI_KERNEL_TARGET("avx2")
+static void rgb2hsiAVX2(const float* rgb, float* hsi, const int num_pixels, const int first, const int last)
+{
+    const float* red = rgb;
+    const float* green = &rgb[num_pixels];
+    const float* blue = &rgb[2 * num_pixels];
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sixty = _mm256_set1_ps(60.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 four = _mm256_set1_ps(4.0f);
+    int i = first;
+
+    for (; i + 8 <= last; i += 8)
+    {
+        const __m256 r = _mm256_loadu_ps(&red[i]);
+        const __m256 g = _mm256_loadu_ps(&green[i]);
+        const __m256 b = _mm256_loadu_ps(&blue[i]);
+
+        const __m256 red_max = _mm256_cmp_ps(r, g, _CMP_GT_OQ);
+        const __m256 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_blendv_ps(g, r, red_max)));
+        const __m256 blue_max = _mm256_cmp_ps(truncated, b, _CMP_LT_OQ);
+
+        const __m256 max_rgb = _mm256_blendv_ps(truncated, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(b)), blue_max);
+        const __m256 min_rgb = _mm256_min_ps(_mm256_min_ps(r, b), g);
+        const __m256 delta = _mm256_sub_ps(max_rgb, min_rgb);
+
+        const __m256i sector = mod6AVX2(_mm256_cvttps_epi32(_mm256_div_ps(_mm256_sub_ps(g, b), delta)));
+        const __m256 hue_red = _mm256_mul_ps(sixty, _mm256_cvtepi32_ps(sector));
+        const __m256 hue_green = _mm256_mul_ps(sixty, _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(b, r), delta), two));
+        const __m256 hue_blue = _mm256_mul_ps(sixty, _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(r, g), delta), four));
+
+        const __m256 hue = _mm256_blendv_ps(_mm256_blendv_ps(hue_green, hue_red, red_max), hue_blue, blue_max);
+        const __m256 sat = _mm256_blendv_ps(_mm256_div_ps(delta, max_rgb), zero, _mm256_cmp_ps(max_rgb, zero, _CMP_EQ_OQ));
+
+        _mm256_storeu_ps(&hsi[i], hue);
+        _mm256_storeu_ps(&hsi[i + num_pixels], sat);
+        _mm256_storeu_ps(&hsi[i + 2 * num_pixels], max_rgb);
+    }
+
+    for (; i < last; i++)
+        rgb2hsiPixel(red[i], green[i], blue[i], &hsi[i], num_pixels);
+
+    return;
+}
+
+/**
+ * Converts the pixels [first, last) from HSI to RGB with AVX2, the same steps as hsi2rgbPixel
+ */
+HSI_KERNEL_TARGET("avx2")
+static void hsi2rgbAVX2(const float* hsi, float* rgb, const int num_pixels, const int first, const int last)
+{
+    const float* hue = hsi;
+    const float* sat = &hsi[num_pixels];
+    const float* intensity = &hsi[2 * num_pixels];
+
+    const __m256d sixty = _mm256_set1_pd(60.0);
+    const __m256i one = _mm256_set1_epi32(1);
+    int i = first;
+
+    for (; i + 8 <= last; i += 8)
+    {
+        const __m256 h = _mm256_loadu_ps(&hue[i]);
+        const __m256 v = _mm256_loadu_ps(&intensity[i]);
+
+        // (int)(hue / 60.0) in double precision like the scalar code, odd sectors get a factor of -2
+        const __m128i low = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(h)), sixty));
+        const __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(h, 1)), sixty));
+        const __m256i odd = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set_m128i(high, low), one), one);
+        const __m256 factor = _mm256_blendv_ps(_mm256_set1_ps(-1.0f), _mm256_set1_ps(-2.0f), _mm256_castsi256_ps(odd));
+
+        const __m256 primary = _mm256_mul_ps(v, _mm256_loadu_ps(&sat[i]));
+        const __m256 secondary = _mm256_mul_ps(primary, factor);
+        const __m256 tertiary = _mm256_sub_ps(v, primary);
+
+        const __m256 full = _mm256_add_ps(primary, tertiary);
+        const __m256 part = _mm256_add_ps(secondary, tertiary);
+
+        // Masks of sectors 0 to 4, ordered comparisons are false for NaN so it ends up in sector 5
+        const __m256 from_60 = _mm256_cmp_ps(h, _mm256_set1_ps(60.0f), _CMP_GE_OQ);
+        const __m256 from_120 = _mm256_cmp_ps(h, _mm256_set1_ps(120.0f), _CMP_GE_OQ);
+        const __m256 from_180 = _mm256_cmp_ps(h, _mm256_set1_ps(180.0f), _CMP_GE_OQ);
+        const __m256 from_240 = _mm256_cmp_ps(h, _mm256_set1_ps(240.0f), _CMP_GE_OQ);
+        const __m256 from_300 = _mm256_cmp_ps(h, _mm256_set1_ps(300.0f), _CMP_GE_OQ);
+
+        const __m256 sector_0 = _mm256_andnot_ps(from_60, _mm256_cmp_ps(h, _mm256_setzero_ps(), _CMP_GE_OQ));
+        const __m256 sector_1 = _mm256_andnot_ps(from_120, from_60);
+        const __m256 sector_2 = _mm256_andnot_ps(from_180, from_120);
+        const __m256 sector_3 = _mm256_andnot_ps(from_240, from_180);
+        const __m256 sector_4 = _mm256_andnot_ps(from_300, from_240);
+
+        __m256 r = _mm256_blendv_ps(full, part, _mm256_or_ps(sector_1, sector_4));
+        r = _mm256_blendv_ps(r, tertiary, _mm256_or_ps(sector_2, sector_3));
+
+        __m256 g = _mm256_blendv_ps(tertiary, part, _mm256_or_ps(sector_0, sector_3));
+        g = _mm256_blendv_ps(g, full, _mm256_or_ps(sector_1, sector_2));
+
+        __m256 b = _mm256_blendv_ps(part, full, _mm256_or_ps(sector_3, sector_4));
+        b = _mm256_blendv_ps(b, tertiary, _mm256_or_ps(sector_0, sector_1));
+
+        _mm256_storeu_ps(&rgb[i], r);
+        _mm256_storeu_ps(&rgb[i + num_pixels], g);
+        _mm256_storeu_ps(&rgb[i + 2 * num_pixels], b);
+    }
+
+    for (; i < last; i++)
+        hsi2rgbPixel(hue[i], sat[i], intensity[i], &rgb[i], num_pixels);
+
+    return;
+}
+#endif
+
+/**
+* Converts the pixels [first, last) of an RGB image to HSI, the argument is a struct hsi_args
+*
+* @param    vargs   Pointer to a struct hsi_args
+*
+* @return           NULL, the result is written to args->output
+*/
+void* rgb2hsiWorker(void* vargs)
+{
+    struct hsi_args* args = (struct hsi_args*)vargs;
+    const float* rgb = args->input;
+    const int num_pixels = args->num_pixels;
+
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        rgb2hsiAVX2(rgb, args->output, num_pixels, args->first, args->last);
+        return NULL;
+    }
+#endif
+
+    for (int i = args->first; i < args->last; i++)
+        rgb2hsiPixel(rgb[i], rgb[i + num_pixels], rgb[i + 2 * num_pixels], &args->output[i], num_pixels);
+
+    return NULL;
+}
+
+/**
+* Converts the pixels [first, last) of an HSI image to RGB, the argument is a struct hsi_args
+*
+* @param    vargs   Pointer to a struct hsi_args
+*
+* @return           NULL, the result is written to args->output
+*/
+void* hsi2rgbWorker(void* vargs)
+{
+    struct hsi_args* args = (struct hsi_args*)vargs;
+    const float* hsi = args->input;
+    const int num_pixels = args->num_pixels;
+
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        hsi2rgbAVX2(hsi, args->output, num_pixels, args->first, args->last);
+        return NULL;
+    }
+#endif
+
+    for (int i = args->first; i < args->last; i++)
+        hsi2rgbPixel(hsi[i], hsi[i + num_pixels], hsi[i + 2 * num_pixels], &args->output[i], num_pixels);
+
+    return NULL;
+}
+
+/**
+* Splits the pixels of an image between the threads and runs one of the conversion workers on them
+*
+* @param    worker      rgb2hsiWorker or hsi2rgbWorker
+* @param    input       The planar image to convert
+* @param    output      Memory to place the converted planar image to
+* @param    num_pixels  The number of pixels in the image
+*
+* @return               Utilizes existing memory for the result
+*/
+static void runHSIThreads(void* (*worker)(void*), const float* input, float* output, const int num_pixels)
+{
+    struct hsi_args args[MAX_THREADS];
+
+    int num_threads = (num_pixels >= MIN_PARALLEL_HSI) ? getNumThreads() : 1;
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].input = input;
+        args[i].output = output;
+        args[i].num_pixels = num_pixels;
+        args[i].first = (int)((long)num_pixels * i / num_threads);
+        args[i].last = (int)((long)num_pixels * (i + 1) / num_threads);
+    }
+
+    runParallel(worker, args, sizeof(struct hsi_args), num_threads);
+
+    return;
 }
 
 /**
@@ -138,6 +413,23 @@ float getRGBMax(const float red, const float green, const float blue)
     return max_rgb;
 }
 
+/**
+* Intensity of a pixel as rgb2hsiRef computes it, without the hue and saturation. The maximum of red and green is
+* truncated to an int (see struct rgbPacket) before blue is compared against it, and blue is truncated when it wins.
+*
+* @param    red     Red value of RGB pair
+* @param    green   Green value
+* @param    blue    Blue value
+*
+* @return           Intensity of the pixel
+*/
+float getHSIIntensity(const float red, const float green, const float blue)
+{
+    const float truncated = (float)(int)((red > green) ? red : green);
+
+    return (truncated < blue) ? (float)(int)blue : truncated;
+}
+
 /**
 * Function to correctly allocate values to RGB pixels based on the hue.
 * 
@@ -0,0 +1,245 @@
+#include "../Inc/iirblur.h"
+#include "../Inc/imfunc.h"
+#include "../Inc/parallel.h"
+
+/**
+ * Calculates the coefficients of the recursive Gaussian (Young and van Vliet, "Recursive implementation of the Gaussian filter", 1995)
+ *
+ * @param   sigma   Standard deviation of the Gaussian, at least MIN_RECURSIVE_SIGMA
+ * @param   coef    Memory to place the coefficients to
+ *
+ * @return          Fills in coef
+ */
+void calcRecursiveGaussian(const float sigma, struct RecursiveGaussian* coef)
+{
+    const double s = (sigma < MIN_RECURSIVE_SIGMA) ? MIN_RECURSIVE_SIGMA : sigma;
+
+    // Equation 11b of the paper
+    const double q = (s >= 2.5) ? 0.98711 * s - 0.96330 : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * s);
+
+    // Equation 8c
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+    const double b1 = 2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q;
+    const double b2 = -(1.4281 * q * q + 1.26661 * q * q * q);
+    const double b3 = 0.422205 * q * q * q;
+
+    coef->a1 = (float)(b1 / b0);
+    coef->a2 = (float)(b2 / b0);
+    coef->a3 = (float)(b3 / b0);
+    coef->B = (float)(1.0 - (b1 + b2 + b3) / b0);
+
+    coef->margin = RECURSIVE_MARGIN(s);
+
+    return;
+}
+
+/**
+ * Filters one row forward and backward. The zeros before the row are the initial state, the zeros after it
+ * are run through "line" (row length + margin) before the backward pass.
+ */
+static void filterRecursiveRow(const float* input, float* output, float* line, const int num_col, const struct RecursiveGaussian* coef)
+{
+    const int length = num_col + coef->margin;
+    float w1 = 0, w2 = 0, w3 = 0;
+
+    for (int n = 0; n < length; n++)
+    {
+        const float x = (n < num_col) ? input[n] : 0;
+        const float w = coef->B * x + coef->a1 * w1 + coef->a2 * w2 + coef->a3 * w3;
+
+        line[n] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    float y1 = 0, y2 = 0, y3 = 0;
+
+    for (int n = length - 1; n >= 0; n--)
+    {
+        const float y = coef->B * line[n] + coef->a1 * y1 + coef->a2 * y2 + coef->a3 * y3;
+
+        if (n < num_col)
+            output[n] = y;
+
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+    }
+
+    return;
+}
+
+/**
+ * Row n of a plane extended by the margin rows, rows outside of it read as the zero row (zero state)
+ */
+static inline float* getExtendedRow(float* plane, float* margin_rows, float* zero_row, const int num_row, const int num_col, const int length, const int n)
+{
+    if (n < 0 || n >= length)
+        return zero_row;
+
+    return (n < num_row) ? &plane[(size_t)n * num_col] : &margin_rows[(size_t)(n - num_row) * num_col];
+}
+
+/**
+ * Filters every column of a plane in place, a whole row at a time so that every access is sequential (no transpose).
+ * Rows past the bottom live in "margin_rows" (margin x num_col), "zero_row" must hold num_col zeros.
+ */
+static void filterRecursiveColumns(float* plane, float* margin_rows, float* zero_row, const int num_row, const int num_col, const struct RecursiveGaussian* coef)
+{
+    const int length = num_row + coef->margin;
+
+    // The margin rows are zero input for the forward pass
+    memset(margin_rows, 0, sizeof(float) * coef->margin * num_col);
+
+    for (int n = 0; n < length; n++)
+    {
+        float* w = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n);
+        const float* w1 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n - 1);
+        const float* w2 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n - 2);
+        const float* w3 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n - 3);
+
+        for (int col = 0; col < num_col; col++)
+            w[col] = coef->B * w[col] + coef->a1 * w1[col] + coef->a2 * w2[col] + coef->a3 * w3[col];
+    }
+
+    // Backward pass in place
+    for (int n = length - 1; n >= 0; n--)
+    {
+        float* y = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n);
+        const float* y1 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n + 1);
+        const float* y2 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n + 2);
+        const float* y3 = getExtendedRow(plane, margin_rows, zero_row, num_row, num_col, length, n + 3);
+
+        for (int col = 0; col < num_col; col++)
+            y[col] = coef->B * y[col] + coef->a1 * y1[col] + coef->a2 * y2[col] + coef->a3 * y3[col];
+    }
+
+    return;
+}
+
+/**
+ * Applies a recursive Gaussian blur to every plane of a planar image. The cost per pixel does not depend on sigma
+ * (about 8 multiply adds per direction), so it is much cheaper than a direct convolution for large blurs, at the
+ * price of approximating the Gaussian. The image is zero padded like the direct convolution.
+ *
+ * @param   image           The planar image to be blurred, [R... G... B...]
+ * @param   output          Memory to place the planar result to, may be the same as the image
+ * @param   num_channels    Number of planes in the image
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian, values below MIN_RECURSIVE_SIGMA use MIN_RECURSIVE_SIGMA
+ * @param   ws              Workspace for the margin rows and one row of scratch, NULL to allocate them
+ *
+ * @return                  Utilizes existing memory for the result
+ */
+void applyRecursiveGaussianRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma,
+    struct Workspace* ws)
+{
+    struct RecursiveGaussian coef;
+    calcRecursiveGaussian(sigma, &coef);
+
+    const size_t plane_size = (size_t)num_row * num_col;
+
+    float* margin_rows = takePlanes(ws, (size_t)coef.margin * num_col);
+    float* zero_row = takePlanes(ws, num_col);
+    float* line = takePlanes(ws, (size_t)num_col + coef.margin);
+
+    memset(zero_row, 0, sizeof(float) * num_col);
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        float* plane = &output[c * plane_size];
+
+        // Horizontal pass straight into the output, then the vertical pass in place
+        for (int row = 0; row < num_row; row++)
+            filterRecursiveRow(&image[c * plane_size + (size_t)row * num_col], &plane[(size_t)row * num_col], line, num_col, &coef);
+
+        filterRecursiveColumns(plane, margin_rows, zero_row, num_row, num_col, &coef);
+    }
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, line);
+    releasePlanes(ws, zero_row);
+    releasePlanes(ws, margin_rows);
+
+    return;
+}
+
+/**
+ * Times the direct (separable, radius of 3 sigma), recursive and stacked box Gaussian blurs of a 1920 x 1080 frame
+ * for sigma from 0.5 to 20, and reports how far the approximations are from the direct one.
+ *
+ * @return      Returns 0 if successful, -1 if memory ran out
+ */
+int runBlurBenchmark(void)
+{
+    const int num_row = 1080;
+    const int num_col = 1920;
+    const size_t num_pixels = (size_t)num_row * num_col;
+    const float sigmas[] = { 0.5f, 1.0f, 2.0f, 5.0f, 10.0f, 20.0f };
+    const int num_sigmas = sizeof(sigmas) / sizeof(sigmas[0]);
+
+    float* input = malloc(sizeof(float) * num_pixels);
+    float* direct = malloc(sizeof(float) * num_pixels);
+    float* recursive = malloc(sizeof(float) * num_pixels);
+    float* box = malloc(sizeof(float) * num_pixels);
+
+    if (input == NULL || direct == NULL || recursive == NULL || box == NULL)
+    {
+        printf("Not enough memory to benchmark the blurs.\n");
+        free(input);
+        free(direct);
+        free(recursive);
+        free(box);
+        return -1;
+    }
+
+    srand(1);
+    for (size_t i = 0; i < num_pixels; i++)
+        input[i] = rand() / (float)RAND_MAX;
+
+    printf("%dx%d frame\n", num_col, num_row);
+    printf("%6s %7s %10s | %10s %8s %10s %10s | %10s %8s %10s %10s\n", "sigma", "radius", "direct ms", "recursive", "speedup", "max error",
+        "mean error", "box ms", "speedup", "max error", "mean error");
+
+    for (int s = 0; s < num_sigmas; s++)
+    {
+        const int radius = (int)ceil(3.0 * sigmas[s]);
+
+        double start = getWallTime();
+        applyGaussianBlurChannelsRef(input, direct, 1, num_row, num_col, sigmas[s], radius, NULL);
+        const double direct_time = getWallTime() - start;
+
+        start = getWallTime();
+        applyRecursiveGaussianRef(input, recursive, 1, num_row, num_col, sigmas[s], NULL);
+        const double recursive_time = getWallTime() - start;
+
+        start = getWallTime();
+        applyStackedBoxBlurRef(input, box, 1, num_row, num_col, sigmas[s], NULL);
+        const double box_time = getWallTime() - start;
+
+        double max_error[2] = { 0 }, sum_error[2] = { 0 };
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            const double error[2] = { fabs((double)direct[i] - recursive[i]), fabs((double)direct[i] - box[i]) };
+
+            for (int j = 0; j < 2; j++)
+            {
+                max_error[j] = (error[j] > max_error[j]) ? error[j] : max_error[j];
+                sum_error[j] += error[j];
+            }
+        }
+
+        printf("%6.1f %7d %10.2f | %10.2f %8.2f %10.5f %10.6f | %10.2f %8.2f %10.5f %10.6f\n", sigmas[s], radius, direct_time * 1e3,
+            recursive_time * 1e3, direct_time / recursive_time, max_error[0], sum_error[0] / num_pixels,
+            box_time * 1e3, direct_time / box_time, max_error[1], sum_error[1] / num_pixels);
+    }
+
+    free(input);
+    free(direct);
+    free(recursive);
+    free(box);
+
+    return 0;
+}
@@ -0,0 +1,547 @@
+#include "../Inc/imbatch.h"
+#include "../Inc/imnetpbm.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+/**
+ * Checks if a file name has one of the image extensions the batch mode can read
+ *
+ * @param   file_name   File name to check
+ *
+ * @return              Returns 1 for .txt, .uwi, .ppm, .pgm and .pnm files, 0 otherwise.
+ */
+int isImageFile(const char file_name[])
+{
+    const size_t name_length = strlen(file_name);
+
+    if (strcmp(file_name, NETPBM_STDIO) == 0)
+        return 0;
+
+    if (isBinaryImageFile(file_name) || isNetpbmFile(file_name))
+        return 1;
+
+    return name_length > 4 && strcmp(&file_name[name_length - 4], ".txt") == 0;
+}
+
+/**
+ * Comparison function to sort file names with qsort
+ */
+static int compareNames(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * Adds a copy of a file name to a growing list
+ *
+ * @return      Returns 0 if successful, -1 if out of memory
+ */
+static int appendName(char*** file_names, int* num_files, int* capacity, const char* name)
+{
+    if (*num_files == *capacity)
+    {
+        *capacity = (*capacity == 0) ? 64 : *capacity * 2;
+        char** grown = realloc(*file_names, sizeof(char*) * (*capacity));
+
+        if (grown == NULL)
+            return -1;
+
+        *file_names = grown;
+    }
+
+    char* copy = malloc(strlen(name) + 1);
+    if (copy == NULL)
+        return -1;
+
+    strcpy(copy, name);
+    (*file_names)[(*num_files)++] = copy;
+
+    return 0;
+}
+
+/**
+ * Builds the list of images to process
+ *
+ * @param   input       A directory (every image in it is used, sorted by name) or "@" followed by a file with one image path per line
+ * @param   file_names  Set to a newly allocated array of newly allocated file names
+ *
+ * @return              Number of images found, -1 if the input could not be read
+ */
+int listBatchInputs(const char input[], char*** file_names)
+{
+    char path[FILENAME_MAX];
+    int num_files = 0, capacity = 0;
+    *file_names = NULL;
+
+    // File list
+    if (input[0] == '@')
+    {
+        FILE* list_file = fopen(&input[1], "r");
+        if (list_file == NULL)
+        {
+            printf("File list %s was not opened\n", &input[1]);
+            return -1;
+        }
+
+        while (fgets(path, sizeof(path), list_file) != NULL)
+        {
+            path[strcspn(path, "\r\n")] = '\0';
+
+            if (path[0] != '\0' && appendName(file_names, &num_files, &capacity, path) != 0)
+                break;
+        }
+
+        fclose(list_file);
+        return num_files;
+    }
+
+    // Directory
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    snprintf(path, sizeof(path), "%s\\*", input);
+
+    HANDLE dir = FindFirstFileA(path, &entry);
+    if (dir == INVALID_HANDLE_VALUE)
+    {
+        printf("Directory %s was not opened\n", input);
+        return -1;
+    }
+
+    do
+    {
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && isImageFile(entry.cFileName))
+        {
+            snprintf(path, sizeof(path), "%s\\%s", input, entry.cFileName);
+            if (appendName(file_names, &num_files, &capacity, path) != 0)
+                break;
+        }
+    } while (FindNextFileA(dir, &entry));
+
+    FindClose(dir);
+#else
+    DIR* dir = opendir(input);
+    if (dir == NULL)
+    {
+        printf("Directory %s was not opened\n", input);
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.' || !isImageFile(entry->d_name))
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", input, entry->d_name);
+        if (appendName(file_names, &num_files, &capacity, path) != 0)
+            break;
+    }
+
+    closedir(dir);
+#endif
+
+    if (num_files > 0)
+        qsort(*file_names, num_files, sizeof(char*), compareNames);
+
+    return num_files;
+}
+
+/**
+ * Builds the output file name of an image: output_dir/<input name without extension>_corrected.<format>
+ *
+ * @param   input           File name of the input image
+ * @param   options         Batch options with the output directory and format
+ * @param   output          Set to the output file name
+ * @param   output_size     Size of the output buffer
+ *
+ * @return                  Fills in output
+ */
+void buildOutputName(const char input[], struct BatchOptions* options, char output[], const size_t output_size)
+{
+    // Strip the directory
+    const char* base = input;
+    for (const char* c = input; *c != '\0'; c++)
+        if (*c == '/' || *c == '\\')
+            base = c + 1;
+
+    // Strip the extension, the output keeps it unless a format was requested
+    const char* ext = strrchr(base, '.');
+    const int stem_length = (ext != NULL) ? (int)(ext - base) : (int)strlen(base);
+    const char* format = (options->output_format != NULL) ? options->output_format : (ext != NULL) ? ext + 1 : "txt";
+
+    snprintf(output, output_size, "%s/%.*s_corrected.%s", options->output_dir, stem_length, base, format);
+
+    return;
+}
+
+/**
+ * Initializes an empty queue
+ */
+void initQueue(struct JobQueue* queue)
+{
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return;
+}
+
+/**
+ * Releases the synchronization objects of a queue
+ */
+void destroyQueue(struct JobQueue* queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+
+    return;
+}
+
+/**
+ * Adds a job to the queue, waiting while the queue is full
+ *
+ * @param   queue   The queue
+ * @param   job     Job to add
+ *
+ * @return          Returns once the job is in the queue
+ */
+void pushQueue(struct JobQueue* queue, struct BatchJob* job)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == QUEUE_CAPACITY)
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+
+    queue->items[(queue->head + queue->count) % QUEUE_CAPACITY] = job;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return;
+}
+
+/**
+ * Takes the oldest job from the queue, waiting while the queue is empty
+ *
+ * @param   queue   The queue
+ *
+ * @return          The job, or NULL once the queue is closed and empty
+ */
+struct BatchJob* popQueue(struct JobQueue* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == 0 && !queue->closed)
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+    struct BatchJob* job = NULL;
+
+    if (queue->count > 0)
+    {
+        job = queue->items[queue->head];
+        queue->head = (queue->head + 1) % QUEUE_CAPACITY;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return job;
+}
+
+/**
+ * Marks a queue as finished, waking up every thread waiting on it
+ */
+void closeQueue(struct JobQueue* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return;
+}
+
+/**
+ * Reserves memory from the budget, waiting until enough has been released. A single image larger than the whole budget
+ * is still let through once nothing else is in flight.
+ *
+ * @param   budget  The shared memory budget
+ * @param   bytes   Number of bytes to reserve
+ *
+ * @return          Returns once the memory is reserved
+ */
+void reserveMemory(struct MemoryBudget* budget, const size_t bytes)
+{
+    pthread_mutex_lock(&budget->lock);
+
+    while (budget->in_use > 0 && budget->in_use + bytes > budget->available)
+        pthread_cond_wait(&budget->released, &budget->lock);
+
+    budget->in_use += bytes;
+
+    pthread_mutex_unlock(&budget->lock);
+
+    return;
+}
+
+/**
+ * Returns memory to the budget
+ */
+void releaseMemory(struct MemoryBudget* budget, const size_t bytes)
+{
+    pthread_mutex_lock(&budget->lock);
+    budget->in_use -= bytes;
+    pthread_cond_broadcast(&budget->released);
+    pthread_mutex_unlock(&budget->lock);
+
+    return;
+}
+
+/**
+ * Reader stage: loads each image in order and hands it to the workers. The memory of an image is reserved from the
+ * dimensions in its header before it is loaded, so the image being read is part of the budget too.
+ *
+ * @param   vargs   Pointer to the shared struct batch_args
+ *
+ * @return          Closes the compute queue when every image has been read
+ */
+void* batchReader(void* vargs)
+{
+    struct batch_args* args = (struct batch_args*)vargs;
+
+    for (int i = 0; i < args->num_jobs; i++)
+    {
+        struct BatchJob* job = &args->jobs[i];
+
+        int num_row = 0, num_col = 0;
+
+        job->start_time = getWallTime();
+
+        if (readImageSize(job->input, &num_row, &num_col) == 0)
+        {
+            job->reserved_bytes = estimateFusionMemory(num_row, num_col);
+            reserveMemory(args->budget, job->reserved_bytes);
+
+            job->image = loadImage(job->input);
+        }
+
+        // Failed images skip the workers so the writer can report them (and release what they reserved)
+        if (job->image.rgb_image == NULL || job->image.num_row != num_row || job->image.num_col != num_col)
+        {
+            freeImage(&job->image);
+            job->status = -1;
+            pushQueue(args->write_queue, job);
+            continue;
+        }
+
+        pushQueue(args->compute_queue, job);
+    }
+
+    closeQueue(args->compute_queue);
+    return NULL;
+}
+
+/**
+ * Worker stage: enhances images until the compute queue runs dry. The last worker to finish closes the write queue.
+ * The workspace is part of the memory reserved for the image, so it is freed before the job goes to the writer,
+ * which returns that memory to the budget.
+ *
+ * @param   vargs   Pointer to the shared struct batch_args
+ *
+ * @return          Passes every job on to the writer
+ */
+void* batchWorker(void* vargs)
+{
+    struct batch_args* args = (struct batch_args*)vargs;
+    struct BatchJob* job;
+    // The cores are shared by the workers, so each stage of this worker only gets its share of them
+    setThreadLimit(args->worker_threads);
+
+    while ((job = popQueue(args->compute_queue)) != NULL)
+    {
+        struct Workspace ws = { 0 };
+        initWorkspace(&ws, calcFusionWorkspace(job->image.num_row, job->image.num_col));
+
+        job->result = malloc(sizeof(float) * job->image.num_row * job->image.num_col * NUM_CHANNELS);
+
+        if (job->result != NULL && ws.base != NULL)
+            enhanceImageRef(job->image.rgb_image, job->result, job->image.num_row, job->image.num_col, &ws);
+
+        job->status = (job->result != NULL && ws.base != NULL) ? 0 : -1;
+
+        freeWorkspace(&ws);
+        freeImage(&job->image);
+        pushQueue(args->write_queue, job);
+    }
+
+    pthread_mutex_lock(args->worker_lock);
+    if (--(*args->active_workers) == 0)
+        closeQueue(args->write_queue);
+    pthread_mutex_unlock(args->worker_lock);
+
+    return NULL;
+}
+
+/**
+ * Writer stage: writes each enhanced image and returns its memory to the budget
+ *
+ * @param   vargs   Pointer to the shared struct batch_args
+ *
+ * @return          Fills in the status and latency of every job
+ */
+void* batchWriter(void* vargs)
+{
+    struct batch_args* args = (struct batch_args*)vargs;
+    struct BatchJob* job;
+
+    while ((job = popQueue(args->write_queue)) != NULL)
+    {
+        if (job->status == 0)
+        {
+            const size_t output_length = strlen(job->output);
+
+            if (output_length > 4 && strcmp(&job->output[output_length - 4], ".txt") == 0)
+                job->status = writeImageText(job->output, job->result, job->image.num_row, job->image.num_col, args->options->text_format);
+            else
+                job->status = saveImage(job->output, job->result, job->image.num_row, job->image.num_col);
+        }
+
+        if (job->status != 0)
+            printf("Failed to process %s\n", job->input);
+
+        free(job->result);
+        job->result = NULL;
+        releaseMemory(args->budget, job->reserved_bytes);
+
+        job->latency = getWallTime() - job->start_time;
+    }
+
+    return NULL;
+}
+
+/**
+ * Comparison function to sort latencies with qsort
+ */
+static int compareLatency(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Enhances every image of a directory or file list. A reader, several workers and a writer run at the same time,
+ * joined by bounded queues, and the number of images in flight is limited by the memory budget.
+ *
+ * @param   options     Batch options
+ *
+ * @return              Returns 0 if every image was processed, -1 otherwise.
+ */
+int runBatch(struct BatchOptions* options)
+{
+    char** file_names = NULL;
+    const int num_jobs = listBatchInputs(options->input, &file_names);
+
+    if (num_jobs <= 0)
+    {
+        printf("No images to process.\n");
+        free(file_names);
+        return -1;
+    }
+
+    struct BatchJob* jobs = calloc(num_jobs, sizeof(struct BatchJob));
+    if (jobs == NULL)
+    {
+        printf("Not enough memory for the batch.\n");
+        return -1;
+    }
+
+    for (int i = 0; i < num_jobs; i++)
+    {
+        snprintf(jobs[i].input, sizeof(jobs[i].input), "%s", file_names[i]);
+        buildOutputName(file_names[i], options, jobs[i].output, sizeof(jobs[i].output));
+        free(file_names[i]);
+    }
+    free(file_names);
+
+    // Set up the queues and budget shared by the stages
+    struct JobQueue compute_queue, write_queue;
+    struct MemoryBudget budget;
+    pthread_mutex_t worker_lock;
+
+    initQueue(&compute_queue);
+    initQueue(&write_queue);
+    budget.available = options->memory_budget;
+    budget.in_use = 0;
+    pthread_mutex_init(&budget.lock, NULL);
+    pthread_cond_init(&budget.released, NULL);
+    pthread_mutex_init(&worker_lock, NULL);
+
+    int num_workers = (options->num_workers > 0) ? options->num_workers : getNumThreads();
+    num_workers = (num_workers > num_jobs) ? num_jobs : num_workers;
+    num_workers = (num_workers > MAX_THREADS) ? MAX_THREADS : num_workers;
+    int active_workers = num_workers;
+
+    // Split the threads between the workers instead of letting every worker start getNumThreads threads per stage
+    int worker_threads = getNumThreads() / num_workers;
+    worker_threads = (worker_threads < 1) ? 1 : worker_threads;
+
+    struct batch_args args = { options, jobs, num_jobs, &compute_queue, &write_queue, &budget, &active_workers, &worker_lock, worker_threads };
+
+    printf("Processing %d images with %d workers of %d threads and a %zu MB budget\n", num_jobs, num_workers, worker_threads,
+        options->memory_budget >> 20);
+
+    const double start = getWallTime();
+
+    pthread_t reader, writer, workers[MAX_THREADS];
+    pthread_create(&reader, NULL, batchReader, &args);
+    pthread_create(&writer, NULL, batchWriter, &args);
+
+    for (int i = 0; i < num_workers; i++)
+        pthread_create(&workers[i], NULL, batchWorker, &args);
+
+    pthread_join(reader, NULL);
+    for (int i = 0; i < num_workers; i++)
+        pthread_join(workers[i], NULL);
+    pthread_join(writer, NULL);
+
+    const double elapsed = getWallTime() - start;
+
+    // Throughput and latency of the images that made it through
+    double* latencies = malloc(sizeof(double) * num_jobs);
+    int num_done = 0;
+
+    for (int i = 0; i < num_jobs; i++)
+        if (jobs[i].status == 0)
+            latencies[num_done++] = jobs[i].latency;
+
+    printf("----------------------------------------------------------------------------------\n\n");
+    printf("Processed %d of %d images in %.3f seconds (%.2f images/s)\n", num_done, num_jobs, elapsed, (elapsed > 0) ? num_done / elapsed : 0.0);
+
+    if (num_done > 0)
+    {
+        qsort(latencies, num_done, sizeof(double), compareLatency);
+        printf("Latency per image: p50 %.1f ms, p99 %.1f ms\n", 1000.0 * latencies[(num_done - 1) / 2], 1000.0 * latencies[(num_done - 1) * 99 / 100]);
+    }
+
+    free(latencies);
+    free(jobs);
+    destroyQueue(&compute_queue);
+    destroyQueue(&write_queue);
+    pthread_mutex_destroy(&budget.lock);
+    pthread_cond_destroy(&budget.released);
+    pthread_mutex_destroy(&worker_lock);
+
+    return (num_done == num_jobs) ? 0 : -1;
+}
@@ -0,0 +1,415 @@
+#include "../Inc/imbinary.h"
+#include <limits.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Returns the number of bytes used by a single sample of the given type
+ *
+ * @param   sample_type     One of SAMPLE_UINT8, SAMPLE_UINT16 or SAMPLE_FLOAT32
+ *
+ * @return                  Size of a sample in bytes, 0 if the type is unknown
+ */
+size_t sampleSize(const uint32_t sample_type)
+{
+    switch (sample_type)
+    {
+    case SAMPLE_UINT8:
+        return sizeof(uint8_t);
+
+    case SAMPLE_UINT16:
+        return sizeof(uint16_t);
+
+    case SAMPLE_FLOAT32:
+        return sizeof(float);
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Maps an entire file into memory. Pages are copy-on-write so the pipeline may modify the image in place
+ * without touching the file on disk.
+ *
+ * @param   file_location   Path of the file to map
+ * @param   mapping_size    Set to the size of the mapping in bytes
+ *
+ * @return                  Pointer to the start of the mapping, NULL if the file could not be mapped
+ */
+void* mapImageFile(const char file_location[], size_t* mapping_size)
+{
+#ifdef _WIN32
+    // No mmap on Windows, fall back to a single large read
+    FILE* image_file = fopen(file_location, "rb");
+    if (image_file == NULL)
+        return NULL;
+
+    fseek(image_file, 0, SEEK_END);
+    *mapping_size = (size_t)ftell(image_file);
+    fseek(image_file, 0, SEEK_SET);
+
+    void* mapping = malloc(*mapping_size);
+    if (mapping != NULL && fread(mapping, 1, *mapping_size, image_file) != *mapping_size)
+    {
+        free(mapping);
+        mapping = NULL;
+    }
+
+    fclose(image_file);
+    return mapping;
+#else
+    int fd = open(file_location, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *mapping_size = (size_t)file_stat.st_size;
+    void* mapping = mmap(NULL, *mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    return mapping;
+#endif
+}
+
+/**
+ * Releases a mapping created while reading a binary image
+ *
+ * @param   mapping         Pointer returned by the mapping (struct Image.mapping)
+ * @param   mapping_size    Size of the mapping in bytes
+ *
+ * @return                  Unmaps the memory
+ */
+void unmapImageFile(void* mapping, const size_t mapping_size)
+{
+    if (mapping == NULL)
+        return;
+
+#ifdef _WIN32
+    (void)mapping_size;
+    free(mapping);
+#else
+    munmap(mapping, mapping_size);
+#endif
+
+    return;
+}
+
+/**
+ * Validates the header of a binary image against the size of the file it came from
+ *
+ * @param   header      The header at the start of the file
+ * @param   file_size   Total size of the file in bytes
+ *
+ * @return              Returns 0 if the header is valid, -1 otherwise.
+ */
+int checkBinaryHeader(const struct BinaryHeader* header, const size_t file_size)
+{
+    if (memcmp(header->magic, UWI_MAGIC, sizeof(header->magic)) != 0)
+    {
+        printf("File is not a binary image.\n");
+        return -1;
+    }
+
+    if (header->version != UWI_VERSION || header->byte_order != UWI_BYTE_ORDER)
+    {
+        printf("Binary image version %u or byte order is not supported.\n", header->version);
+        return -1;
+    }
+
+    const size_t sample_size = sampleSize(header->sample_type);
+
+    if (sample_size == 0 || header->num_channels != NUM_CHANNELS || header->num_row == 0 || header->num_col == 0 || header->row_stride < header->num_col)
+    {
+        printf("Binary image header is invalid.\n");
+        return -1;
+    }
+
+    // The pipeline indexes pixels with an int, so the whole image has to fit in one
+    if (header->num_row > INT_MAX || header->num_col > INT_MAX || header->row_stride > INT_MAX ||
+        (uint64_t)header->num_row * header->num_col * NUM_CHANNELS > INT_MAX)
+    {
+        printf("Binary image is too large.\n");
+        return -1;
+    }
+
+    // Samples are read in place, so every plane must start on a multiple of the sample size
+    if (header->data_offset % sample_size != 0 || header->plane_stride % sample_size != 0)
+    {
+        printf("Binary image planes are not aligned to their samples.\n");
+        return -1;
+    }
+
+    // Every plane must hold all of its rows and the last plane must end inside the file. The sizes come from the file,
+    // so the check is arranged to never wrap around.
+    const uint64_t plane_bytes = (uint64_t)header->num_row * header->row_stride * sample_size;
+
+    if (header->plane_stride < plane_bytes || header->data_offset < UWI_HEADER_SIZE || header->data_offset > file_size ||
+        plane_bytes > file_size - header->data_offset ||
+        header->plane_stride > (file_size - header->data_offset - plane_bytes) / (header->num_channels - 1))
+    {
+        printf("Binary image is truncated.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Fills out the header of a binary image whose planes are packed back to back right after the header
+ *
+ * @param   header          The header to fill out
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   sample_type     Storage type of the payload
+ *
+ * @return                  Fills in every field of the header
+ */
+void initBinaryHeader(struct BinaryHeader* header, const int num_row, const int num_col, const enum SampleType sample_type)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, UWI_MAGIC, sizeof(header->magic));
+    header->version = UWI_VERSION;
+    header->byte_order = UWI_BYTE_ORDER;
+    header->num_row = (uint32_t)num_row;
+    header->num_col = (uint32_t)num_col;
+    header->num_channels = NUM_CHANNELS;
+    header->sample_type = sample_type;
+    header->row_stride = (uint32_t)num_col;
+    header->plane_stride = (uint64_t)num_row * num_col * sampleSize(sample_type);
+    header->data_offset = UWI_HEADER_SIZE;
+
+    return;
+}
+
+/**
+ * Converts one row of binary image samples to floats between [0,1]
+ *
+ * @param   src             Samples of the row in the native byte order
+ * @param   dst             Floats to place the row to
+ * @param   num_col         Number of samples in the row
+ * @param   sample_type     One of SAMPLE_UINT8, SAMPLE_UINT16 or SAMPLE_FLOAT32
+ *
+ * @return                  Fills in num_col floats
+ */
+void convertBinaryRow(const uint8_t* src, float* dst, const int num_col, const uint32_t sample_type)
+{
+    if (sample_type == SAMPLE_UINT8)
+    {
+        for (int col = 0; col < num_col; col++)
+            dst[col] = (float)src[col] / 255.0f;
+    }
+
+    else if (sample_type == SAMPLE_UINT16)
+    {
+        const uint16_t* src16 = (const uint16_t*)src;
+        for (int col = 0; col < num_col; col++)
+            dst[col] = (float)src16[col] / 65535.0f;
+    }
+
+    else
+        memcpy(dst, src, sizeof(float) * num_col);
+
+    return;
+}
+
+/**
+ * Checks if a file name refers to a binary image based on its extension
+ *
+ * @param   file_name   File name of the image
+ *
+ * @return              Returns 1 if the file ends in UWI_EXTENSION, 0 otherwise.
+ */
+int isBinaryImageFile(const char file_name[])
+{
+    const size_t name_length = strlen(file_name);
+    const size_t ext_length = strlen(UWI_EXTENSION);
+
+    return name_length > ext_length && strcmp(&file_name[name_length - ext_length], UWI_EXTENSION) == 0;
+}
+
+/**
+ * Handles reading a binary image (.uwi). A float32 payload without row padding is used in place directly from the mapping,
+ * other sample types are converted to floats between [0,1].
+ *
+ * @param   file_name       File name of the binary image
+ *
+ * @return                  Returns a structure with the number of rows, number of columns and a pointer to the planar RGB image.
+ *                          On failure the dimensions are -1 and the image is NULL. Release the result with freeImage.
+ */
+struct Image readImageBinary(const char file_name[])
+{
+    struct Image im = { -1, -1, NULL, NULL, 0 };
+
+    size_t mapping_size = 0;
+    uint8_t* mapping = mapImageFile(file_name, &mapping_size);
+
+    if (mapping == NULL)
+    {
+        printf("File was not opened\n");
+        return im;
+    }
+
+    struct BinaryHeader header;
+
+    if (mapping_size < UWI_HEADER_SIZE)
+    {
+        printf("Binary image is truncated.\n");
+        unmapImageFile(mapping, mapping_size);
+        return im;
+    }
+
+    memcpy(&header, mapping, sizeof(header));
+
+    if (checkBinaryHeader(&header, mapping_size) != 0)
+    {
+        unmapImageFile(mapping, mapping_size);
+        return im;
+    }
+
+    const int num_row = (int)header.num_row;
+    const int num_col = (int)header.num_col;
+    const size_t num_pixels = (size_t)num_row * num_col;
+    const uint8_t* payload = &mapping[header.data_offset];
+
+    // Zero copy path: the planes are already laid out exactly like struct Image
+    if (header.sample_type == SAMPLE_FLOAT32 && header.row_stride == header.num_col &&
+        header.plane_stride == num_pixels * sizeof(float) && header.data_offset % sizeof(float) == 0)
+    {
+        im.num_row = num_row;
+        im.num_col = num_col;
+        im.rgb_image = (float*)payload;
+        im.mapping = mapping;
+        im.mapping_size = mapping_size;
+
+        return im;
+    }
+
+    // Otherwise convert each row into a newly allocated planar float buffer
+    float* rgb_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+
+    if (rgb_image == NULL)
+    {
+        printf("Not enough memory to read the binary image.\n");
+        unmapImageFile(mapping, mapping_size);
+        return im;
+    }
+
+    const size_t row_bytes = header.row_stride * sampleSize(header.sample_type);
+
+    for (int channel = 0; channel < NUM_CHANNELS; channel++)
+    {
+        for (int row = 0; row < num_row; row++)
+        {
+            const uint8_t* src = &payload[channel * header.plane_stride + row * row_bytes];
+            float* dst = &rgb_image[channel * num_pixels + (size_t)row * num_col];
+
+            convertBinaryRow(src, dst, num_col, header.sample_type);
+        }
+    }
+
+    unmapImageFile(mapping, mapping_size);
+
+    im.num_row = num_row;
+    im.num_col = num_col;
+    im.rgb_image = rgb_image;
+
+    return im;
+}
+
+/**
+ * Handles writing a planar RGB image to a binary image file (.uwi). Unlike writeImage, the file name is used as is.
+ *
+ * @param   file_name       File name of the binary image
+ * @param   image           RGB image to be written, entries between [0,1]
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   sample_type     Storage type of the payload. Integer types are quantized and clipped to [0,1]
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int writeImageBinary(const char file_name[], float* image, const int num_row, const int num_col, const enum SampleType sample_type)
+{
+    const size_t sample_size = sampleSize(sample_type);
+    const size_t num_pixels = (size_t)num_row * num_col;
+    const size_t num_rgb_pixels = num_pixels * NUM_CHANNELS;
+
+    if (sample_size == 0)
+    {
+        printf("Unknown sample type %d.\n", sample_type);
+        return -1;
+    }
+
+    struct BinaryHeader header;
+    initBinaryHeader(&header, num_row, num_col, sample_type);
+
+    FILE* image_file = fopen(file_name, "wb");
+    if (image_file == NULL)
+    {
+        printf("File could not be written to.\n");
+        return -1;
+    }
+
+    size_t written = fwrite(&header, sizeof(header), 1, image_file);
+
+    // Floats can be written straight from the image, integers are quantized first
+    if (sample_type == SAMPLE_FLOAT32)
+        written += fwrite(image, sizeof(float), num_rgb_pixels, image_file) == num_rgb_pixels;
+
+    else
+    {
+        void* quantized = malloc(sample_size * num_rgb_pixels);
+        if (quantized == NULL)
+        {
+            printf("Not enough memory to write the binary image.\n");
+            fclose(image_file);
+            return -1;
+        }
+
+        const float scale = (sample_type == SAMPLE_UINT8) ? 255.0f : 65535.0f;
+        float pixel = 0;
+
+        for (size_t i = 0; i < num_rgb_pixels; i++)
+        {
+            pixel = (image[i] < 0) ? 0 : image[i];
+            pixel = (pixel > 1) ? 1 : pixel;
+            pixel = pixel * scale + 0.5f;
+
+            if (sample_type == SAMPLE_UINT8)
+                ((uint8_t*)quantized)[i] = (uint8_t)pixel;
+            else
+                ((uint16_t*)quantized)[i] = (uint16_t)pixel;
+        }
+
+        written += fwrite(quantized, sample_size, num_rgb_pixels, image_file) == num_rgb_pixels;
+        free(quantized);
+    }
+
+    if (fclose(image_file) != 0 || written != 2)
+    {
+        printf("Binary image was not written completely.\n");
+        return -1;
+    }
+
+    printf("Image was written successfully!\n");
+
+    return 0;
+}
@@ -4,32 +4,34 @@ from PIL import Image
 def im2bitmap(filename):
 
     # Open the image file and convert it into a numpy array
-    image = Image.open(filename)
-    data = asarray(image)
+    image = Image.open(filename).convert('RGB')
+    data = np.asarray(image)
 
     ydim = data.shape[0]
     xdim = data.shape[1]
-    num_channels= data.shape[2]
+    num_channels = data.shape[2]
 
-    # Write the pixels to a text file
-    f = open(filename + "_bitmap.txt", "w")
+    # Write the dimensions followed by each channel from left to right, top to bottom (same as im2bitmap.m)
+    f = open(filename.rsplit('.', 1)[0] + "_bitmap.txt", "w")
+    f.write('%d\n%d\n' % (ydim, xdim))
 
     for channel in range(num_channels):
-        for i in range(xdim):
-            for j in range(ydim):
-                f.write('%d,' % data[i,j,channel])
+        np.savetxt(f, data[:, :, channel].reshape(-1), fmt='%d')
+
+    f.close()
 
 def bitmap2im(filename):
 
-    data = np.genfromtxt(filename)
+    data = np.loadtxt(filename)
 
-    image = np.zeros((data[0], data[1], 3))
+    ydim = int(data[0])
+    xdim = int(data[1])
 
-    for channel in range(3):
-        for i in range(data[0]):
-            for j in range(data[1]):
-                image[i,j,channel] = image(j + i*data[1] + channel*data[0]*data[1])
+    # Planar [R... G... B...] back to rows x cols x channels
+    image = data[2:2 + 3 * ydim * xdim].reshape(3, ydim, xdim).transpose(1, 2, 0)
 
-    
-            
+    # Input bitmaps hold 8 bit values, the corrected output of the C program is between [0,1]
+    if image.max() > 1:
+        image = image / 255.0
 
+    return Image.fromarray(np.uint8(np.clip(image, 0, 1) * 255 + 0.5))
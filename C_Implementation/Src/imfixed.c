@@ -0,0 +1,651 @@
+#include "../Inc/imfixed.h"
+
+/**
+ * Takes a block of 16 bit samples from the workspace, which hands out floats (two samples fit in each)
+ */
+static uint16_t* takeSamples(struct Workspace* ws, const size_t num_samples)
+{
+    return (uint16_t*)takePlanes(ws, (num_samples + 1) / 2);
+}
+
+/**
+ * Converts a float to Q15, saturating to the range of a uint16_t
+ */
+static inline uint16_t toQ15(const float value)
+{
+    if (!(value > 0))
+        return 0;
+
+    const float scaled = value * Q15_ONE + 0.5f;
+    return (scaled >= UINT16_MAX) ? UINT16_MAX : (uint16_t)scaled;
+}
+
+/**
+ * Converts floats to Q15 samples, clipping to [0, 2)
+ *
+ * @param   image           Floats to convert
+ * @param   fixed           Memory to place the samples to
+ * @param   num_samples     Number of values to convert
+ *
+ * @return                  Fills in num_samples samples
+ */
+void quantizeQ15(const float* image, uint16_t* fixed, const int num_samples)
+{
+    for (int i = 0; i < num_samples; i++)
+        fixed[i] = toQ15(image[i]);
+
+    return;
+}
+
+/**
+ * Converts Q15 samples back to floats
+ *
+ * @param   fixed           Samples to convert
+ * @param   image           Memory to place the floats to
+ * @param   num_samples     Number of values to convert
+ *
+ * @return                  Fills in num_samples floats
+ */
+void dequantizeQ15(const uint16_t* fixed, float* image, const int num_samples)
+{
+    for (int i = 0; i < num_samples; i++)
+        image[i] = fixed[i] * (1.0f / Q15_ONE);
+
+    return;
+}
+
+/**
+ * Performs all the enhancement steps with the intermediate planes stored as 16 bit fixed point (see imfixed.h for the formats).
+ * White balance, the color conversions and the final gamma correction use floats one block of pixels at a time,
+ * the convolutions, luminance, saturation, weight normalization and fusion are integer arithmetic.
+ *
+ * @param   image       RGB image with entries between [0,1]. Note that white balancing modifies it in place
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ *
+ * @return              Allocates an array with the final fused result
+ */
+float* enhanceImageFixed(float* image, const int num_row, const int num_col)
+{
+    struct Workspace ws;
+
+    if (initWorkspace(&ws, calcFixedWorkspace(num_row, num_col)) != 0)
+        return NULL;
+
+    float* reconstructed = malloc(sizeof(float) * num_row * num_col * NUM_CHANNELS);
+    enhanceImageFixedRef(image, reconstructed, num_row, num_col, &ws);
+
+    freeWorkspace(&ws);
+
+    return reconstructed;
+}
+
+/**
+ * Performs all the enhancement steps in fixed point by reference (see enhanceImageFixed)
+ *
+ * @param   image       RGB image with entries between [0,1], it holds the white balanced image afterwards
+ * @param   output      Memory to place the final fused result to
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ * @param   ws          Workspace sized by calcFixedWorkspace, NULL to allocate the temporaries
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void enhanceImageFixedRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+    const int num_rgb = num_pixels * NUM_CHANNELS;
+
+    // White balance in place with the same steps as applyWhiteBalanceRef, then store the result in Q15
+    float averages[NUM_CHANNELS];
+    float illuminants[NUM_CHANNELS] = { FIXED_ILLUMINANT_RED, FIXED_ILLUMINANT_GREEN, FIXED_ILLUMINANT_BLUE };
+    float transformation[NUM_CHANNELS * NUM_CHANNELS] = { 0 };
+
+    calcChannelAverages(image, num_pixels, averages);
+    calcGreyWorldTransform(illuminants, transformation);
+    applyWhiteBalancePixels(image, image, num_pixels, averages, 1, transformation);
+
+    uint16_t* white = takeSamples(ws, num_rgb);
+    quantizeQ15(image, white, num_rgb);
+
+    // Gamma correction through a table of every Q15 value
+    uint16_t* gamma_weight = takeSamples(ws, num_pixels);
+    uint16_t* gamma = takeSamples(ws, num_rgb);
+    uint16_t* gamma_table = takeSamples(ws, UINT16_MAX + 1);
+
+    for (int i = 0; i <= UINT16_MAX; i++)
+        gamma_table[i] = toQ15(fminf(powf(i * (1.0f / Q15_ONE), 1.2f), 1.0f));
+
+    for (int i = 0; i < num_rgb; i++)
+        gamma[i] = gamma_table[white[i]];
+
+    releasePlanes(ws, (float*)gamma_table);
+
+    getWeightsFixed(gamma, gamma_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, (float*)gamma);
+
+    uint16_t* sharp_weight = takeSamples(ws, num_pixels);
+    uint16_t* sharp = takeSamples(ws, num_rgb);
+    applyUnsharpMaskFixed(white, sharp, num_row, num_col, ws);
+    getWeightsFixed(sharp, sharp_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, (float*)sharp);
+
+    applyFusionFixed(white, gamma_weight, sharp_weight, output, num_pixels, ws);
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)sharp_weight);
+    releasePlanes(ws, (float*)gamma_weight);
+    releasePlanes(ws, (float*)white);
+
+    return;
+}
+
+/**
+ * Returns the workspace size needed for enhanceImageFixedRef to run without any allocation
+ *
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ *
+ * @return              Number of bytes to initialize the workspace with
+ */
+size_t calcFixedWorkspace(const int num_row, const int num_col)
+{
+    const size_t table_bytes = sizeof(float) * (Q15_ONE + 1) + WORKSPACE_ALIGNMENT;
+
+    return FIXED_WORKSPACE_PLANES * calcPlaneBytes(num_row, num_col) + table_bytes;
+}
+
+/**
+ * Computes, normalizes and combines the Laplacian, Saliency, and Saturation Weights in fixed point (see getWeightsRef)
+ *
+ * @param   image       Q15 RGB image
+ * @param   weight      Memory to place the Q14 combined weight to
+ * @param	num_row		Number of rows in the image
+ * @param	num_col		Number of columns in the image
+ * @param	lum_option	Determines which method used to calculate luminance (see calcLuminance)
+ * @param	ws			Workspace for temporaries, NULL to allocate them
+ *
+ * @return				Utilizes existing memory for the result
+ */
+void getWeightsFixed(uint16_t* image, uint16_t* weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+
+    // Laplacian magnitude is Q12 so that 8 * 2.0 still fits
+    const int16_t lap_filter[9] = { -1, -1, -1, -1, 8, -1, -1, -1, -1 };
+
+    uint16_t* lum = takeSamples(ws, num_pixels);
+    uint16_t* temp = takeSamples(ws, num_pixels);
+
+    calcLuminanceFixed(image, lum, num_pixels, lum_option);
+
+    convHelperFixed(lum, lap_filter, temp, num_row, num_col, 3, Q15_SHIFT - Q12_SHIFT, 1, ws);
+    normalizeWeightFixed(temp, num_pixels);
+
+    for (int i = 0; i < num_pixels; i++)
+        weight[i] = (uint16_t)((temp[i] + 1) >> 1);
+
+    calcSaliencyWeightFixed(image, temp, num_row, num_col, ws);
+    normalizeWeightFixed(temp, num_pixels);
+
+    for (int i = 0; i < num_pixels; i++)
+        weight[i] += (uint16_t)((temp[i] + 1) >> 1);
+
+    calcSaturationWeightFixed(image, lum, temp, num_pixels);
+    normalizeWeightFixed(temp, num_pixels);
+
+    for (int i = 0; i < num_pixels; i++)
+        weight[i] += (uint16_t)((temp[i] + 1) >> 1);
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)temp);
+    releasePlanes(ws, (float*)lum);
+
+    return;
+}
+
+/**
+ * Calculates the luminance of a Q15 image with integer weights that add up to exactly 1.0
+ *
+ * @param	image		Q15 RGB image
+ * @param	lum			Memory to place the Q15 luminance to
+ * @param	num_pixels	The number of pixels in the image
+ * @param	lum_option	0: Standard, 1: Percieved option, 2: Percieved option exact
+ *
+ * @return				Utilizes existing memory for the result
+ */
+void calcLuminanceFixed(uint16_t* image, uint16_t* lum, const int num_pixels, const int lum_option)
+{
+    uint16_t* red = image;
+    uint16_t* green = &image[num_pixels];
+    uint16_t* blue = &image[num_pixels * 2];
+
+    // Weights of calcLuminanceRef in Q15
+    const uint32_t weights[2][NUM_CHANNELS] = { { 6966, 23436, 2366 }, { 9798, 19235, 3735 } };
+    const uint32_t* w = weights[(lum_option == 0) ? 0 : 1];
+
+    if (lum_option == 2)
+    {
+        for (int i = 0; i < num_pixels; i++)
+        {
+            const uint64_t sum = (uint64_t)w[0] * red[i] * red[i] + (uint64_t)w[1] * green[i] * green[i] + (uint64_t)w[2] * blue[i] * blue[i];
+            lum[i] = (uint16_t)sqrt((double)(sum >> Q15_SHIFT));
+        }
+    }
+
+    else
+    {
+        for (int i = 0; i < num_pixels; i++)
+            lum[i] = (uint16_t)((w[0] * red[i] + w[1] * green[i] + w[2] * blue[i] + (1u << (Q15_SHIFT - 1))) >> Q15_SHIFT);
+    }
+
+    return;
+}
+
+/**
+ * Calculates the saliency weight of a Q15 image (see calcSaliencyWeight). Like the float version, the blurred red channel
+ * is used for all three channels. The LAB planes are stored as int16 with LAB_SHIFT fraction bits.
+ *
+ * @param	image		Q15 RGB image
+ * @param	sal_weight	Memory to place the saliency weight (LAB_SHIFT fraction bits, not normalized) to
+ * @param	num_row		The number of rows of the image
+ * @param	num_col		The number of columns of the image
+ * @param	ws			Workspace for temporaries, NULL to allocate them
+ *
+ * @return				Utilizes existing memory for the result
+ */
+void calcSaliencyWeightFixed(uint16_t* image, uint16_t* sal_weight, const int num_row, const int num_col, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+    const int16_t gaussian_filter[9] = { 370, 2746, 370, 2746, 20293, 2746, 370, 2746, 370 };
+    const float lab_scale = (float)(1 << LAB_SHIFT);
+
+    uint16_t* blurred = takeSamples(ws, num_pixels);
+    int16_t* lab = (int16_t*)takeSamples(ws, (size_t)num_pixels * NUM_CHANNELS);
+
+    convHelperFixed(image, gaussian_filter, blurred, num_row, num_col, 3, Q15_SHIFT, 0, ws);
+
+    // Convert to LAB a block at a time with the fused kernel of the float pipeline (see rgb2LABWorker) and sum up each plane
+    float rgb[NUM_CHANNELS * FIXED_BLOCK_PIXELS];
+    float lab_block[NUM_CHANNELS * FIXED_BLOCK_PIXELS];
+    int64_t lab_sum[NUM_CHANNELS] = { 0 };
+
+    struct lab_args block_args = { 0 };
+    block_args.image = rgb;
+    block_args.lab = lab_block;
+    block_args.planes = LAB_PLANES_ALL;
+    block_args.table = getLABTable();
+
+    for (int first = 0; first < num_pixels; first += FIXED_BLOCK_PIXELS)
+    {
+        const int count = (num_pixels - first < FIXED_BLOCK_PIXELS) ? num_pixels - first : FIXED_BLOCK_PIXELS;
+
+        for (int c = 0; c < NUM_CHANNELS; c++)
+            dequantizeQ15(&blurred[first], &rgb[c * count], count);
+
+        // The block's planes are "count" apart
+        block_args.num_pixels = count;
+        block_args.last = count;
+        rgb2LABWorker(&block_args);
+
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                const float value = lab_block[c * count + i] * lab_scale;
+                const int16_t stored = (int16_t)((value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : lrintf(value));
+
+                lab[c * num_pixels + first + i] = stored;
+                lab_sum[c] += stored;
+            }
+        }
+    }
+
+    // Distance of each pixel to the average LAB value
+    int32_t lab_avg[NUM_CHANNELS];
+    for (int c = 0; c < NUM_CHANNELS; c++)
+        lab_avg[c] = (int32_t)(lab_sum[c] / num_pixels);
+
+    for (int i = 0; i < num_pixels; i++)
+    {
+        const int64_t dl = lab[i] - lab_avg[0];
+        const int64_t da = lab[num_pixels + i] - lab_avg[1];
+        const int64_t db = lab[2 * num_pixels + i] - lab_avg[2];
+        const uint64_t distance = (uint64_t)sqrt((double)(dl * dl + da * da + db * db));
+
+        sal_weight[i] = (uint16_t)((distance > UINT16_MAX) ? UINT16_MAX : distance);
+    }
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)lab);
+    releasePlanes(ws, (float*)blurred);
+
+    return;
+}
+
+/**
+ * Calculates the saturation weight of a Q15 image (see calcSaturationWeight) with an integer sum of squares
+ *
+ * @param	image		Q15 RGB image
+ * @param	lum			Q15 luminance of each pixel of "image"
+ * @param	sat_weight	Memory to place the Q15 saturation weight (not normalized) to
+ * @param	num_pixels	The size of the image
+ *
+ * @return				Utilizes existing memory for the result
+ */
+void calcSaturationWeightFixed(uint16_t* image, uint16_t* lum, uint16_t* sat_weight, const int num_pixels)
+{
+    uint16_t* red = image;
+    uint16_t* green = &image[num_pixels];
+    uint16_t* blue = &image[num_pixels * 2];
+
+    for (int i = 0; i < num_pixels; i++)
+    {
+        const int64_t dr = (int64_t)red[i] - lum[i];
+        const int64_t dg = (int64_t)green[i] - lum[i];
+        const int64_t db = (int64_t)blue[i] - lum[i];
+
+        // Sum of squares is Q30, so its square root is Q15
+        const uint64_t mean_square = (uint64_t)(dr * dr + dg * dg + db * db) / 3;
+        const uint64_t saturation = (uint64_t)sqrt((double)mean_square);
+
+        sat_weight[i] = (uint16_t)((saturation > UINT16_MAX) ? UINT16_MAX : saturation);
+    }
+
+    return;
+}
+
+/**
+ * Normalizes a weight map by its maximum into Q15 (see normalizeWeight). A weight map of zeros stays zero.
+ *
+ * @param	weight		The weight map to normalize, any fixed point format
+ * @param	num_pixels	The number of pixels in the weight map
+ *
+ * @return				Modifies the weight map, it is Q15 between [0, 1] afterwards
+ */
+void normalizeWeightFixed(uint16_t* weight, const int num_pixels)
+{
+    uint16_t max = 0;
+
+    for (int i = 0; i < num_pixels; i++)
+        max = (weight[i] > max) ? weight[i] : max;
+
+    if (max == 0)
+        return;
+
+    // Multiply by the reciprocal of the maximum with 32 fraction bits instead of dividing every pixel
+    const uint64_t scale = ((uint64_t)Q15_ONE << 32) / max;
+
+    for (int i = 0; i < num_pixels; i++)
+        weight[i] = (uint16_t)(((uint64_t)weight[i] * scale + ((uint64_t)1 << 31)) >> 32);
+
+    return;
+}
+
+/**
+ * Applies the normalized unsharp masking process (see applyUnsharpMask) to a Q15 image. The mask |I - G * I| is computed with the
+ * integer blur, its HSI conversion and equalization use floats one block at a time (twice: once for the histogram, once to apply it).
+ *
+ * @param	image		Q15 RGB image
+ * @param	sharp		Memory to place the Q15 sharpened image to
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ * @param	ws			Workspace for temporaries, NULL to allocate them
+ *
+ * @return				Utilizes existing memory for the result
+ */
+void applyUnsharpMaskFixed(uint16_t* image, uint16_t* sharp, const int num_row, const int num_col, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+    const int num_rgb = num_pixels * NUM_CHANNELS;
+    const int16_t gaussian_filter[9] = { 370, 2746, 370, 2746, 20293, 2746, 370, 2746, 370 };
+
+    // Mask = |I - G * I|
+    uint16_t* mask = takeSamples(ws, num_rgb);
+
+    for (int c = 0; c < NUM_CHANNELS; c++)
+        convHelperFixed(&image[c * num_pixels], gaussian_filter, &mask[c * num_pixels], num_row, num_col, 3, Q15_SHIFT, 0, ws);
+
+    for (int i = 0; i < num_rgb; i++)
+        mask[i] = (uint16_t)((image[i] > mask[i]) ? image[i] - mask[i] : mask[i] - image[i]);
+
+    float rgb[NUM_CHANNELS * FIXED_BLOCK_PIXELS];
+    float hsi[NUM_CHANNELS * FIXED_BLOCK_PIXELS];
+    int64_t histogram[EQUALIZATION_BINS] = { 0 };
+    int new_grey[EQUALIZATION_BINS] = { 0 };
+
+    // The rgb and hsi blocks use planes "count" apart so the float conversions can be used as is
+    for (int first = 0; first < num_pixels; first += FIXED_BLOCK_PIXELS)
+    {
+        const int count = (num_pixels - first < FIXED_BLOCK_PIXELS) ? num_pixels - first : FIXED_BLOCK_PIXELS;
+
+        for (int c = 0; c < NUM_CHANNELS; c++)
+            dequantizeQ15(&mask[c * num_pixels + first], &rgb[c * count], count);
+
+        rgb2hsiRef(rgb, hsi, count);
+        calcIntensityHistogram(&hsi[2 * count], count, histogram);
+    }
+
+    calcEqualizationTable(histogram, num_pixels, new_grey);
+
+    for (int first = 0; first < num_pixels; first += FIXED_BLOCK_PIXELS)
+    {
+        const int count = (num_pixels - first < FIXED_BLOCK_PIXELS) ? num_pixels - first : FIXED_BLOCK_PIXELS;
+
+        for (int c = 0; c < NUM_CHANNELS; c++)
+            dequantizeQ15(&mask[c * num_pixels + first], &rgb[c * count], count);
+
+        rgb2hsiRef(rgb, hsi, count);
+        applyEqualizationTable(&hsi[2 * count], count, new_grey);
+        hsi2rgbRef(hsi, rgb, count);
+
+        // sharpened = (image + normalized) / 2
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                const int index = c * num_pixels + first + i;
+                sharp[index] = (uint16_t)((image[index] + toQ15(rgb[c * count + i]) + 1) >> 1);
+            }
+        }
+    }
+
+    releasePlanes(ws, (float*)mask);
+
+    return;
+}
+
+/**
+ * Applies Image Fusion in fixed point (see applyFusionRef). The weights are normalized with integer division, and the
+ * final gamma correction of 0.7 reads the float result straight from a table of every Q15 value in [0, 1].
+ *
+ * @param   white_image     Q15 white balanced image
+ * @param   gamma_weight    Q14 combined weight of the gamma corrected image
+ * @param   sharp_weight    Q14 combined weight of the sharpened image
+ * @param   corrected       Memory to place the final float result to
+ * @param   num_pixels      Number of pixels in the image
+ * @param   ws              Workspace for the gamma table, NULL to allocate it
+ *
+ * @return                  Utilizes existing memory for the result
+ */
+void applyFusionFixed(uint16_t* white_image, uint16_t* gamma_weight, uint16_t* sharp_weight, float* corrected, const int num_pixels, struct Workspace* ws)
+{
+    const uint32_t regularization = (uint32_t)(REGULARIZATION * (1 << Q14_SHIFT) + 0.5);
+
+    float* gamma_table = takePlanes(ws, Q15_ONE + 1);
+
+    for (int i = 0; i <= Q15_ONE; i++)
+        gamma_table[i] = fminf(powf(i * (1.0f / Q15_ONE), 0.7f), 1.0f);
+
+    for (int i = 0; i < num_pixels; i++)
+    {
+        // Same normalization as normalizeFusionWeights, including its use of the updated gamma weight
+        const uint32_t gw = gamma_weight[i];
+        const uint32_t sw = sharp_weight[i];
+        const uint32_t gw_norm = ((gw + regularization) << Q14_SHIFT) / (sw + gw + 2 * regularization);
+        const uint32_t sw_norm = ((sw + regularization) << Q14_SHIFT) / (sw + gw_norm + 2 * regularization);
+        const uint32_t total = gw_norm + sw_norm;
+
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+            const int index = c * num_pixels + i;
+            const uint32_t fused = (white_image[index] * total + (1u << (Q14_SHIFT - 1))) >> Q14_SHIFT;
+
+            // Everything above 1.0 is clipped by the gamma correction anyway
+            corrected[index] = gamma_table[(fused > Q15_ONE) ? Q15_ONE : fused];
+        }
+    }
+
+    releasePlanes(ws, gamma_table);
+
+    return;
+}
+
+/**
+ * Counts the samples of an image that are NaN or infinite, the float pipeline gives NaNs when a weight maximum is 0
+ * (eg: the Laplacian of a 1 x 1 image)
+ *
+ * @param   image           The image to check
+ * @param   num_samples     Number of values in the image
+ *
+ * @return                  Number of samples that are not finite
+ */
+static size_t countNonFinite(const float* image, const size_t num_samples)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < num_samples; i++)
+        count += !isfinite(image[i]);
+
+    return count;
+}
+
+/**
+ * Calculates the peak signal to noise ratio of an image against a reference
+ *
+ * @param   reference       The reference image, entries between [0,1]
+ * @param   image           The image to compare
+ * @param   num_samples     Number of values in each image
+ * @param   levels          0 to compare the floats directly, otherwise the largest sample value both are quantized to first (eg: 255)
+ *
+ * @return                  PSNR in dB, INFINITY if the images are identical, NAN if either has a NaN or infinite sample
+ */
+double calcPSNR(const float* reference, const float* image, const size_t num_samples, const int levels)
+{
+    double squared_error = 0;
+
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        double a = reference[i], b = image[i];
+
+        if (levels > 0)
+        {
+            a = floor(((a < 0) ? 0 : (a > 1) ? 1 : a) * levels + 0.5) / levels;
+            b = floor(((b < 0) ? 0 : (b > 1) ? 1 : b) * levels + 0.5) / levels;
+        }
+
+        squared_error += (a - b) * (a - b);
+    }
+
+    if (squared_error == 0)
+        return INFINITY;
+
+    return 10.0 * log10(num_samples / squared_error);
+}
+
+/**
+ * Enhances an image with the fixed point pipeline and writes it. The report also runs the float pipeline on the same image
+ * and prints the accuracy (PSNR of the floats and of 8 bit output), the time and the workspace of both.
+ *
+ * @param   input_name      Image to enhance (see loadImage)
+ * @param   output_name     Image to write (see saveImage)
+ * @param   report          1 to compare against the float pipeline
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int runFixed(const char input_name[], const char output_name[], const int report)
+{
+    struct Image rgb = loadImage(input_name);
+
+    if (rgb.rgb_image == NULL)
+        return -1;
+
+    const int num_row = rgb.num_row;
+    const int num_col = rgb.num_col;
+    const size_t num_rgb = (size_t)num_row * num_col * NUM_CHANNELS;
+
+    // White balance works in place, so the float pipeline needs its own copy of the input
+    float* copy = report ? malloc(sizeof(float) * num_rgb) : NULL;
+    float* fixed = malloc(sizeof(float) * num_rgb);
+    struct Workspace ws;
+
+    if ((report && copy == NULL) || fixed == NULL || initWorkspace(&ws, calcFixedWorkspace(num_row, num_col)) != 0)
+    {
+        printf("Not enough memory to enhance the image.\n");
+        free(copy);
+        free(fixed);
+        freeImage(&rgb);
+        return -1;
+    }
+
+    if (report)
+        memcpy(copy, rgb.rgb_image, sizeof(float) * num_rgb);
+
+    double start = getWallTime();
+    enhanceImageFixedRef(rgb.rgb_image, fixed, num_row, num_col, &ws);
+    const double fixed_time = getWallTime() - start;
+    const size_t fixed_peak = ws.peak;
+    freeWorkspace(&ws);
+
+    int status = saveImage(output_name, fixed, num_row, num_col);
+
+    if (report)
+    {
+        float* reference = malloc(sizeof(float) * num_rgb);
+
+        if (reference == NULL || initWorkspace(&ws, calcFusionWorkspace(num_row, num_col)) != 0)
+        {
+            printf("Not enough memory for the float pipeline.\n");
+            free(reference);
+            status = -1;
+        }
+
+        else
+        {
+            start = getWallTime();
+            enhanceImageRef(copy, reference, num_row, num_col, &ws);
+            const double float_time = getWallTime() - start;
+
+            printf("Fixed point accuracy for %s (%d x %d)\n", input_name, num_col, num_row);
+            // A PSNR against NaNs would print as -nan, so say which image has them instead
+            const size_t reference_bad = countNonFinite(reference, num_rgb);
+            const size_t fixed_bad = countNonFinite(fixed, num_rgb);
+
+            if (reference_bad > 0 || fixed_bad > 0)
+            {
+                if (reference_bad > 0)
+                    printf("  PSNR          : reference contains NaN (%zu of %zu samples are not finite)\n", reference_bad, num_rgb);
+                if (fixed_bad > 0)
+                    printf("  PSNR          : fixed point result contains NaN (%zu of %zu samples are not finite)\n", fixed_bad, num_rgb);
+            }
+
+            else
+            {
+                printf("  PSNR (float)  : %.2f dB\n", calcPSNR(reference, fixed, num_rgb, 0));
+                printf("  PSNR (8 bit)  : %.2f dB\n", calcPSNR(reference, fixed, num_rgb, 255));
+            }
+
+            printf("  Time          : %.3f s fixed, %.3f s float\n", fixed_time, float_time);
+            printf("  Workspace peak: %.1f MB fixed, %.1f MB float\n", fixed_peak / 1048576.0, ws.peak / 1048576.0);
+
+            freeWorkspace(&ws);
+            free(reference);
+        }
+    }
+
+    free(copy);
+    free(fixed);
+    freeImage(&rgb);
+
+    return status;
+}
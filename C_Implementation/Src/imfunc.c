@@ -1,4 +1,14 @@
 #include "../Inc/imfunc.h"
+#include "../Inc/imbinary.h"
+#include "../Inc/imtext.h"
+#include "../Inc/imnetpbm.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 /**
 * Reciprocal Square Root Function
@@ -50,21 +60,46 @@ float calcAverage(float* image, const int num_pixels)
 * @return              Creates a new array containing the gamma corrected image
 */
 float* correctGamma(float* image, const int num_pixels, const float gamma)
+{
+    float* gamma_image = malloc(sizeof(float) * 3 * num_pixels);
+    correctGammaRef(image, gamma_image, num_pixels, gamma);
+
+    return gamma_image;
+}
+
+/**
+* Applies gamma correction to an image and clips the value between [0,1] by reference.
+* 
+* @param   image       Array containing the RGB image to apply correction to
+* @param   gamma_image Memory to place the result to (may be the same as image)
+* @param   num_pixels  Number of pixels in the RGB image
+* @param   gamma       Amount of gamma correction to apply. corr_img = img^(gamma)
+* 
+* @return              Utilizes existing memory for the result. With TRANSFER_TABLES the power comes from a table (see transfer.h),
+*                      with SIMD_MATH from the vectorized fastPow (see simdmath.h)
+*/
+void correctGammaRef(float* image, float* gamma_image, const int num_pixels, const float gamma)
 {
     const int rgb_size = 3 * num_pixels;
 
-    float* gamma_image = malloc(sizeof(float) * rgb_size);
+#if TRANSFER_TABLES
+    applyTransfer(TRANSFER_POWER, gamma, image, gamma_image, rgb_size);
+#elif SIMD_MATH
+    powArray(image, gamma_image, rgb_size, gamma);
+#endif
 
     for (int i = 0; i < rgb_size; i++)
     {
+#if !TRANSFER_TABLES && !SIMD_MATH
         gamma_image[i] = (float) pow(image[i], gamma);
+#endif
 
         // Confine resulting value to between 0 and 1
         gamma_image[i] = (gamma_image[i] < 0) ? 0 : gamma_image[i];
         gamma_image[i] = (gamma_image[i] > 1) ? 1 : gamma_image[i];
     }
 
-    return gamma_image;
+    return;
 }
 
 /**
@@ -93,18 +128,155 @@ float* applyGaussianBlur(float* image, const int num_row, const int num_col)
  * @param   output          Memory to place the result to
  * @param	num_row		    Number of rows in the image
  * @param	num_col		    Number of columns in the image
+ * @param   ws              Workspace for temporaries, NULL to allocate them
  * 
  * @return                  Utilizes existing memory for the result
  */
-void applyGaussianBlurRef(float* image, float* output, const int num_row, const int num_col)
+void applyGaussianBlurRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws)
 {
     // Convolve "image" with the blur matrix (3x3)
     float gaussian_filter[9] = { 0.0113, 0.0838, 0.0113, 0.0838, 0.6193, 0.0838, 0.0113, 0.0838, 0.0113 };
     
-    convHelper(image, gaussian_filter, output, num_row, num_col, 3);
+    convHelper(image, gaussian_filter, output, num_row, num_col, 3, ws);
+    return;
+}
+
+/**
+ * Applies Gaussian blur with a separable kernel of any standard deviation and radius
+ * 
+ * @param   image           The image to be blurred (must be 2D! to do RGB, apply this function 3 times on each channel)
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   radius          Number of taps on each side of the center, the kernel is (2 * radius + 1) x (2 * radius + 1)
+ * 
+ * @return                  Allocates new memory for the resulting blurred image
+ */
+float* applyGaussianBlurSeparable(float* image, const int num_row, const int num_col, const float sigma, const int radius)
+{
+    float* output = malloc(sizeof(float) * num_row * num_col);
+    applyGaussianBlurSeparableRef(image, output, num_row, num_col, sigma, radius, NULL);
+
+    return output;
+}
+
+/**
+ * Applies Gaussian blur with a separable kernel by reference: a horizontal pass followed by a vertical pass, so the cost
+ * grows linearly with the radius. GAUSSIAN_SIGMA and GAUSSIAN_RADIUS give the same kernel as applyGaussianBlurRef (unrounded).
+ * 
+ * @param   image           The image to be blurred (must be 2D! to do RGB, apply this function 3 times on each channel)
+ * @param   output          Memory to place the result to, may not overlap the image
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   radius          Number of taps on each side of the center, at most MAX_GAUSSIAN_RADIUS
+ * @param   ws              Workspace for the horizontal pass, NULL to allocate it
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyGaussianBlurSeparableRef(float* image, float* output, const int num_row, const int num_col, const float sigma, const int radius, struct Workspace* ws)
+{
+    float kernel[2 * MAX_GAUSSIAN_RADIUS + 1];
+    const int kernel_size = calcGaussianKernel(sigma, radius, kernel);
+
+    convSeparable(image, kernel, kernel, output, num_row, num_col, kernel_size, ws);
     return;
 }
 
+/**
+ * Applies Gaussian blur to every plane of a planar image in one pass (see convSeparableChannels), the result of
+ * each plane is the same as applyGaussianBlurSeparableRef on its own
+ * 
+ * @param   image           The planar image to be blurred, [R... G... B...]
+ * @param   output          Memory to place the planar result to, may not overlap the image
+ * @param   num_channels    Number of planes in the image
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   radius          Number of taps on each side of the center, at most MAX_GAUSSIAN_RADIUS
+ * @param   ws              Workspace for the rows of the horizontal pass, NULL to allocate them
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyGaussianBlurChannelsRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, const int radius,
+    struct Workspace* ws)
+{
+    float kernel[2 * MAX_GAUSSIAN_RADIUS + 1];
+    const int kernel_size = calcGaussianKernel(sigma, radius, kernel);
+
+    convSeparableChannels(image, num_channels, (size_t)num_row * num_col, num_col, kernel, kernel, output, LAYOUT_PLANAR, num_row, num_col, kernel_size, ws);
+    return;
+}
+
+/**
+ * Applies Gaussian blur to every plane of a planar image with either the direct or the recursive filter
+ * 
+ * @param   image           The planar image to be blurred, [R... G... B...]
+ * @param   output          Memory to place the planar result to, may not overlap the image
+ * @param   num_channels    Number of planes in the image
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   radius          Number of taps on each side of the center of the direct filter (unused by the others)
+ * @param   blur_mode       BLUR_DIRECT (see applyGaussianBlurChannelsRef), BLUR_RECURSIVE (see applyRecursiveGaussianRef)
+ *                          or BLUR_BOX (see applyStackedBoxBlurRef)
+ * @param   ws              Workspace for temporaries, NULL to allocate them
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyGaussianBlurModeRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, const int radius,
+    const int blur_mode, struct Workspace* ws)
+{
+    if (blur_mode == BLUR_RECURSIVE)
+        applyRecursiveGaussianRef(image, output, num_channels, num_row, num_col, sigma, ws);
+
+    else if (blur_mode == BLUR_BOX)
+        applyStackedBoxBlurRef(image, output, num_channels, num_row, num_col, sigma, ws);
+
+    else
+        applyGaussianBlurChannelsRef(image, output, num_channels, num_row, num_col, sigma, radius, ws);
+
+    return;
+}
+
+/**
+ * Fills in a normalized 1D Gaussian kernel, the 2D kernel is its outer product with itself
+ * 
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   radius          Number of taps on each side of the center, clamped to [0, MAX_GAUSSIAN_RADIUS]
+ * @param   kernel          Memory to place the 2 * radius + 1 taps to
+ * 
+ * @return                  The number of taps in the kernel
+ */
+int calcGaussianKernel(const float sigma, const int radius, float* kernel)
+{
+    int size = 2 * radius + 1;
+
+    if (radius < 0 || radius > MAX_GAUSSIAN_RADIUS)
+    {
+        printf("Gaussian radius %d is out of range, using %d.\n", radius, (radius < 0) ? 0 : MAX_GAUSSIAN_RADIUS);
+        size = (radius < 0) ? 1 : 2 * MAX_GAUSSIAN_RADIUS + 1;
+    }
+
+    const int center = size / 2;
+    double sum = 0;
+
+    // A sigma of zero (or less) degenerates to the identity
+    for (int i = 0; i < size; i++)
+    {
+        const double x = i - center;
+        const double tap = (sigma > 0) ? exp(-(x * x) / (2.0 * sigma * sigma)) : (i == center);
+
+        kernel[i] = (float)tap;
+        sum += tap;
+    }
+
+    for (int i = 0; i < size; i++)
+        kernel[i] = (float)(kernel[i] / sum);
+
+    return size;
+}
+
 /**
  * Applies Laplacian edge detection using a 3 x 3 kernel
  * 
@@ -124,6 +296,43 @@ float* applyLaplacian(float* image, const int num_row, const int num_col)
     return output;
 }
 
+/**
+ * Applies Laplacian edge detection using a 3 x 3 kernel by reference
+ * 
+ * @param   image           The input image (must be 2D! to do RGB, apply this function on the greyscale version)
+ * @param   output          Memory to place the result to
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   ws              Workspace for temporaries, NULL to allocate them
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyLaplacianRef(float* image, float* output, const int num_row, const int num_col, struct Workspace* ws)
+{
+    // Convolve "image" with the laplacian matrix (3x3)
+    float lap_filter[9] = {-1.0, -1.0, -1.0, -1.0, 8.0, -1.0, -1.0, -1.0, -1.0};
+
+    convHelper(image, lap_filter, output, num_row, num_col, 3, ws);
+    return;
+}
+
+/**
+ * Applies Laplacian edge detection using a 3 x 3 kernel and takes the absolute value, in a single pass (see convPlaneAbsMax)
+ * 
+ * @param   image           The input image (must be 2D! to do RGB, apply this function on the greyscale version)
+ * @param   output          Memory to place the absolute value of the result to
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * 
+ * @return                  Utilizes existing memory for the result, returns its maximum
+ */
+float applyLaplacianAbsRef(float* image, float* output, const int num_row, const int num_col)
+{
+    float lap_filter[9] = {-1.0, -1.0, -1.0, -1.0, 8.0, -1.0, -1.0, -1.0, -1.0};
+
+    return convPlaneAbsMax(image, lap_filter, output, num_row, num_col, 3);
+}
+
 /**
  * Calcualtes the squared Euclidian Distance between two points (x1, y1, z1) and (x2, y2, z2)
  * ie: (x1-x2)^2 + (y1-y2)^2 + (z1-z2)^2
@@ -143,7 +352,7 @@ float calcNormSquare(const float x1, const float x2, const float y1, const float
 }
 
 /**
- * Handles reading an input bitmap image file and its attributes.
+ * Handles reading an input bitmap image file and its attributes. The file is mapped and parsed on every core (see readImageText).
  * 
  * @param   file_name       File name of the bitmap representing the image (.txt)
  * 
@@ -151,46 +360,157 @@ float calcNormSquare(const float x1, const float x2, const float y1, const float
  */
 struct Image readImage(const char file_name[])
 {
-    FILE* image_file;
-    char file_location[100] = "./";
-    strcat_s(file_location, sizeof(file_location), file_name);
+    return readImageText(file_name);
+}
 
-    // Declare the structure to store the dimensions of the image as well as the image itself
-    struct Image im;
-    int pixel_val = 0;
-    
-    // Test if the file can be opened
-    errno_t err;
-    if ((err = fopen_s(&image_file, file_location, "r")) != 0)
-    {
-        printf("File was not opened\n");
-        im.num_col = -1;
-        im.num_row = -1;
-        im.rgb_image = NULL;
-        return im;
-    }
+/**
+ * Reads an image, choosing the reader from the file extension. Binary images (.uwi) are mapped, Netpbm images (.ppm, .pgm, .pnm or "-" for stdin)
+ * are converted directly and everything else is parsed as a text bitmap.
+ * 
+ * @param   file_name       File name of the image
+ * 
+ * @return                  Returns the same structure as readImage. Release it with freeImage.
+ */
+struct Image loadImage(const char file_name[])
+{
+    if (isBinaryImageFile(file_name))
+        return readImageBinary(file_name);
 
-    // Read in the number of rows and columns
-    fscanf_s(image_file, "%d", &pixel_val);
-    im.num_row = pixel_val;
+    if (isNetpbmFile(file_name))
+        return readImageNetpbm(file_name);
 
-    fscanf_s(image_file, "%d", &pixel_val);
-    im.num_col = pixel_val;
+    return readImage(file_name);
+}
 
-    // Allocate memory for the image
-    const int num_rgb_pixels = im.num_col * im.num_col * 3;
-    im.rgb_image = malloc(sizeof(float) * num_rgb_pixels);
+/**
+ * Reads only the dimensions of an image from its header, so that memory can be set aside before loadImage reads it
+ * 
+ * @param   file_name       File name of the image, any file loadImage reads except stdin
+ * @param   num_row         Set to the number of rows
+ * @param   num_col         Set to the number of columns
+ * 
+ * @return                  Returns 0 if successful, -1 otherwise. The payload is only checked by loadImage.
+ */
+int readImageSize(const char file_name[], int* num_row, int* num_col)
+{
+    if (strcmp(file_name, NETPBM_STDIO) == 0)
+        return -1;
+
+    FILE* image_file = fopen(file_name, "rb");
+    if (image_file == NULL)
+        return -1;
+
+    int status = -1;
+
+    if (isBinaryImageFile(file_name))
+    {
+        struct BinaryHeader header;
+
+        // The file size is checked once the image is mapped
+        if (fread(&header, sizeof(header), 1, image_file) == 1 && checkBinaryHeader(&header, SIZE_MAX) == 0)
+        {
+            *num_row = (int)header.num_row;
+            *num_col = (int)header.num_col;
+            status = 0;
+        }
+    }
 
-    for (int i = 0; i < num_rgb_pixels; i++)
+    else if (isNetpbmFile(file_name))
     {
-        fscanf_s(image_file, "%d", &pixel_val);
-        im.rgb_image[i] = (float)(pixel_val) / 255.0f;
+        int magic = 0, max_val = 0;
+        status = readNetpbmHeader(image_file, &magic, num_row, num_col, &max_val);
+    }
+
+    else
+    {
+        // The two dimensions are the first fields of a text bitmap
+        char text[256];
+        const size_t length = fread(text, 1, sizeof(text), image_file);
+        status = (parseTextHeader(text, &text[length], num_row, num_col) != NULL) ? 0 : -1;
     }
 
     fclose(image_file);
-    printf("File was read successfully!\n");
 
-    return im;
+    return status;
+}
+
+/**
+ * Releases the memory held by an image, whether it was allocated or mapped from a file.
+ * 
+ * @param   im              The image to release
+ * 
+ * @return                  Frees the pixels and resets the structure
+ */
+void freeImage(struct Image* im)
+{
+    if (im->mapping != NULL)
+        unmapImageFile(im->mapping, im->mapping_size);
+    else
+        free(im->rgb_image);
+
+    im->rgb_image = NULL;
+    im->mapping = NULL;
+    im->mapping_size = 0;
+
+    return;
+}
+
+/**
+ * Writes an image, choosing the writer from the file extension. Binary images (.uwi) are stored as float32, Netpbm images
+ * (.ppm, .pgm, .pnm or "-" for stdout) as 8 bit samples. Any other name is the base name of a text bitmap (see writeImage).
+ * 
+ * @param   file_name       File name of the output image
+ * @param   image           RGB image to written
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * 
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int saveImage(const char file_name[], float* image, const int num_row, const int num_col)
+{
+    if (isBinaryImageFile(file_name))
+        return writeImageBinary(file_name, image, num_row, num_col, SAMPLE_FLOAT32);
+
+    if (isNetpbmFile(file_name))
+        return writeImageNetpbm(file_name, image, num_row, num_col, 255);
+
+    return writeImage(file_name, image, num_row, num_col);
+}
+
+/**
+ * Returns the stream that images written to stdout should go to. The first call duplicates stdout for the image data and points
+ * stdout at stderr, so the progress messages printed by every stage can no longer corrupt the image in a shell pipeline.
+ * Call this before anything is printed when writing to stdout.
+ * 
+ * @return                  Stream connected to the original stdout
+ */
+FILE* getImageStdout(void)
+{
+    static FILE* image_stdout = NULL;
+
+    if (image_stdout != NULL)
+        return image_stdout;
+
+    fflush(stdout);
+
+#ifdef _WIN32
+    const int image_fd = _dup(_fileno(stdout));
+    _dup2(_fileno(stderr), _fileno(stdout));
+    _setmode(image_fd, _O_BINARY);
+    image_stdout = (image_fd >= 0) ? _fdopen(image_fd, "wb") : NULL;
+#else
+    const int image_fd = dup(fileno(stdout));
+    dup2(fileno(stderr), fileno(stdout));
+    image_stdout = (image_fd >= 0) ? fdopen(image_fd, "wb") : NULL;
+#endif
+
+    if (image_stdout == NULL)
+    {
+        printf("Could not separate the image stream from stdout.\n");
+        image_stdout = stdout;
+    }
+
+    return image_stdout;
 }
 
 /**
@@ -206,144 +526,142 @@ struct Image readImage(const char file_name[])
 int writeImage(const char file_name[], float* image, const int num_row, const int num_col)
 {
     // Build up the string containing the full filename
-    FILE* image_file;
-    char file_location[100] = "./";
-    strcat_s(file_location, sizeof(file_location), file_name);
-    strcat_s(file_location, sizeof(file_location), "_corrected.txt");
-
-    // Check if we can write to the file
-    errno_t err;
-    if ((err = fopen_s(&image_file, file_location, "w")) != 0)
+    char file_location[FILENAME_MAX];
+    snprintf(file_location, sizeof(file_location), "%s_corrected.txt", file_name);
+
+    // The samples are formatted in parallel (see writeImageText)
+    return writeImageText(file_location, image, num_row, num_col, TEXT_FLOAT6);
+}
+
+/**
+ * Reads an image that is split into three text bitmaps, one per channel: "red_" + base_file_name + ".txt", "green_"... and "blue_"...
+ * Each channel is read on its own thread and, when there are more cores than channels, every channel file is further split into
+ * byte ranges that are parsed in parallel.
+ * 
+ * @param   base_file_name  Base file name shared by the three channel files
+ * 
+ * @return                  Returns the same structure as readImage. On failure the dimensions are -1 and the image is NULL.
+ */
+struct Image readImageParallel(const char base_file_name[])
+{
+    const char* prefixes[READ_THREADS] = { "red_" , "green_" , "blue_" };
+    char file_locations[READ_THREADS][FILENAME_MAX];
+
+    for (int i = 0; i < READ_THREADS; i++)
+        snprintf(file_locations[i], sizeof(file_locations[i]), "%s%s.txt", prefixes[i], base_file_name);
+
+    // Take the dimensions from the red file, the other threads check that theirs match
+    struct Image im = { -1, -1, NULL, NULL, 0 };
+    int num_row = 0, num_col = 0;
+
+    size_t mapping_size = 0;
+    const char* mapping = mapImageFile(file_locations[0], &mapping_size);
+
+    if (mapping == NULL)
     {
-        printf("File could be written to.\n");
-        return -1;
+        printf("Red image file was not opened\n");
+        return im;
     }
 
-    // Write the number of rows and columns
-    fprintf_s(image_file, "%d\n", num_row);
-    fprintf_s(image_file, "%d\n", num_col);
+    const char* body = parseTextHeader(mapping, mapping + mapping_size, &num_row, &num_col);
+    unmapImageFile((void*)mapping, mapping_size);
+
+    if (body == NULL)
+    {
+        printf("Invalid image dimensions in the red image file.\n");
+        return im;
+    }
 
-    // Write the actual pixels
-    const int num_rgb_pixels = num_col * num_row * 3;
+    // Allocate memory for the image
+    const size_t num_pixels = (size_t)num_row * num_col;
+    float* rgb_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
 
-    for (int i = 0; i < num_rgb_pixels; i++)
+    if (rgb_image == NULL)
     {
-        fprintf_s(image_file, "%.6f\n", image[i]);
+        printf("Not enough memory to read the image.\n");
+        return im;
     }
 
-    fclose(image_file);
-    printf("Image was written successfully!\n");
+    // Share the cores between the channels
+    int threads_per_channel = getNumThreads() / READ_THREADS;
+    threads_per_channel = (threads_per_channel < 1) ? 1 : threads_per_channel;
 
-    return 0;
+    // Construct the arguments and read the R, G, and B images at the same time
+    struct arg_struct args[READ_THREADS];
+
+    for (int i = 0; i < READ_THREADS; i++)
+    {
+        args[i].output = &rgb_image[i * num_pixels];
+        args[i].file_location = file_locations[i];
+        args[i].check_num_row = num_row;
+        args[i].check_num_col = num_col;
+        args[i].id = i;
+        args[i].num_threads = threads_per_channel;
+        args[i].error = 0;
+    }
+
+    runParallel(readSingleChannel, args, sizeof(struct arg_struct), READ_THREADS);
+
+    for (int i = 0; i < READ_THREADS; i++)
+    {
+        if (args[i].error)
+        {
+            free(rgb_image);
+            return im;
+        }
+    }
+
+    im.num_row = num_row;
+    im.num_col = num_col;
+    im.rgb_image = rgb_image;
+
+    printf("File was read successfully!\n");
+    return im;
 }
 
-//struct Image readImageParallel(const char base_file_name[])
-//{
-//    char* prefixes[3] = { "red_" , "green_" , "blue_" };
-//
-//    FILE* image_files[3];
-//    char* file_locations[3][100] = { "./", "./", "./" };
-//
-//    // Test out the read on the red image
-//    strcat_s(file_locations[0], sizeof(file_locations[0]), prefixes[0]);
-//    strcat_s(file_locations[0], sizeof(file_locations[0]), base_file_name);
-//    strcat_s(file_locations[0], sizeof(file_locations[0]), ".txt");
-//
-//    // Allocate memory to store the RGB image
-//    // Note that we will take the dimensions from the first file and check that they match the rest of the files
-//    struct Image im;
-//    int pixel_val = 0;
-//
-//    errno_t err;
-//    if ((err = fopen_s(&image_files[0], file_locations[0], "r")) != 0)
-//    {
-//        printf("Red image file was not opened\n");
-//        im.num_col = -1;
-//        im.num_row = -1;
-//        im.rgb_image = NULL;
-//        return im;
-//    }
-//
-//    // Read in the number of rows and columns
-//    fscanf_s(image_files[0], "%d", &pixel_val);
-//    im.num_row = pixel_val;
-//
-//    fscanf_s(image_files[0], "%d", &pixel_val);
-//    im.num_col = pixel_val;
-//
-//    fclose(image_files[0]);
-//
-//    // Allocate memory for the image
-//    const int num_pixels = im.num_col * im.num_col;
-//    const int num_rgb_pixels = num_pixels * 3;
-//    im.rgb_image = malloc(sizeof(float) * num_rgb_pixels);
-//
-//    // Construct the threads and arguments
-//    pthread_t thread_id[READ_THREADS];
-//    struct arg_struct args[3];
-//
-//    for (int i = 0; i < READ_THREADS; i++)
-//    {
-//        // Open the file for each thread before calling the thread
-//        strcat_s(file_locations[i], sizeof(file_locations[i]), prefixes[i]);
-//        strcat_s(file_locations[i], sizeof(file_locations[i]), base_file_name);
-//        strcat_s(file_locations[i], sizeof(file_locations[i]), ".txt");
-//
-//        if ((err = fopen_s(&image_files[i], file_locations[i], "r")) != 0)
-//        {
-//            printf("File %d was not opened\n", i);
-//            return im;
-//        }
-//
-//        // Create the argument struct
-//        args[i].check_num_col = im.num_col;
-//        args[i].check_num_row = im.num_row;
-//        args[i].id = i;
-//        args[i].image_file = &image_files[i];
-//        args[i].output = &im.rgb_image[i * num_pixels];
-//
-//        // Create the thread for the R, G, and B images
-//        pthread_create(&thread_id[i], NULL, &readSingleChannel, (void*)&args[i]);
-//    }
-//
-//    // Wait for the threads to finish
-//    for (int i = 0; i < READ_THREADS; i++)
-//        pthread_join(thread_id[i], NULL);
-//
-//    return im;
-//}
-//
-//void readSingleChannel(void* vargs)
-//{
-//    // Cast void argument into the correct structure
-//    struct arg_struct* args = (struct arg_struct*)vargs;
-//
-//    // Declare the structure to store the dimensions of the image as well as the image itself
-//    int pixel_val = 0;
-//
-//    // Read in the number of rows and columns
-//    fscanf_s(args->image_file, "%d", &pixel_val);
-//    const int num_row = pixel_val;
-//
-//    fscanf_s(args->image_file, "%d", &pixel_val);
-//    const int num_col = pixel_val;
-//    
-//    if (num_row != args->check_num_row || num_col != args->check_num_col)
-//    {
-//        printf("Image dimensions of file %d did not match between input text files! Please check and try again.\n", args->id);
-//        return;
-//    }
-//
-//    const int num_pixels = num_row * num_col;
-//
-//    for (int i = 0; i < num_pixels; i++)
-//    {
-//        fscanf_s(args->image_file, "%d", &pixel_val);
-//        args->output[i] = (float)(pixel_val) / 255.0f;
-//    }
-//
-//    fclose(args->image_file);
-//    printf("File %d was read successfully!\n", args->id);
-//
-//    return;
-//}
\ No newline at end of file
+/**
+ * Thread function to read a single channel file of readImageParallel.
+ * 
+ * @param   vargs           Pointer to a struct arg_struct describing the file and where its pixels go
+ * 
+ * @return                  Fills in the output channel, sets error if the file could not be read or its dimensions do not match
+ */
+void* readSingleChannel(void* vargs)
+{
+    // Cast void argument into the correct structure
+    struct arg_struct* args = (struct arg_struct*)vargs;
+
+    size_t mapping_size = 0;
+    const char* mapping = mapImageFile(args->file_location, &mapping_size);
+
+    if (mapping == NULL)
+    {
+        printf("File %s was not opened\n", args->file_location);
+        args->error = 1;
+        return NULL;
+    }
+
+    // Read in the number of rows and columns
+    const char* end = mapping + mapping_size;
+    int num_row = 0, num_col = 0;
+    const char* body = parseTextHeader(mapping, end, &num_row, &num_col);
+
+    if (body == NULL || num_row != args->check_num_row || num_col != args->check_num_col)
+    {
+        printf("Image dimensions of file %d did not match between input text files! Please check and try again.\n", args->id);
+        unmapImageFile((void*)mapping, mapping_size);
+        args->error = 1;
+        return NULL;
+    }
+
+    const size_t num_pixels = (size_t)num_row * num_col;
+
+    if (parseTextSamples(body, end, args->output, num_pixels, args->num_threads) != 0)
+    {
+        printf("File %d could not be parsed.\n", args->id);
+        args->error = 1;
+    }
+
+    unmapImageFile((void*)mapping, mapping_size);
+    return NULL;
+}
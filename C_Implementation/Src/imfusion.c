@@ -11,6 +11,25 @@
  * @return                  Allocates an array with the final fused result
  */
 float* applyFusion(float* white_image, float* gamma_weight, float* sharp_weight, const int num_row, const int num_col)
+{
+    float* corrected = malloc(sizeof(float) * num_row * num_col * NUM_CHANNELS);
+    applyFusionRef(white_image, gamma_weight, sharp_weight, corrected, num_row, num_col);
+
+    return corrected;
+}
+
+/**
+ * Applies Image Fusion on a white balanced image by reference
+ * @param   white_image     White balanced image in the range of [0,1]
+ * @param   gamma_weight    Combined laplacian, saliency, and saturation weight using the gamma corrected image
+ * @param   sharp_weight    Combined laplacian, saliency, and saturation weight using the sharpened image
+ * @param   corrected       Memory to place the final fused result to
+ * @param	num_row		    Number of rows in the RGB image
+ * @param	num_col		    Number of columns in the RGB image
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyFusionRef(float* white_image, float* gamma_weight, float* sharp_weight, float* corrected, const int num_row, const int num_col)
 {
     // Calcuate constants
     const int num_pixel = num_row * num_col;
@@ -19,16 +38,57 @@ float* applyFusion(float* white_image, float* gamma_weight, float* sharp_weight,
     // Apply regularization / normalization to the weights
     normalizeFusionWeights(gamma_weight, sharp_weight, num_row, num_col);
 
-    float* reconstructed = malloc(sizeof(float) * num_rgb);
-
     // Apply Naive Fusion which is simply the Haddamard product between the image and combined weight
     for (int i = 0; i < num_rgb; i++)
-        reconstructed[i] = white_image[i] * (gamma_weight[i % num_pixel] + sharp_weight[i % num_pixel]);
+        corrected[i] = white_image[i] * (gamma_weight[i % num_pixel] + sharp_weight[i % num_pixel]);
 
-    float* corrected = correctGamma(reconstructed, num_pixel, 0.7);
-    free(reconstructed);
+    // Gamma correction is element wise, so it is safe to apply in place
+    correctGammaRef(corrected, corrected, num_pixel, 0.7);
 
-    return corrected;
+    return;
+}
+
+/**
+ * Applies Image Fusion with half float weights by reference (see applyFusionRef). The weights are converted
+ * back to floats a block at a time, so the arithmetic is the same as the float version.
+ * @param   white_image     White balanced image in the range of [0,1]
+ * @param   gamma_weight    Combined half weight using the gamma corrected image
+ * @param   sharp_weight    Combined half weight using the sharpened image
+ * @param   corrected       Memory to place the final fused result to
+ * @param	num_row		    Number of rows in the RGB image
+ * @param	num_col		    Number of columns in the RGB image
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyFusionHalfRef(float* white_image, half* gamma_weight, half* sharp_weight, float* corrected, const int num_row, const int num_col)
+{
+    const int num_pixel = num_row * num_col;
+
+    float gamma_block[HALF_BLOCK];
+    float sharp_block[HALF_BLOCK];
+
+    for (int first = 0; first < num_pixel; first += HALF_BLOCK)
+    {
+        const int count = (num_pixel - first < HALF_BLOCK) ? num_pixel - first : HALF_BLOCK;
+
+        unpackHalf(&gamma_weight[first], gamma_block, count);
+        unpackHalf(&sharp_weight[first], sharp_block, count);
+
+        // Apply regularization / normalization to the weights of the block
+        normalizeFusionWeights(gamma_block, sharp_block, 1, count);
+
+        // Naive Fusion on the block for every channel
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+            for (int i = 0; i < count; i++)
+                corrected[c * num_pixel + first + i] = white_image[c * num_pixel + first + i] * (gamma_block[i] + sharp_block[i]);
+        }
+    }
+
+    // Gamma correction is element wise, so it is safe to apply in place
+    correctGammaRef(corrected, corrected, num_pixel, 0.7);
+
+    return;
 }
 
 /** 
@@ -56,14 +116,157 @@ void normalizeFusionWeights(float* gamma_weight, float* sharp_weight, const int
     return;
 }
 
+/**
+ * Performs all the enhancement steps on an image that is already in memory, without any file IO or timing output.
+ * 
+ * @param   image       RGB image with entries between [0,1]. Note that white balancing modifies it in place
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ * 
+ * @return              Allocates an array with the final fused result
+ */
+float* enhanceImage(float* image, const int num_row, const int num_col)
+{
+    struct Workspace ws;
+
+    if (initWorkspace(&ws, calcFusionWorkspace(num_row, num_col)) != 0)
+        return NULL;
+
+    float* reconstructed = malloc(sizeof(float) * num_row * num_col * NUM_CHANNELS);
+    enhanceImageRef(image, reconstructed, num_row, num_col, &ws);
+
+    freeWorkspace(&ws);
+
+    return reconstructed;
+}
+
+/**
+ * Performs all the enhancement steps on an image by reference. Every temporary comes from the workspace,
+ * so reusing one workspace (see calcFusionWorkspace) across frames makes this allocation free.
+ * 
+ * @param   image           RGB image with entries between [0,1]. Note that white balancing modifies it in place
+ * @param   reconstructed   Memory to place the final fused result to
+ * @param	num_row		    Number of rows in the RGB image
+ * @param	num_col		    Number of columns in the RGB image
+ * @param   ws              Workspace for temporaries, NULL to allocate them
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void enhanceImageRef(float* image, float* reconstructed, const int num_row, const int num_col, struct Workspace* ws)
+{
+#if HALF_WEIGHTS
+    enhanceImageHalfRef(image, reconstructed, num_row, num_col, ws);
+    return;
+#endif
+
+    const int num_pixels = num_row * num_col;
+    const int num_rgb = num_pixels * NUM_CHANNELS;
+
+    float* white = takePlanes(ws, num_rgb);
+    applyWhiteBalanceRef(image, white, num_row, num_col, 1, ws);
+
+    float* gamma_weight = takePlanes(ws, num_pixels);
+    float* gamma = takePlanes(ws, num_rgb);
+    correctGammaRef(white, gamma, num_pixels, 1.2);
+    getWeightsRef(gamma, gamma_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, gamma);
+
+    float* sharp_weight = takePlanes(ws, num_pixels);
+    float* sharp = takePlanes(ws, num_rgb);
+    applyUnsharpMaskRef(white, sharp, num_row, num_col, ws);
+    getWeightsRef(sharp, sharp_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, sharp);
+
+    applyFusionRef(white, gamma_weight, sharp_weight, reconstructed, num_row, num_col);
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, sharp_weight);
+    releasePlanes(ws, gamma_weight);
+    releasePlanes(ws, white);
+
+    return;
+}
+
+/**
+ * Performs all the enhancement steps on an image by reference with the gamma and sharpened weight maps stored as half floats
+ * (see enhanceImageRef). It needs less workspace than the float version, so calcFusionWorkspace covers both.
+ * 
+ * @param   image           RGB image with entries between [0,1]. Note that white balancing modifies it in place
+ * @param   reconstructed   Memory to place the final fused result to
+ * @param	num_row		    Number of rows in the RGB image
+ * @param	num_col		    Number of columns in the RGB image
+ * @param   ws              Workspace for temporaries, NULL to allocate them
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void enhanceImageHalfRef(float* image, float* reconstructed, const int num_row, const int num_col, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+    const int num_rgb = num_pixels * NUM_CHANNELS;
+
+    // Halves come from the workspace two to a float
+    const size_t weight_floats = ((size_t)num_pixels + 1) / 2;
+
+    float* white = takePlanes(ws, num_rgb);
+    applyWhiteBalanceRef(image, white, num_row, num_col, 1, ws);
+
+    half* gamma_weight = (half*)takePlanes(ws, weight_floats);
+    float* gamma = takePlanes(ws, num_rgb);
+    correctGammaRef(white, gamma, num_pixels, 1.2);
+    getWeightsHalfRef(gamma, gamma_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, gamma);
+
+    half* sharp_weight = (half*)takePlanes(ws, weight_floats);
+    float* sharp = takePlanes(ws, num_rgb);
+    applyUnsharpMaskRef(white, sharp, num_row, num_col, ws);
+    getWeightsHalfRef(sharp, sharp_weight, num_row, num_col, LUM_OPTION, ws);
+    releasePlanes(ws, sharp);
+
+    applyFusionHalfRef(white, gamma_weight, sharp_weight, reconstructed, num_row, num_col);
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)sharp_weight);
+    releasePlanes(ws, (float*)gamma_weight);
+    releasePlanes(ws, white);
+
+    return;
+}
+
+/**
+ * Returns the workspace size needed for enhanceImageRef to run without any allocation
+ * 
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ * 
+ * @return              Number of bytes to initialize the workspace with
+ */
+size_t calcFusionWorkspace(const int num_row, const int num_col)
+{
+    return FUSION_WORKSPACE_PLANES * calcPlaneBytes(num_row, num_col);
+}
+
+/**
+ * Estimates the peak memory used while enhancing an image of the given size
+ * 
+ * @param	num_row		Number of rows in the RGB image
+ * @param	num_col		Number of columns in the RGB image
+ * 
+ * @return              Estimated number of bytes, including the input image, the result and the workspace
+ */
+size_t estimateFusionMemory(const int num_row, const int num_col)
+{
+    return (size_t)num_row * num_col * 2 * NUM_CHANNELS * sizeof(float) + calcFusionWorkspace(num_row, num_col);
+}
+
 /**
  * Wrapper function to perform all steps of image fusion
  * 
- * @param filename  Filename of the input bitmap
+ * @param filename      Filename of the input image (see loadImage for the supported formats)
+ * @param output_name   Filename of the output image (see saveImage for the supported formats)
  * 
- * @return          Returns the reconstructed image and also writes the results to a text file.
+ * @return              Returns the reconstructed image and also writes the results to a file.
  */
-float* imageFusionSeqFull(char filename[])
+float* imageFusionSeqFull(char filename[], char output_name[])
 {
     // For timing each function
     clock_t start = clock(), diff;
@@ -71,7 +274,11 @@ float* imageFusionSeqFull(char filename[])
 
     // Read in the file
     printf("----------------------------------------------------------------------------------\n\n");
-    struct Image rgb = readImage(filename);
+    struct Image rgb = loadImage(filename);
+
+    if (rgb.rgb_image == NULL)
+        return NULL;
+
     const int num_pixels = rgb.num_row * rgb.num_col;
     diff = clock() - start;
     msec = diff * 1000 / CLOCKS_PER_SEC;
@@ -96,7 +303,11 @@ float* imageFusionSeqFull(char filename[])
     float* gamma = correctGamma(white, num_pixels, 1.2);
     printf("Finished Gamma Correction!\n");
 
+#if HALF_WEIGHTS
+    half* gamma_weight = getWeightsHalf(gamma, rgb.num_row, rgb.num_col, LUM_OPTION);
+#else
     float* gamma_weight = getWeights(gamma, rgb.num_row, rgb.num_col, LUM_OPTION);
+#endif
 
     printf("Finished Gamma Weight Calculation!\n");
     diff = clock() - start;
@@ -112,7 +323,11 @@ float* imageFusionSeqFull(char filename[])
     float* sharp = applyUnsharpMask(white, rgb.num_row, rgb.num_col);
     printf("Finished Unsharp Mask!\n");
 
+#if HALF_WEIGHTS
+    half* sharp_weight = getWeightsHalf(sharp, rgb.num_row, rgb.num_col, LUM_OPTION);
+#else
     float* sharp_weight = getWeights(sharp, rgb.num_row, rgb.num_col, LUM_OPTION);
+#endif
     printf("Finished Unsharp Mask Weight Calculation!\n");
     diff = clock() - start;
     msec = diff * 1000 / CLOCKS_PER_SEC;
@@ -125,7 +340,12 @@ float* imageFusionSeqFull(char filename[])
     // Image fusion
     //------------------------------------------------------
     start = clock();
+#if HALF_WEIGHTS
+    float* reconstructed = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+    applyFusionHalfRef(white, gamma_weight, sharp_weight, reconstructed, rgb.num_row, rgb.num_col);
+#else
     float* reconstructed = applyFusion(white, gamma_weight, sharp_weight, rgb.num_row, rgb.num_col);
+#endif
     printf("Finished Image Fusion!\n");
     diff = clock() - start;
     msec = diff * 1000 / CLOCKS_PER_SEC;
@@ -133,10 +353,10 @@ float* imageFusionSeqFull(char filename[])
     printf("----------------------------------------------------------------------------------\n\n");
 
     //------------------------------------------------------
-    // Write the output to text file
+    // Write the output to file
     //-----------------------------------------------------
     start = clock();
-    writeImage("underwater_bitmap", reconstructed, rgb.num_row, rgb.num_col);
+    saveImage(output_name, reconstructed, rgb.num_row, rgb.num_col);
     diff = clock() - start;
     msec = diff * 1000 / CLOCKS_PER_SEC;
     printf("Elapsed time was %d seconds and %d millseconds\n", msec / 1000, msec % 1000);
@@ -144,7 +364,8 @@ float* imageFusionSeqFull(char filename[])
 
     printf("\n\nCleaning up allocated memory now...\n");
 
-    free(rgb.rgb_image);
+    freeImage(&rgb);
+    free(white);
     free(sharp_weight);
     free(gamma_weight);
     free(reconstructed);
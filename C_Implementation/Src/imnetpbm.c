@@ -0,0 +1,441 @@
+#include "../Inc/imnetpbm.h"
+
+#include <limits.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/**
+ * Checks if a file name refers to a Netpbm image based on its extension (or "-" for stdin / stdout)
+ *
+ * @param   file_name   File name of the image
+ *
+ * @return              Returns 1 for .ppm, .pgm, .pnm or "-", 0 otherwise.
+ */
+int isNetpbmFile(const char file_name[])
+{
+    const size_t name_length = strlen(file_name);
+
+    if (strcmp(file_name, NETPBM_STDIO) == 0)
+        return 1;
+
+    if (name_length < 4)
+        return 0;
+
+    const char* ext = &file_name[name_length - 4];
+    return strcmp(ext, ".ppm") == 0 || strcmp(ext, ".pgm") == 0 || strcmp(ext, ".pnm") == 0;
+}
+
+/**
+ * Reads a single header field, skipping whitespace and comments
+ *
+ * @param   image_file  Stream positioned inside the header
+ * @param   value       Set to the value of the field
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+static int readHeaderField(FILE* image_file, int* value)
+{
+    int c = getc(image_file);
+
+    // Skip whitespace and comments that run to the end of the line
+    while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '#')
+    {
+        if (c == '#')
+            while (c != '\n' && c != EOF)
+                c = getc(image_file);
+
+        c = getc(image_file);
+    }
+
+    if (c < '0' || c > '9')
+        return -1;
+
+    *value = 0;
+    while (c >= '0' && c <= '9')
+    {
+        if (*value > 100000000)
+            return -1;
+
+        *value = *value * 10 + (c - '0');
+        c = getc(image_file);
+    }
+
+    // The field must end in exactly one whitespace character, after the last field the payload begins
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r') ? 0 : -1;
+}
+
+/**
+ * Reads the header of a binary Netpbm image
+ *
+ * @param   image_file  Stream at the start of the image
+ * @param   magic       Set to 5 for a PGM or 6 for a PPM
+ * @param   num_row     Set to the number of rows
+ * @param   num_col     Set to the number of columns
+ * @param   max_val     Set to the largest sample value (255 for 8 bit, up to 65535 for 16 bit)
+ *
+ * @return              Returns 0 if successful, -1 otherwise. The stream is left at the start of the payload.
+ */
+int readNetpbmHeader(FILE* image_file, int* magic, int* num_row, int* num_col, int* max_val)
+{
+    if (getc(image_file) != 'P')
+        return -1;
+
+    *magic = getc(image_file) - '0';
+    if (*magic != 5 && *magic != 6)
+    {
+        printf("Only binary PGM (P5) and PPM (P6) images are supported.\n");
+        return -1;
+    }
+
+    if (readHeaderField(image_file, num_col) != 0 || readHeaderField(image_file, num_row) != 0 || readHeaderField(image_file, max_val) != 0)
+        return -1;
+
+    if (*num_row <= 0 || *num_col <= 0 || *max_val <= 0 || *max_val > 65535)
+        return -1;
+
+    return 0;
+}
+
+/**
+ * Clips a sample to [0,1] and rounds it to the nearest integer sample value
+ *
+ * @param   pixel   Sample to quantize
+ * @param   scale   Largest sample value
+ *
+ * @return          Quantized sample between [0, scale]
+ */
+static inline uint16_t quantizeSample(float pixel, const float scale)
+{
+    // Confine resulting value to between 0 and 1
+    pixel = (pixel < 0) ? 0 : pixel;
+    pixel = (pixel > 1) ? 1 : pixel;
+
+    return (uint16_t)(pixel * scale + 0.5f);
+}
+
+/**
+ * Converts interleaved Netpbm samples to the planar [R... G... B...] layout normalized to [0,1].
+ * Greyscale samples are copied into all three planes.
+ *
+ * @param   samples         Interleaved samples, 16 bit samples are big endian
+ * @param   image           Position of the first pixel in the red plane
+ * @param   plane_size      Distance between the planes of the image (num_row * num_col)
+ * @param   num_pixels      Number of pixels to convert
+ * @param   num_channels    1 for greyscale or 3 for RGB samples
+ * @param   max_val         Largest sample value, more than 255 means 16 bit samples
+ *
+ * @return                  Fills in num_pixels of every plane of the image
+ */
+void interleavedToPlanar(const uint8_t* samples, float* image, const size_t plane_size, const size_t num_pixels, const int num_channels, const int max_val)
+{
+    float* red = image;
+    float* green = &image[plane_size];
+    float* blue = &image[plane_size * 2];
+    const float scale = (float)max_val;
+
+    if (max_val < 256 && num_channels == NUM_CHANNELS)
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            red[i] = (float)samples[3 * i] / scale;
+            green[i] = (float)samples[3 * i + 1] / scale;
+            blue[i] = (float)samples[3 * i + 2] / scale;
+        }
+    }
+
+    else if (max_val < 256)
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+            red[i] = green[i] = blue[i] = (float)samples[i] / scale;
+    }
+
+    else if (num_channels == NUM_CHANNELS)
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            red[i] = (float)((samples[6 * i] << 8) | samples[6 * i + 1]) / scale;
+            green[i] = (float)((samples[6 * i + 2] << 8) | samples[6 * i + 3]) / scale;
+            blue[i] = (float)((samples[6 * i + 4] << 8) | samples[6 * i + 5]) / scale;
+        }
+    }
+
+    else
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+            red[i] = green[i] = blue[i] = (float)((samples[2 * i] << 8) | samples[2 * i + 1]) / scale;
+    }
+
+    return;
+}
+
+/**
+ * Converts the planar [R... G... B...] layout to interleaved Netpbm samples, clipping to [0,1] and rounding.
+ * For greyscale output the perceived luminance of each pixel is stored.
+ *
+ * @param   image           Position of the first pixel in the red plane
+ * @param   plane_size      Distance between the planes of the image (num_row * num_col)
+ * @param   samples         Interleaved output samples, 16 bit samples are big endian
+ * @param   num_pixels      Number of pixels to convert
+ * @param   num_channels    1 for greyscale or 3 for RGB samples
+ * @param   max_val         Largest sample value, more than 255 means 16 bit samples
+ *
+ * @return                  Fills in num_pixels * num_channels samples
+ */
+void planarToInterleaved(float* image, const size_t plane_size, uint8_t* samples, const size_t num_pixels, const int num_channels, const int max_val)
+{
+    float* red = image;
+    float* green = &image[plane_size];
+    float* blue = &image[plane_size * 2];
+    const float scale = (float)max_val;
+
+    if (max_val < 256 && num_channels == NUM_CHANNELS)
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            samples[3 * i] = (uint8_t)quantizeSample(red[i], scale);
+            samples[3 * i + 1] = (uint8_t)quantizeSample(green[i], scale);
+            samples[3 * i + 2] = (uint8_t)quantizeSample(blue[i], scale);
+        }
+    }
+
+    else if (max_val < 256)
+    {
+        for (size_t i = 0; i < num_pixels; i++)
+            samples[i] = (uint8_t)quantizeSample(0.299f * red[i] + 0.587f * green[i] + 0.114f * blue[i], scale);
+    }
+
+    else
+    {
+        uint16_t value[NUM_CHANNELS];
+
+        for (size_t i = 0; i < num_pixels; i++)
+        {
+            if (num_channels == NUM_CHANNELS)
+            {
+                value[0] = quantizeSample(red[i], scale);
+                value[1] = quantizeSample(green[i], scale);
+                value[2] = quantizeSample(blue[i], scale);
+            }
+
+            else
+                value[0] = quantizeSample(0.299f * red[i] + 0.587f * green[i] + 0.114f * blue[i], scale);
+
+            for (int c = 0; c < num_channels; c++)
+            {
+                samples[2 * (i * num_channels + c)] = (uint8_t)(value[c] >> 8);
+                samples[2 * (i * num_channels + c) + 1] = (uint8_t)(value[c] & 0xFF);
+            }
+        }
+    }
+
+    return;
+}
+
+/**
+ * Reads a binary Netpbm image from an open stream. The payload is read and converted in blocks so pipes work as well as files.
+ *
+ * @param   image_file  Stream at the start of the image
+ *
+ * @return              Returns a structure with the number of rows, number of columns and a pointer to the planar RGB image.
+ *                      On failure the dimensions are -1 and the image is NULL.
+ */
+struct Image readNetpbmStream(FILE* image_file)
+{
+    struct Image im = { -1, -1, NULL, NULL, 0 };
+    int magic = 0, num_row = 0, num_col = 0, max_val = 0;
+
+    if (readNetpbmHeader(image_file, &magic, &num_row, &num_col, &max_val) != 0)
+    {
+        printf("Invalid Netpbm header.\n");
+        return im;
+    }
+
+    // The pipeline indexes pixels with an int, so the whole image has to fit in one (strip mode reads bands instead)
+    if ((uint64_t)num_row * num_col * NUM_CHANNELS > INT_MAX)
+    {
+        printf("Netpbm image is too large.\n");
+        return im;
+    }
+
+    const int num_channels = (magic == 6) ? NUM_CHANNELS : 1;
+    const size_t pixel_bytes = (size_t)num_channels * ((max_val < 256) ? 1 : 2);
+    const size_t num_pixels = (size_t)num_row * num_col;
+
+    float* rgb_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+    uint8_t* block = malloc(pixel_bytes * NETPBM_BLOCK_PIXELS);
+
+    if (rgb_image == NULL || block == NULL)
+    {
+        printf("Not enough memory to read the image.\n");
+        free(rgb_image);
+        free(block);
+        return im;
+    }
+
+    for (size_t first = 0; first < num_pixels; first += NETPBM_BLOCK_PIXELS)
+    {
+        const size_t count = (num_pixels - first < NETPBM_BLOCK_PIXELS) ? num_pixels - first : NETPBM_BLOCK_PIXELS;
+
+        if (fread(block, pixel_bytes, count, image_file) != count)
+        {
+            printf("Netpbm image is truncated.\n");
+            free(rgb_image);
+            free(block);
+            return im;
+        }
+
+        interleavedToPlanar(block, &rgb_image[first], num_pixels, count, num_channels, max_val);
+    }
+
+    free(block);
+
+    im.num_row = num_row;
+    im.num_col = num_col;
+    im.rgb_image = rgb_image;
+
+    return im;
+}
+
+/**
+ * Writes the header of a binary Netpbm image, the samples follow directly after it
+ *
+ * @param   image_file      Stream to write to
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   max_val         Largest sample value
+ * @param   greyscale       1 for a PGM (P5) header, 0 for a PPM (P6) header
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int writeNetpbmHeader(FILE* image_file, const int num_row, const int num_col, const int max_val, const int greyscale)
+{
+    return (fprintf(image_file, "P%d\n%d %d\n%d\n", greyscale ? 5 : 6, num_col, num_row, max_val) > 0) ? 0 : -1;
+}
+
+/**
+ * Writes a planar RGB image to an open stream as a binary Netpbm image
+ *
+ * @param   image_file      Stream to write to
+ * @param   image           RGB image to be written, entries between [0,1]
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   max_val         Largest sample value, 255 for 8 bit and 65535 for 16 bit output
+ * @param   greyscale       1 to write a PGM (P5) of the luminance, 0 to write a PPM (P6)
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int writeNetpbmStream(FILE* image_file, float* image, const int num_row, const int num_col, const int max_val, const int greyscale)
+{
+    if (max_val <= 0 || max_val > 65535)
+    {
+        printf("Netpbm sample range must be between 1 and 65535.\n");
+        return -1;
+    }
+
+    const int num_channels = greyscale ? 1 : NUM_CHANNELS;
+    const size_t pixel_bytes = (size_t)num_channels * ((max_val < 256) ? 1 : 2);
+    const size_t num_pixels = (size_t)num_row * num_col;
+
+    uint8_t* block = malloc(pixel_bytes * NETPBM_BLOCK_PIXELS);
+    if (block == NULL)
+    {
+        printf("Not enough memory to write the image.\n");
+        return -1;
+    }
+
+    int status = writeNetpbmHeader(image_file, num_row, num_col, max_val, greyscale);
+
+    for (size_t first = 0; first < num_pixels && status == 0; first += NETPBM_BLOCK_PIXELS)
+    {
+        const size_t count = (num_pixels - first < NETPBM_BLOCK_PIXELS) ? num_pixels - first : NETPBM_BLOCK_PIXELS;
+
+        planarToInterleaved(&image[first], num_pixels, block, count, num_channels, max_val);
+
+        if (fwrite(block, pixel_bytes, count, image_file) != count)
+            status = -1;
+    }
+
+    free(block);
+
+    if (fflush(image_file) != 0)
+        status = -1;
+
+    return status;
+}
+
+/**
+ * Handles reading a binary Netpbm image (P5 or P6, 8 or 16 bit). Greyscale images are expanded to RGB.
+ *
+ * @param   file_name       File name of the image, "-" reads from stdin
+ *
+ * @return                  Returns the same structure as readImage. On failure the dimensions are -1 and the image is NULL.
+ */
+struct Image readImageNetpbm(const char file_name[])
+{
+    if (strcmp(file_name, NETPBM_STDIO) == 0)
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return readNetpbmStream(stdin);
+    }
+
+    struct Image im = { -1, -1, NULL, NULL, 0 };
+
+    FILE* image_file = fopen(file_name, "rb");
+    if (image_file == NULL)
+    {
+        printf("File was not opened\n");
+        return im;
+    }
+
+    im = readNetpbmStream(image_file);
+    fclose(image_file);
+
+    if (im.rgb_image != NULL)
+        printf("File was read successfully!\n");
+
+    return im;
+}
+
+/**
+ * Handles writing a binary Netpbm image. File names ending in .pgm get the greyscale luminance, everything else a PPM.
+ *
+ * @param   file_name       File name of the image, "-" writes to the image stream on stdout (see getImageStdout)
+ * @param   image           RGB image to be written, entries between [0,1]
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   max_val         Largest sample value, 255 for 8 bit and 65535 for 16 bit output
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int writeImageNetpbm(const char file_name[], float* image, const int num_row, const int num_col, const int max_val)
+{
+    if (strcmp(file_name, NETPBM_STDIO) == 0)
+        return writeNetpbmStream(getImageStdout(), image, num_row, num_col, max_val, 0);
+
+    const size_t name_length = strlen(file_name);
+    const int greyscale = name_length >= 4 && strcmp(&file_name[name_length - 4], ".pgm") == 0;
+
+    FILE* image_file = fopen(file_name, "wb");
+    if (image_file == NULL)
+    {
+        printf("File could not be written to.\n");
+        return -1;
+    }
+
+    int status = writeNetpbmStream(image_file, image, num_row, num_col, max_val, greyscale);
+
+    if (fclose(image_file) != 0 || status != 0)
+    {
+        printf("Netpbm image was not written completely.\n");
+        return -1;
+    }
+
+    printf("Image was written successfully!\n");
+
+    return 0;
+}
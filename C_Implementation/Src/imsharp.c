@@ -14,41 +14,193 @@
 */
 float* applyUnsharpMask(float* image, const int num_row, const int num_col)
 {
-	// Calculate some constants to be used in the algorithm
+	float* sharp = malloc(sizeof(float) * num_row * num_col * NUM_CHANNELS);
+	applyUnsharpMaskRef(image, sharp, num_row, num_col, NULL);
+
+	return sharp;
+}
+
+/**
+* Applies the normalized unsharp masking process (see applyUnsharpMask) by reference.
+* 
+* @param	image		The RGB input image with entries between [0,1]
+* @param	sharp		Memory to place the 3 * num_row * num_col entry sharpened image to
+* @param	num_row		Number of rows in the RGB image
+* @param	num_col		Number of columns in the RGB image
+* @param	ws			Workspace for temporaries, NULL to allocate them
+* 
+* @return				Utilizes existing memory for the result
+*/
+void applyUnsharpMaskRef(float* image, float* sharp, const int num_row, const int num_col, struct Workspace* ws)
+{
 	const int num_pixels = num_row * num_col;
-	const int num_rgb_pixels = num_pixels * NUM_CHANNELS;
 
-	// Apply Gaussian Blur and subtract from the original image
-	float* blurred = malloc(sizeof(float) * num_rgb_pixels);
+	int64_t histogram[EQUALIZATION_BINS] = { 0 };
+	int new_grey[EQUALIZATION_BINS] = { 0 };
+
+	// Equalize the intensity of the mask without storing its HSI representation
+	float* mask = takePlanes(ws, num_pixels * NUM_CHANNELS);
+	calcUnsharpMaskRef(image, mask, num_row, num_col, ws);
+
+	calcMaskHistogram(mask, num_pixels, 0, num_pixels, histogram);
+	calcEqualizationTable(histogram, num_pixels, new_grey);
+
+	// sharpened = (image + normalized) / 2
+	blendUnsharpMaskRef(image, mask, sharp, num_pixels, new_grey);
+	
+	releasePlanes(ws, mask);
+
+	return;
+}
+
+/**
+* Calculates the mask |I - G * I| used by the unsharp masking process (see applyUnsharpMask).
+* 
+* @param	image		The RGB input image with entries between [0,1]
+* @param	mask		Memory to place the 3 * num_row * num_col entry mask to
+* @param	num_row		Number of rows in the RGB image
+* @param	num_col		Number of columns in the RGB image
+* @param	ws			Workspace for temporaries, NULL to allocate them
+* 
+* @return				Utilizes existing memory for the result
+*/
+void calcUnsharpMaskRef(float* image, float* mask, const int num_row, const int num_col, struct Workspace* ws)
+{
+	const int num_rgb_pixels = num_row * num_col * NUM_CHANNELS;
 
-	for (int i = 0; i < NUM_CHANNELS; i++)
-		applyGaussianBlurRef(&image[num_pixels * i], &blurred[num_pixels * i], num_row, num_col);
+	// Apply Gaussian Blur and subtract from the original image
+	applyGaussianBlurModeRef(image, mask, NUM_CHANNELS, num_row, num_col, GAUSSIAN_SIGMA, GAUSSIAN_RADIUS, UNSHARP_BLUR, ws);
 
 	// Subtract the blur from the orignal image
 	// Note that the ABS macro only works on a single variable, not an expression...
 	float temp = 0;
 	for (int i = 0; i < num_rgb_pixels; i++)
 	{
-		temp = image[i] - blurred[i];
-		blurred[i] = ABS(temp);
+		temp = image[i] - mask[i];
+		mask[i] = ABS(temp);
 	}
 
-	// Convert to HSI to apply histogram equalization
-	float* hsi_image = rgb2hsi(blurred, num_pixels);
+	return;
+}
 
-	free(blurred);
+/**
+* Writes the HSI intensities (see getHSIIntensity) of the pixels [first, first + count) of the mask, the HistogramSource
+* used by calcMaskHistogram
+*/
+static void maskIntensitySource(const float* mask, const int num_pixels, const int channel, const int first, const int count, float* values)
+{
+	const float* red = &mask[first];
+	const float* green = &mask[num_pixels + first];
+	const float* blue = &mask[2 * num_pixels + first];
 
-	histogramEqualization(&hsi_image[2 * num_pixels], num_pixels);
+	(void)channel;
 
-	// sharpened = (image + normalized) / 2
-	float* sharp = hsi2rgb(hsi_image, num_pixels);
+	for (int i = 0; i < count; i++)
+		values[i] = getHSIIntensity(red[i], green[i], blue[i]);
 
-	for (int i = 0; i < num_rgb_pixels; i++)
-		sharp[i] = (image[i] + sharp[i]) / 2.0f;
-	
-	free(hsi_image);
+	return;
+}
 
-	return sharp;
+/**
+* Adds the HSI intensities of the pixels [first, last) of the mask to a histogram, computing them on the fly (see
+* getHSIIntensity) instead of converting the mask. Calling this on consecutive pieces of the mask gives its histogram.
+* 
+* @param	mask		The RGB mask from calcUnsharpMaskRef
+* @param	num_pixels	Number of pixels in the mask (the distance between its planes)
+* @param	first		First pixel to add
+* @param	last		One past the last pixel to add
+* @param	histogram	EQUALIZATION_BINS counters to add to
+* 
+* @return				Modifies the histogram
+*/
+void calcMaskHistogram(const float* mask, const int num_pixels, const int first, const int last, int64_t* histogram)
+{
+	struct Histogram hist;
+
+	initHistogram(&hist, EQUALIZATION_BINS, 1, 255.0f);
+	buildHistogram(&hist, mask, num_pixels, first, last, maskIntensitySource);
+
+	for (int i = 0; i < EQUALIZATION_BINS; i++)
+		histogram[i] += hist.counts[0][i];
+
+	return;
+}
+
+/**
+* Equalizes the mask's intensity and averages the result with the input, S = (I + N) / 2, for the pixels [first, last).
+* The argument is a struct unsharp_args. Each block of UNSHARP_BLOCK pixels goes to HSI, has its intensity replaced and
+* comes back to RGB while it is in cache, so no full frame HSI image is needed.
+* 
+* @param	vargs	Pointer to a struct unsharp_args
+* 
+* @return			NULL, the result is written to args->sharp
+*/
+void* unsharpBlendWorker(void* vargs)
+{
+	struct unsharp_args* args = (struct unsharp_args*)vargs;
+	const int num_pixels = args->num_pixels;
+
+	float rgb[NUM_CHANNELS * UNSHARP_BLOCK];
+	float hsi[NUM_CHANNELS * UNSHARP_BLOCK];
+
+	// The blocks use planes "count" apart so the conversions can be used as is
+	for (int first = args->first; first < args->last; first += UNSHARP_BLOCK)
+	{
+		const int count = (args->last - first < UNSHARP_BLOCK) ? args->last - first : UNSHARP_BLOCK;
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+			memcpy(&rgb[c * count], &args->mask[c * num_pixels + first], sizeof(float) * count);
+
+		rgb2hsiRef(rgb, hsi, count);
+		applyEqualizationTable(&hsi[2 * count], count, args->new_grey);
+		hsi2rgbRef(hsi, rgb, count);
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			const float* input = &args->image[c * num_pixels + first];
+			float* output = &args->sharp[c * num_pixels + first];
+
+			for (int i = 0; i < count; i++)
+				output[i] = (input[i] + rgb[c * count + i]) / 2.0f;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+* Equalizes the intensity of the mask and averages it with the input: S = (I + N) / 2, splitting the pixels between
+* the threads (see unsharpBlendWorker)
+* 
+* @param	image		The RGB input image with entries between [0,1]
+* @param	mask		The RGB mask from calcUnsharpMaskRef
+* @param	sharp		Memory to place the sharpened image to
+* @param	num_pixels	Number of pixels in the RGB image
+* @param	new_grey	Grey levels from calcEqualizationTable
+* 
+* @return				Utilizes existing memory for the result
+*/
+void blendUnsharpMaskRef(const float* image, const float* mask, float* sharp, const int num_pixels, int* new_grey)
+{
+	struct unsharp_args args[MAX_THREADS];
+
+	int num_threads = (num_pixels >= MIN_PARALLEL_UNSHARP) ? getNumThreads() : 1;
+	num_threads = (num_threads < 1) ? 1 : num_threads;
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		args[i].image = image;
+		args[i].mask = mask;
+		args[i].sharp = sharp;
+		args[i].num_pixels = num_pixels;
+		args[i].first = (int)((long)num_pixels * i / num_threads);
+		args[i].last = (int)((long)num_pixels * (i + 1) / num_threads);
+		args[i].new_grey = new_grey;
+	}
+
+	runParallel(unsharpBlendWorker, args, sizeof(struct unsharp_args), num_threads);
+
+	return;
 }
 
 /**
@@ -57,34 +209,83 @@ float* applyUnsharpMask(float* image, const int num_row, const int num_col)
 * 
 * @param	intensity		The monochromatic RGB image
 * @param	num_pixels		Number of pixels in the RGB image
-* @param	num_bins		The number of bins used in equalization, default should be 64
 * 
 * @return					Modifies the original intensity array
 */
 void histogramEqualization(float* intensity, const int num_pixels)
 {
 	// Create the historgram of RGB values
-	int histogram[256] = { 0 };
-	int new_grey[256] = { 0 };
-	int cum_sum = 0;
+	int64_t histogram[EQUALIZATION_BINS] = { 0 };
+	int new_grey[EQUALIZATION_BINS] = { 0 };
 
-	// Loop thorugh all pixel values, note that we multiply by 255 to get an integer representaton
-	for (int i = 0; i < num_pixels; i++)
-	{
-		histogram[(int)(intensity[i] * 255.0f) % 256]++;
-	}
+	calcIntensityHistogram(intensity, num_pixels, histogram);
+	calcEqualizationTable(histogram, num_pixels, new_grey);
+	applyEqualizationTable(intensity, num_pixels, new_grey);
+
+	return;
+}
+
+/**
+* Adds the intensities of an image to a histogram. Calling this on consecutive pieces of an image gives the histogram of the whole image.
+* 
+* @param	intensity		The monochromatic RGB image
+* @param	num_pixels		Number of pixels in the RGB image
+* @param	histogram		EQUALIZATION_BINS counters to add to
+* 
+* @return					Modifies the histogram
+*/
+void calcIntensityHistogram(float* intensity, const int num_pixels, int64_t* histogram)
+{
+	// Note that we multiply by 255 to get an integer representaton
+	struct Histogram hist;
+
+	initHistogram(&hist, EQUALIZATION_BINS, 1, 255.0f);
+	buildHistogram(&hist, intensity, num_pixels, 0, num_pixels, NULL);
+
+	for (int i = 0; i < EQUALIZATION_BINS; i++)
+		histogram[i] += hist.counts[0][i];
+
+	return;
+}
+
+/**
+* Calculates the grey level each histogram bin is mapped to
+* 
+* @param	histogram		Histogram of all num_pixels intensities, 64 bit so strip mode can count images of any size
+* @param	num_pixels		Number of pixels counted in the histogram
+* @param	new_grey		EQUALIZATION_BINS entries to place the new grey levels to
+* 
+* @return					Fills in new_grey
+*/
+void calcEqualizationTable(const int64_t* histogram, const int64_t num_pixels, int* new_grey)
+{
+	int64_t cum_sum = 0;
 
 	// Calculate the new grey values to assign
 	// New grey value the cumulitive probability at that point normalized to [0,255]
-	for (int i = 0; i < 256; i++)
+	for (int i = 0; i < EQUALIZATION_BINS; i++)
 	{
 		cum_sum += histogram[i];
-		new_grey[i] = (int) (((float)cum_sum) * 255.0f / num_pixels);
+		new_grey[i] = (int) (((float)cum_sum) * 255.0f / (float)num_pixels);
 	}
 
+	return;
+}
+
+/**
+* Replaces each intensity by its equalized grey level
+* 
+* @param	intensity		The monochromatic RGB image
+* @param	num_pixels		Number of pixels in the RGB image
+* @param	new_grey		Grey levels from calcEqualizationTable
+* 
+* @return					Modifies the original intensity array
+*/
+void applyEqualizationTable(float* intensity, const int num_pixels, int* new_grey)
+{
 	// Assign the new pixels
 	for (int i = 0; i < num_pixels; i++)
-		intensity[i] = (float) new_grey[(int)(intensity[i] * 255) % 256] / 255.0f;
+		intensity[i] = (float) new_grey[(int)(intensity[i] * 255) % EQUALIZATION_BINS] / 255.0f;
 
 	return;
-}
\ No newline at end of file
+}
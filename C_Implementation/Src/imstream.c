@@ -0,0 +1,383 @@
+#include "../Inc/imstream.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Initializes a hand off with every slot empty
+ */
+void initRing(struct FrameRing* ring)
+{
+    for (int i = 0; i < STREAM_SLOTS; i++)
+        ring->filled[i] = 0;
+
+    ring->finished = 0;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->changed, NULL);
+
+    return;
+}
+
+/**
+ * Releases the synchronization objects of a hand off
+ */
+void destroyRing(struct FrameRing* ring)
+{
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->changed);
+
+    return;
+}
+
+/**
+ * Producer side: waits until the slot of a frame is free to be filled
+ *
+ * @param   ring    The hand off
+ * @param   frame   Index of the frame about to be produced
+ *
+ * @return          Returns 0 once the slot is free, -1 if the consumer gave up
+ */
+int acquireEmpty(struct FrameRing* ring, const long frame)
+{
+    const int slot = (int)(frame % STREAM_SLOTS);
+
+    pthread_mutex_lock(&ring->lock);
+
+    while (ring->filled[slot] && !ring->finished)
+        pthread_cond_wait(&ring->changed, &ring->lock);
+
+    const int status = ring->finished ? -1 : 0;
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return status;
+}
+
+/**
+ * Producer side: marks the slot of a frame as filled
+ */
+void publishFrame(struct FrameRing* ring, const long frame)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->filled[frame % STREAM_SLOTS] = 1;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+
+    return;
+}
+
+/**
+ * Consumer side: waits until the slot of a frame has been filled
+ *
+ * @param   ring    The hand off
+ * @param   frame   Index of the frame to consume
+ *
+ * @return          Returns 0 once the frame is ready, -1 if the stream ended before it
+ */
+int acquireFilled(struct FrameRing* ring, const long frame)
+{
+    const int slot = (int)(frame % STREAM_SLOTS);
+
+    pthread_mutex_lock(&ring->lock);
+
+    while (!ring->filled[slot] && !ring->finished)
+        pthread_cond_wait(&ring->changed, &ring->lock);
+
+    const int status = ring->filled[slot] ? 0 : -1;
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return status;
+}
+
+/**
+ * Consumer side: hands the slot of a frame back to the producer
+ */
+void releaseFrame(struct FrameRing* ring, const long frame)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->filled[frame % STREAM_SLOTS] = 0;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+
+    return;
+}
+
+/**
+ * Ends the hand off. Called by the producer at the end of the stream, or by the consumer when it has to stop early.
+ * Frames that are already filled can still be consumed.
+ */
+void finishRing(struct FrameRing* ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->finished = 1;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+
+    return;
+}
+
+/**
+ * Checks whether a hand off was ended by finishRing
+ *
+ * @return      1 once the hand off is finished, 0 otherwise
+ */
+int isRingFinished(struct FrameRing* ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    const int finished = ring->finished;
+    pthread_mutex_unlock(&ring->lock);
+
+    return finished;
+}
+
+/**
+ * Reads the bytes of a frame from the input. Outside Windows the input is polled, so that when the rest of the pipeline
+ * stops early (the read hand off is finished) the reader returns instead of waiting on a stalled upstream.
+ *
+ * @param   args    The shared struct stream_args
+ * @param   buffer  Memory to place the bytes to
+ * @param   bytes   Number of bytes to read
+ *
+ * @return          Number of bytes read, less than bytes at the end of the stream, on an error or once stopped
+ */
+static size_t readFrameBytes(struct stream_args* args, uint8_t* buffer, const size_t bytes)
+{
+#ifdef _WIN32
+    return fread(buffer, 1, bytes, args->input);
+#else
+    // Nothing else reads the input, so the descriptor can be read directly without going through stdio
+    const int fd = fileno(args->input);
+    size_t total = 0;
+
+    while (total < bytes)
+    {
+        struct pollfd input = { fd, POLLIN, 0 };
+        const int ready = poll(&input, 1, STREAM_POLL_MS);
+
+        if (ready < 0 && errno != EINTR)
+            break;
+
+        if (ready <= 0)
+        {
+            if (isRingFinished(args->read_ring))
+                break;
+
+            continue;
+        }
+
+        const ssize_t count = read(fd, &buffer[total], bytes - total);
+
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count <= 0)
+            break;
+
+        total += (size_t)count;
+    }
+
+    return total;
+#endif
+}
+
+/**
+ * Reader stage: reads raw RGB24 frames and converts them to planar floats while the previous frame is being enhanced
+ *
+ * @param   vargs   Pointer to the shared struct stream_args
+ *
+ * @return          Finishes the read hand off at the end of the stream
+ */
+void* streamReader(void* vargs)
+{
+    struct stream_args* args = (struct stream_args*)vargs;
+
+    const size_t num_pixels = (size_t)args->options->num_row * args->options->num_col;
+    const size_t frame_bytes = num_pixels * NUM_CHANNELS;
+
+    for (long frame = 0; args->options->max_frames == 0 || frame < args->options->max_frames; frame++)
+    {
+        if (acquireEmpty(args->read_ring, frame) != 0)
+            break;
+
+        const size_t bytes_read = readFrameBytes(args, args->raw_in, frame_bytes);
+
+        if (bytes_read != frame_bytes)
+        {
+            if (bytes_read > 0 && !isRingFinished(args->read_ring))
+                printf("Dropping incomplete frame %ld (%zu of %zu bytes)\n", frame, bytes_read, frame_bytes);
+
+            break;
+        }
+
+        interleavedToPlanar(args->raw_in, args->planar[frame % STREAM_SLOTS], num_pixels, num_pixels, NUM_CHANNELS, 255);
+        publishFrame(args->read_ring, frame);
+    }
+
+    finishRing(args->read_ring);
+    return NULL;
+}
+
+/**
+ * Writer stage: writes enhanced RGB24 frames in order while the next frame is being enhanced
+ *
+ * @param   vargs   Pointer to the shared struct stream_args
+ *
+ * @return          Counts the frames written, sets error if the output could not be written
+ */
+void* streamWriter(void* vargs)
+{
+    struct stream_args* args = (struct stream_args*)vargs;
+
+    const size_t frame_bytes = (size_t)args->options->num_row * args->options->num_col * NUM_CHANNELS;
+
+    for (long frame = 0; acquireFilled(args->write_ring, frame) == 0; frame++)
+    {
+        const size_t bytes_written = fwrite(args->raw_out[frame % STREAM_SLOTS], 1, frame_bytes, args->output);
+        releaseFrame(args->write_ring, frame);
+
+        if (bytes_written != frame_bytes)
+        {
+            printf("Output stream closed after %ld frames\n", frame);
+            args->error = 1;
+            finishRing(args->write_ring);
+            break;
+        }
+
+        args->frames_written++;
+    }
+
+    fflush(args->output);
+    return NULL;
+}
+
+/**
+ * Enhances a stream of raw RGB24 frames from stdin and writes the enhanced frames to stdout in the same format.
+ * All frame buffers are allocated once up front. The next frame is read and the previous one written while the current
+ * frame is enhanced. Progress messages go to stderr.
+ *
+ * @param   options     Frame size and number of frames
+ *
+ * @return              Returns 0 if the whole stream was processed, -1 otherwise.
+ */
+int runStream(const struct StreamOptions* options)
+{
+    if (options->num_row <= 0 || options->num_col <= 0)
+    {
+        printf("Invalid frame size %d x %d\n", options->num_col, options->num_row);
+        return -1;
+    }
+
+    // Claim stdout for the frames before anything else is printed
+    FILE* output = getImageStdout();
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#else
+    // A closed downstream pipe should fail the writes (see streamWriter) rather than kill the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    const int num_row = options->num_row;
+    const int num_col = options->num_col;
+    const size_t num_pixels = (size_t)num_row * num_col;
+    const size_t frame_bytes = num_pixels * NUM_CHANNELS;
+
+    struct FrameRing read_ring, write_ring;
+    struct stream_args args;
+    memset(&args, 0, sizeof(args));
+
+    args.options = options;
+    args.input = stdin;
+    args.output = output;
+    args.read_ring = &read_ring;
+    args.write_ring = &write_ring;
+
+    // Every buffer the stream needs, allocated once
+    struct Workspace ws;
+    int status = initWorkspace(&ws, calcFusionWorkspace(num_row, num_col));
+    float* result = malloc(sizeof(float) * frame_bytes);
+    status |= (result == NULL);
+
+    args.raw_in = malloc(frame_bytes);
+    status |= (args.raw_in == NULL);
+
+    for (int i = 0; i < STREAM_SLOTS; i++)
+    {
+        args.planar[i] = malloc(sizeof(float) * frame_bytes);
+        args.raw_out[i] = malloc(frame_bytes);
+        status |= (args.planar[i] == NULL || args.raw_out[i] == NULL);
+    }
+
+    if (status != 0)
+    {
+        printf("Not enough memory for %d x %d frames\n", num_col, num_row);
+        freeWorkspace(&ws);
+        free(result);
+        free(args.raw_in);
+        for (int i = 0; i < STREAM_SLOTS; i++)
+        {
+            free(args.planar[i]);
+            free(args.raw_out[i]);
+        }
+        return -1;
+    }
+
+    initRing(&read_ring);
+    initRing(&write_ring);
+
+    const double start = getWallTime();
+
+    pthread_t reader, writer;
+    pthread_create(&reader, NULL, streamReader, &args);
+    pthread_create(&writer, NULL, streamWriter, &args);
+
+    // Enhance each frame on this thread
+    long frame = 0;
+    for (; acquireFilled(&read_ring, frame) == 0; frame++)
+    {
+        const int slot = (int)(frame % STREAM_SLOTS);
+
+        enhanceImageRef(args.planar[slot], result, num_row, num_col, &ws);
+        releaseFrame(&read_ring, frame);
+
+        if (acquireEmpty(&write_ring, frame) != 0)
+            break;
+
+        planarToInterleaved(result, num_pixels, args.raw_out[slot], num_pixels, NUM_CHANNELS, 255);
+
+        publishFrame(&write_ring, frame);
+    }
+
+    // Stop the reader if the writer gave up (it stops polling the input, see readFrameBytes), then let the writer drain
+    finishRing(&read_ring);
+    finishRing(&write_ring);
+
+    pthread_join(reader, NULL);
+    pthread_join(writer, NULL);
+
+    const double elapsed = getWallTime() - start;
+    printf("Enhanced %ld frames of %d x %d in %.3f seconds (%.2f frames/s)\n", args.frames_written, num_col, num_row, elapsed,
+        (elapsed > 0) ? args.frames_written / elapsed : 0.0);
+    printf("Workspace peak %zu of %zu MB\n", ws.peak >> 20, ws.capacity >> 20);
+
+    destroyRing(&read_ring);
+    destroyRing(&write_ring);
+    freeWorkspace(&ws);
+    free(result);
+    free(args.raw_in);
+    for (int i = 0; i < STREAM_SLOTS; i++)
+    {
+        free(args.planar[i]);
+        free(args.raw_out[i]);
+    }
+
+    return args.error ? -1 : 0;
+}
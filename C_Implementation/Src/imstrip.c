@@ -0,0 +1,722 @@
+#include "../Inc/imstrip.h"
+
+/**
+ * Moves to an absolute position in a file, with 64 bit offsets on every platform
+ */
+static int seekFile(FILE* file, const uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/**
+ * Returns the current position in a file, with 64 bit offsets on every platform
+ */
+static uint64_t tellFile(FILE* file)
+{
+#ifdef _WIN32
+    return (uint64_t)_ftelli64(file);
+#else
+    return (uint64_t)ftello(file);
+#endif
+}
+
+/**
+ * Adds the values of a plane to a running sum. The sum is kept in a double and accumulated in order so that
+ * consecutive bands give exactly the same result as calcChannelAverages on the whole plane.
+ */
+static void accumulateSum(double* sum, const float* plane, const int num_pixels)
+{
+    double total = *sum;
+
+    for (int i = 0; i < num_pixels; i++)
+        total += plane[i];
+
+    *sum = total;
+    return;
+}
+
+/**
+ * Updates a running maximum with the values of a band, starting from the first pixel like normalizeWeight does
+ */
+static void updateMax(float* max, const float* weight, const int num_pixels, const int first_band)
+{
+    float current = first_band ? weight[0] : *max;
+
+    for (int i = 0; i < num_pixels; i++)
+        current = MAX(current, weight[i]);
+
+    *max = current;
+    return;
+}
+
+/**
+ * Turns the sums gathered by a pass into the statistics the next passes need
+ */
+static void finishStripPass(struct StripStats* stats, const enum StripPass pass, const int num_row, const int num_col)
+{
+    // Counted in 64 bits, strip mode images may have more pixels than an int holds
+    const int64_t num_pixels = (int64_t)num_row * num_col;
+
+    if (pass == PASS_CHANNELS)
+    {
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            stats->channel_avg[i] = (float)(stats->channel_sum[i] / (double)num_pixels);
+
+        float illuminants[NUM_CHANNELS] = { FIXED_ILLUMINANT_RED, FIXED_ILLUMINANT_GREEN, FIXED_ILLUMINANT_BLUE };
+        calcGreyWorldTransform(illuminants, stats->transformation);
+    }
+
+    else if (pass == PASS_FIRST_STATS)
+    {
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            stats->gamma.lab_avg[i] = (float)(stats->gamma.lab_sum[i] / (double)num_pixels);
+
+        calcEqualizationTable(stats->histogram, num_pixels, stats->new_grey);
+    }
+
+    else if (pass == PASS_SHARP_STATS)
+    {
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            stats->sharp.lab_avg[i] = (float)(stats->sharp.lab_sum[i] / (double)num_pixels);
+    }
+
+    return;
+}
+
+/**
+ * Returns the rows of context read above and below each band. The saliency weight of the sharpened image blurs an image
+ * that was itself produced by a blur (and the Laplacian is 3 x 3), so two blur radii are needed for the band to be exact.
+ * The recursive blur has no finite radius, its margin makes the bands match the whole image to within rounding.
+ *
+ * @return                  Rows of context, at least 2
+ */
+int calcStripHalo(void)
+{
+    int unsharp_radius = GAUSSIAN_RADIUS;
+    int saliency_radius = GAUSSIAN_RADIUS;
+    int radii[STACKED_BOXES];
+
+    if (UNSHARP_BLUR == BLUR_RECURSIVE)
+        unsharp_radius = RECURSIVE_MARGIN(GAUSSIAN_SIGMA);
+
+    else if (UNSHARP_BLUR == BLUR_BOX)
+        unsharp_radius = calcStackedBoxRadii(GAUSSIAN_SIGMA, radii);
+
+    if (SALIENCY_BLUR == BLUR_RECURSIVE)
+        saliency_radius = RECURSIVE_MARGIN(GAUSSIAN_SIGMA);
+
+    else if (SALIENCY_BLUR == BLUR_BOX)
+        saliency_radius = calcStackedBoxRadii(GAUSSIAN_SIGMA, radii);
+
+    // Sharpened image then either its Laplacian or its saliency blur
+    const int halo = unsharp_radius + ((saliency_radius > 1) ? saliency_radius : 1);
+
+    return (halo > 2) ? halo : 2;
+}
+
+/**
+ * Returns the number of rows per band so that the workspace of a band fits in the memory budget, and so that the planes
+ * of a band can be indexed with an int like the rest of the pipeline
+ *
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   memory_budget   Bytes the bands may use
+ *
+ * @return                  Rows per band, 0 if not even a single row fits
+ */
+int calcStripRows(const int num_row, const int num_col, const size_t memory_budget)
+{
+    // Start from the estimate ignoring alignment, then back off until it really fits
+    const size_t row_bytes = sizeof(float) * ((size_t)num_col + 2) * FUSION_WORKSPACE_PLANES;
+    long rows = (long)(memory_budget / row_bytes) - 2 * STRIP_HALO;
+
+    rows = (rows > num_row) ? num_row : rows;
+    rows = (rows > MAX_STRIP_ROWS(num_col)) ? MAX_STRIP_ROWS(num_col) : rows;
+
+    while (rows > 0 && FUSION_WORKSPACE_PLANES * calcPlaneBytes((int)rows + 2 * STRIP_HALO, num_col) > memory_budget)
+        rows--;
+
+    return (rows > 0) ? (int)rows : 0;
+}
+
+/**
+ * Enhances an image one band of rows at a time, so that the memory used is set by the budget rather than the image size.
+ * The global statistics of the algorithm (channel averages, weight maxima, LAB averages and the equalization histogram)
+ * are gathered by earlier passes over the file, the last pass produces the output. The result is identical to enhanceImage.
+ *
+ * @param   input_name      Image to enhance, a .uwi or binary Netpbm file (it is read once per pass, so not stdin)
+ * @param   output_name     Image to write, a .uwi, .ppm, .pgm or .pnm file, or "-" for a PPM on stdout
+ * @param   memory_budget   Bytes the bands may use
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int enhanceImageStrips(const char input_name[], const char output_name[], const size_t memory_budget)
+{
+    struct StripFile input, output;
+
+    if (openStripInput(input_name, &input) != 0)
+        return -1;
+
+    const int num_row = input.num_row;
+    const int num_col = input.num_col;
+    const int band_rows = calcStripRows(num_row, num_col, memory_budget);
+
+    if (band_rows == 0)
+    {
+        printf("A %zu MB budget is too small for %d columns, at least %zu MB is needed.\n", memory_budget >> 20, num_col,
+            ((FUSION_WORKSPACE_PLANES * calcPlaneBytes(1 + 2 * STRIP_HALO, num_col)) >> 20) + 1);
+        closeStripFile(&input);
+        return -1;
+    }
+
+    struct Workspace ws;
+
+    if (initWorkspace(&ws, FUSION_WORKSPACE_PLANES * calcPlaneBytes(band_rows + 2 * STRIP_HALO, num_col)) != 0)
+    {
+        closeStripFile(&input);
+        return -1;
+    }
+
+    if (openStripOutput(output_name, &output, num_row, num_col) != 0)
+    {
+        freeWorkspace(&ws);
+        closeStripFile(&input);
+        return -1;
+    }
+
+    struct StripStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    const double start = getWallTime();
+    int status = 0;
+
+    for (int pass = 0; pass < NUM_STRIP_PASSES && status == 0; pass++)
+    {
+        for (int row = 0; row < num_row && status == 0; row += band_rows)
+        {
+            const int last_row = (row + band_rows < num_row) ? row + band_rows : num_row;
+            status = processStrip(&input, &output, &stats, (enum StripPass)pass, row, last_row, &ws);
+        }
+
+        finishStripPass(&stats, (enum StripPass)pass, num_row, num_col);
+    }
+
+    status |= closeStripFile(&output);
+    closeStripFile(&input);
+
+    if (status == 0)
+    {
+        const double elapsed = getWallTime() - start;
+        printf("Enhanced %d x %d image in bands of %d rows (%d passes) in %.3f seconds\n", num_col, num_row, band_rows, NUM_STRIP_PASSES, elapsed);
+        printf("Workspace peak %.1f of %.1f MB\n", ws.peak / 1048576.0, ws.capacity / 1048576.0);
+    }
+
+    else
+        printf("Strip processing of %s failed.\n", input_name);
+
+    freeWorkspace(&ws);
+
+    return status;
+}
+
+/**
+ * Runs one pass of the strip pipeline over a band of rows. The band is read with STRIP_HALO extra rows above and below
+ * so the 3 x 3 filters see the same neighbours they would on the whole image.
+ *
+ * @param   input       Image being enhanced
+ * @param   output      Image being written (only used by PASS_FUSION)
+ * @param   stats       Global statistics, the ones of earlier passes are used and the ones of this pass are accumulated
+ * @param   pass        The pass to run
+ * @param   first_row   First row of the band
+ * @param   last_row    One past the last row of the band
+ * @param   ws          Workspace sized by calcStripRows
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int processStrip(struct StripFile* input, struct StripFile* output, struct StripStats* stats, const enum StripPass pass,
+    const int first_row, const int last_row, struct Workspace* ws)
+{
+    const int num_col = input->num_col;
+    const int ext_first = (first_row - STRIP_HALO > 0) ? first_row - STRIP_HALO : 0;
+    const int ext_last = (last_row + STRIP_HALO < input->num_row) ? last_row + STRIP_HALO : input->num_row;
+    const int num_rows = ext_last - ext_first;
+    const int num_pixels = num_rows * num_col;
+
+    // Position and size of the band inside the extended planes
+    const int offset = (first_row - ext_first) * num_col;
+    const int band_pixels = (last_row - first_row) * num_col;
+    const int first_band = (first_row == 0);
+
+    float* white = takePlanes(ws, num_pixels * NUM_CHANNELS);
+    float* image = takePlanes(ws, num_pixels * NUM_CHANNELS);
+
+    if (readStripRows(input, ext_first, num_rows, image, ws) != 0)
+    {
+        releasePlanes(ws, image);
+        releasePlanes(ws, white);
+        return -1;
+    }
+
+    if (pass == PASS_CHANNELS)
+    {
+        for (int i = 0; i < NUM_CHANNELS; i++)
+            accumulateSum(&stats->channel_sum[i], &image[num_pixels * i + offset], band_pixels);
+
+        releasePlanes(ws, image);
+        releasePlanes(ws, white);
+        return 0;
+    }
+
+    // White balance using the averages of the whole image
+    applyWhiteBalancePixels(image, white, num_pixels, stats->channel_avg, 1, stats->transformation);
+    releasePlanes(ws, image);
+
+    const enum WeightStage gamma_stage = (pass == PASS_FIRST_STATS) ? WEIGHT_FIRST_STATS :
+        (pass == PASS_SHARP_STATS) ? WEIGHT_SALIENCY_STATS : (pass == PASS_FUSION) ? WEIGHT_APPLY : WEIGHT_NONE;
+
+    const enum WeightStage sharp_stage = (pass == PASS_SHARP_STATS) ? WEIGHT_FIRST_STATS :
+        (pass == PASS_SHARP_SALIENCY) ? WEIGHT_SALIENCY_STATS : (pass == PASS_FUSION) ? WEIGHT_APPLY : WEIGHT_NONE;
+
+    // Weights of the gamma corrected image, with HALF_WEIGHTS the weights are halves taken two to a float
+    const size_t weight_floats = HALF_WEIGHTS ? ((size_t)num_pixels + 1) / 2 : (size_t)num_pixels;
+    float* gamma_weight = takePlanes(ws, weight_floats);
+
+    if (gamma_stage != WEIGHT_NONE)
+    {
+        float* gamma = takePlanes(ws, num_pixels * NUM_CHANNELS);
+        correctGammaRef(white, gamma, num_pixels, 1.2);
+        processStripWeights(gamma, gamma_weight, num_rows, num_col, offset, band_pixels, &stats->gamma, gamma_stage, first_band, ws);
+        releasePlanes(ws, gamma);
+    }
+
+    // Unsharp masking, the equalization table is known from the second pass on
+    float* sharp_weight = takePlanes(ws, weight_floats);
+    float* sharp = takePlanes(ws, num_pixels * NUM_CHANNELS);
+    float* mask = takePlanes(ws, num_pixels * NUM_CHANNELS);
+    calcUnsharpMaskRef(white, mask, num_rows, num_col, ws);
+
+    if (pass == PASS_FIRST_STATS)
+        calcMaskHistogram(mask, num_pixels, offset, offset + band_pixels, stats->histogram);
+
+    else
+        blendUnsharpMaskRef(white, mask, sharp, num_pixels, stats->new_grey);
+
+    releasePlanes(ws, mask);
+
+    // Weights of the sharpened image
+    if (sharp_stage != WEIGHT_NONE)
+        processStripWeights(sharp, sharp_weight, num_rows, num_col, offset, band_pixels, &stats->sharp, sharp_stage, first_band, ws);
+
+    releasePlanes(ws, sharp);
+
+    // Fuse and write out the rows of the band
+    int status = 0;
+
+    if (pass == PASS_FUSION)
+    {
+        float* fused = takePlanes(ws, num_pixels * NUM_CHANNELS);
+#if HALF_WEIGHTS
+        applyFusionHalfRef(white, (half*)gamma_weight, (half*)sharp_weight, fused, num_rows, num_col);
+#else
+        applyFusionRef(white, gamma_weight, sharp_weight, fused, num_rows, num_col);
+#endif
+        status = writeStripRows(output, first_row, last_row - first_row, &fused[offset], num_pixels, ws);
+        releasePlanes(ws, fused);
+    }
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, sharp_weight);
+    releasePlanes(ws, gamma_weight);
+    releasePlanes(ws, white);
+
+    return status;
+}
+
+/**
+ * Computes one stage of the combined weight (see getWeightsRef) for a band. The statistics stages only look at the
+ * rows of the band itself, the halo rows are there to feed the filters.
+ *
+ * @param   image           Extended band of the gamma corrected or sharpened image
+ * @param   weight          Memory to place the combined weight of the extended band to (WEIGHT_APPLY only), halves with HALF_WEIGHTS
+ * @param   num_row         Number of rows in the extended band
+ * @param   num_col         Number of columns in the image
+ * @param   offset          Index of the first pixel of the band inside the extended band
+ * @param   band_pixels     Number of pixels in the band
+ * @param   stats           Statistics of this weight map
+ * @param   stage           What to compute
+ * @param   first_band      1 for the band starting at the first row of the image
+ * @param   ws              Workspace for temporaries
+ *
+ * @return                  Updates stats or fills in weight
+ */
+void processStripWeights(float* image, float* weight, const int num_row, const int num_col, const int offset, const int band_pixels,
+    struct WeightStats* stats, const enum WeightStage stage, const int first_band, struct Workspace* ws)
+{
+    const int num_pixels = num_row * num_col;
+
+    if (stage == WEIGHT_NONE)
+        return;
+
+    float* lum = takePlanes(ws, num_pixels);
+    float* temp = takePlanes(ws, num_pixels);
+    float* blurred = takePlanes(ws, num_pixels * NUM_CHANNELS);
+
+    calcLuminanceRef(image, lum, num_pixels, LUM_OPTION);
+
+    if (stage == WEIGHT_FIRST_STATS)
+    {
+        calcLaplacianWeightRef(lum, temp, num_row, num_col, ws);
+        updateMax(&stats->max_laplacian, &temp[offset], band_pixels, first_band);
+
+        calcSaturationWeightRef(image, lum, temp, num_pixels);
+        updateMax(&stats->max_saturation, &temp[offset], band_pixels, first_band);
+
+        // LAB sums of the band only, in the same order as over the whole image
+        calcSaliencyBlurRef(image, blurred, num_row, num_col, ws);
+        calcLABSums(blurred, num_pixels, offset, offset + band_pixels, stats->lab_sum);
+    }
+
+    else if (stage == WEIGHT_SALIENCY_STATS)
+    {
+        calcSaliencyBlurRef(image, blurred, num_row, num_col, ws);
+        calcLABDistanceRef(blurred, temp, num_pixels, stats->lab_avg);
+        updateMax(&stats->max_saliency, &temp[offset], band_pixels, first_band);
+    }
+
+#if HALF_WEIGHTS
+    else
+    {
+        // Same order of operations as getWeightsHalfRef, rounding the total to halves after every weight
+        half* total_weight = (half*)weight;
+
+        calcLaplacianWeightRef(lum, temp, num_row, num_col, ws);
+
+        for (int i = 0; i < num_pixels; i++)
+            temp[i] /= stats->max_laplacian;
+
+        packHalf(temp, total_weight, num_pixels);
+
+        calcSaliencyBlurRef(image, blurred, num_row, num_col, ws);
+        calcLABDistanceRef(blurred, temp, num_pixels, stats->lab_avg);
+
+        for (int i = 0; i < num_pixels; i++)
+            temp[i] /= stats->max_saliency;
+
+        addHalf(total_weight, temp, num_pixels);
+
+        calcSaturationWeightRef(image, lum, temp, num_pixels);
+
+        for (int i = 0; i < num_pixels; i++)
+            temp[i] /= stats->max_saturation;
+
+        addHalf(total_weight, temp, num_pixels);
+    }
+#else
+    else
+    {
+        // Same order of operations as getWeightsRef with normalizeWeight
+        calcLaplacianWeightRef(lum, weight, num_row, num_col, ws);
+
+        for (int i = 0; i < num_pixels; i++)
+            weight[i] /= stats->max_laplacian;
+
+        calcSaliencyBlurRef(image, blurred, num_row, num_col, ws);
+        calcLABDistanceRef(blurred, temp, num_pixels, stats->lab_avg);
+
+        for (int i = 0; i < num_pixels; i++)
+        {
+            temp[i] /= stats->max_saliency;
+            weight[i] += temp[i];
+        }
+
+        calcSaturationWeightRef(image, lum, temp, num_pixels);
+
+        for (int i = 0; i < num_pixels; i++)
+        {
+            temp[i] /= stats->max_saturation;
+            weight[i] += temp[i];
+        }
+    }
+#endif
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, blurred);
+    releasePlanes(ws, temp);
+    releasePlanes(ws, lum);
+
+    return;
+}
+
+/**
+ * Opens an image for reading bands of rows
+ *
+ * @param   file_name   A .uwi or binary Netpbm file
+ * @param   input       Set up for readStripRows
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int openStripInput(const char file_name[], struct StripFile* input)
+{
+    memset(input, 0, sizeof(*input));
+
+    if (strcmp(file_name, NETPBM_STDIO) == 0 || !(isBinaryImageFile(file_name) || isNetpbmFile(file_name)))
+    {
+        printf("Strip mode reads .uwi, .ppm, .pgm or .pnm files, %s is not supported.\n", file_name);
+        return -1;
+    }
+
+    input->file = fopen(file_name, "rb");
+    if (input->file == NULL)
+    {
+        printf("File was not opened\n");
+        return -1;
+    }
+
+    if (isBinaryImageFile(file_name))
+    {
+        input->format = STRIP_BINARY;
+
+        // The header check needs the size of the file
+        fseek(input->file, 0, SEEK_END);
+        const uint64_t file_size = tellFile(input->file);
+        seekFile(input->file, 0);
+
+        if (file_size < UWI_HEADER_SIZE || fread(&input->header, sizeof(input->header), 1, input->file) != 1 ||
+            checkBinaryHeader(&input->header, (size_t)file_size) != 0)
+        {
+            printf("Invalid binary image %s\n", file_name);
+            closeStripFile(input);
+            return -1;
+        }
+
+        input->num_row = (int)input->header.num_row;
+        input->num_col = (int)input->header.num_col;
+        input->num_channels = NUM_CHANNELS;
+        input->data_offset = input->header.data_offset;
+    }
+
+    else
+    {
+        int magic = 0;
+        input->format = STRIP_NETPBM;
+
+        if (readNetpbmHeader(input->file, &magic, &input->num_row, &input->num_col, &input->max_val) != 0)
+        {
+            printf("Invalid Netpbm header.\n");
+            closeStripFile(input);
+            return -1;
+        }
+
+        input->num_channels = (magic == 6) ? NUM_CHANNELS : 1;
+        input->data_offset = tellFile(input->file);
+    }
+
+    // The bands are enhanced with int pixel counts, so a single row and its halo must fit
+    if (MAX_STRIP_ROWS(input->num_col) < 1)
+    {
+        printf("%s has %d columns, too many for strip mode.\n", file_name, input->num_col);
+        closeStripFile(input);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Creates an image for writing bands of rows. Netpbm output is written strictly in order, so it may go to stdout.
+ *
+ * @param   file_name   A .uwi (float32), .ppm, .pgm or .pnm (8 bit) file, or "-" for a PPM on the image stream (see getImageStdout)
+ * @param   output      Set up for writeStripRows
+ * @param   num_row     Number of rows in the image
+ * @param   num_col     Number of columns in the image
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int openStripOutput(const char file_name[], struct StripFile* output, const int num_row, const int num_col)
+{
+    memset(output, 0, sizeof(*output));
+    output->num_row = num_row;
+    output->num_col = num_col;
+
+    if (!(isBinaryImageFile(file_name) || isNetpbmFile(file_name)))
+    {
+        printf("Strip mode writes .uwi, .ppm, .pgm or .pnm files, %s is not supported.\n", file_name);
+        return -1;
+    }
+
+    output->is_stdout = (strcmp(file_name, NETPBM_STDIO) == 0);
+    output->file = output->is_stdout ? getImageStdout() : fopen(file_name, "wb");
+    if (output->file == NULL)
+    {
+        printf("File could not be written to.\n");
+        return -1;
+    }
+
+    int status = 0;
+
+    if (isBinaryImageFile(file_name))
+    {
+        output->format = STRIP_BINARY;
+        output->num_channels = NUM_CHANNELS;
+        initBinaryHeader(&output->header, num_row, num_col, SAMPLE_FLOAT32);
+        output->data_offset = output->header.data_offset;
+
+        status = (fwrite(&output->header, sizeof(output->header), 1, output->file) == 1) ? 0 : -1;
+    }
+
+    else
+    {
+        const size_t name_length = strlen(file_name);
+        const int greyscale = name_length >= 4 && strcmp(&file_name[name_length - 4], ".pgm") == 0;
+
+        output->format = STRIP_NETPBM;
+        output->num_channels = greyscale ? 1 : NUM_CHANNELS;
+        output->max_val = 255;
+
+        status = writeNetpbmHeader(output->file, num_row, num_col, output->max_val, greyscale);
+    }
+
+    if (status != 0)
+    {
+        printf("File could not be written to.\n");
+        closeStripFile(output);
+    }
+
+    return status;
+}
+
+/**
+ * Closes an image opened with openStripInput or openStripOutput
+ *
+ * @return      Returns 0 if everything was written successfully, -1 otherwise.
+ */
+int closeStripFile(struct StripFile* strip)
+{
+    int status = 0;
+
+    if (strip->file == NULL)
+        return 0;
+
+    // The image stream on stdout stays open for the rest of the program
+    if (strip->is_stdout)
+        status = fflush(strip->file);
+    else
+        status = fclose(strip->file);
+
+    strip->file = NULL;
+
+    return (status == 0) ? 0 : -1;
+}
+
+/**
+ * Reads a band of rows into planar floats between [0,1]
+ *
+ * @param   input       Image opened with openStripInput
+ * @param   first_row   First row to read
+ * @param   num_rows    Number of rows to read
+ * @param   image       Memory to place the rows to, three planes of num_rows x num_col
+ * @param   ws          Workspace for the raw samples
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int readStripRows(struct StripFile* input, const int first_row, const int num_rows, float* image, struct Workspace* ws)
+{
+    const int num_col = input->num_col;
+    const size_t num_pixels = (size_t)num_rows * num_col;
+    int status = 0;
+
+    if (input->format == STRIP_NETPBM)
+    {
+        // Rows are contiguous, so the whole band is a single read
+        const size_t pixel_bytes = (size_t)input->num_channels * ((input->max_val < 256) ? 1 : 2);
+        uint8_t* raw = (uint8_t*)takePlanes(ws, (num_pixels * pixel_bytes + sizeof(float) - 1) / sizeof(float));
+
+        if (seekFile(input->file, input->data_offset + (uint64_t)first_row * num_col * pixel_bytes) != 0 ||
+            fread(raw, pixel_bytes, num_pixels, input->file) != num_pixels)
+            status = -1;
+        else
+            interleavedToPlanar(raw, image, num_pixels, num_pixels, input->num_channels, input->max_val);
+
+        releasePlanes(ws, (float*)raw);
+    }
+
+    else
+    {
+        // Planes (and rows, if padded) are apart, so read row by row
+        const size_t sample_size = sampleSize(input->header.sample_type);
+        const uint64_t row_bytes = (uint64_t)input->header.row_stride * sample_size;
+        uint8_t* raw = (uint8_t*)takePlanes(ws, (num_col * sample_size + sizeof(float) - 1) / sizeof(float));
+
+        for (int channel = 0; channel < NUM_CHANNELS && status == 0; channel++)
+        {
+            for (int row = 0; row < num_rows && status == 0; row++)
+            {
+                const uint64_t position = input->data_offset + channel * input->header.plane_stride + (first_row + row) * row_bytes;
+
+                if (seekFile(input->file, position) != 0 || fread(raw, sample_size, num_col, input->file) != (size_t)num_col)
+                    status = -1;
+                else
+                    convertBinaryRow(raw, &image[channel * num_pixels + (size_t)row * num_col], num_col, input->header.sample_type);
+            }
+        }
+
+        releasePlanes(ws, (float*)raw);
+    }
+
+    if (status != 0)
+        printf("Image is truncated, could not read rows %d to %d.\n", first_row, first_row + num_rows - 1);
+
+    return status;
+}
+
+/**
+ * Writes a band of rows of the enhanced image
+ *
+ * @param   output      Image opened with openStripOutput
+ * @param   first_row   First row of the band, bands must be written in order for Netpbm output
+ * @param   num_rows    Number of rows in the band
+ * @param   image       First pixel of the band in the red plane
+ * @param   plane_size  Distance between the planes of image
+ * @param   ws          Workspace for the raw samples
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int writeStripRows(struct StripFile* output, const int first_row, const int num_rows, float* image, const size_t plane_size, struct Workspace* ws)
+{
+    const int num_col = output->num_col;
+    const size_t num_pixels = (size_t)num_rows * num_col;
+    int status = 0;
+
+    if (output->format == STRIP_NETPBM)
+    {
+        const size_t pixel_bytes = (size_t)output->num_channels;
+        uint8_t* raw = (uint8_t*)takePlanes(ws, (num_pixels * pixel_bytes + sizeof(float) - 1) / sizeof(float));
+
+        planarToInterleaved(image, plane_size, raw, num_pixels, output->num_channels, output->max_val);
+
+        if (fwrite(raw, pixel_bytes, num_pixels, output->file) != num_pixels)
+            status = -1;
+
+        releasePlanes(ws, (float*)raw);
+    }
+
+    else
+    {
+        for (int channel = 0; channel < NUM_CHANNELS && status == 0; channel++)
+        {
+            const uint64_t position = output->data_offset + channel * output->header.plane_stride + (uint64_t)first_row * num_col * sizeof(float);
+
+            if (seekFile(output->file, position) != 0 || fwrite(&image[channel * plane_size], sizeof(float), num_pixels, output->file) != num_pixels)
+                status = -1;
+        }
+    }
+
+    if (status != 0)
+        printf("Could not write rows %d to %d.\n", first_row, first_row + num_rows - 1);
+
+    return status;
+}
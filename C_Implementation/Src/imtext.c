@@ -0,0 +1,548 @@
+#include "../Inc/imtext.h"
+
+#include <limits.h>
+
+// Powers of ten that are exact in double precision
+static const double POW10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/**
+ * Checks if a character separates two samples. MATLAB writes one sample per line, imconv.py separates them with commas.
+ *
+ * @param   c   Character to check
+ *
+ * @return      Returns 1 for a separator, 0 otherwise
+ */
+static int isSeparator(const char c)
+{
+    return c == '\n' || c == ' ' || c == '\r' || c == '\t' || c == ',';
+}
+
+/**
+ * Skips over any separators
+ *
+ * @param   text    Current position in the text
+ * @param   end     One past the last character of the text
+ *
+ * @return          Pointer to the first non separator character (or end)
+ */
+const char* skipSeparators(const char* text, const char* end)
+{
+    while (text < end && isSeparator(*text))
+        text++;
+
+    return text;
+}
+
+/**
+ * Scans a single sample. Integers are 8 bit pixel values and are divided by 255, numbers with a decimal point or exponent
+ * are taken to already be between [0,1]. This replaces fscanf which is far too slow to call once per pixel.
+ *
+ * @param   text    Start of the sample, must not be a separator
+ * @param   end     One past the last character of the text
+ * @param   value   Set to the scanned sample
+ *
+ * @return          Pointer just past the sample, NULL if the text is not a number
+ */
+const char* scanSample(const char* text, const char* end, float* value)
+{
+    int negative = 0;
+    int is_float = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    uint64_t mantissa = 0;
+
+    if (text < end && (*text == '-' || *text == '+'))
+    {
+        negative = (*text == '-');
+        text++;
+    }
+
+    // Integer part, only the first 19 digits fit in the mantissa
+    for (; text < end && (unsigned)(*text - '0') < 10; text++, num_digits++)
+    {
+        if (mantissa < 1000000000000000000ULL)
+            mantissa = mantissa * 10 + (uint64_t)(*text - '0');
+        else
+            exponent++;
+    }
+
+    // Fractional part
+    if (text < end && *text == '.')
+    {
+        is_float = 1;
+        text++;
+
+        for (; text < end && (unsigned)(*text - '0') < 10; text++, num_digits++)
+        {
+            if (mantissa < 1000000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*text - '0');
+                exponent--;
+            }
+        }
+    }
+
+    if (num_digits == 0)
+        return NULL;
+
+    // Exponent
+    if (text < end && (*text == 'e' || *text == 'E'))
+    {
+        int exp_negative = 0;
+        int exp_value = 0;
+        is_float = 1;
+        text++;
+
+        if (text < end && (*text == '-' || *text == '+'))
+        {
+            exp_negative = (*text == '-');
+            text++;
+        }
+
+        if (text == end || (unsigned)(*text - '0') >= 10)
+            return NULL;
+
+        for (; text < end && (unsigned)(*text - '0') < 10; text++)
+            exp_value = (exp_value < 10000) ? exp_value * 10 + (*text - '0') : exp_value;
+
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    // The sample has to end at a separator
+    if (text < end && !isSeparator(*text))
+        return NULL;
+
+    double result = (double)mantissa;
+
+    if (exponent < 0)
+        result = (exponent >= -22) ? result / POW10[-exponent] : result * pow(10.0, exponent);
+
+    else if (exponent > 0)
+        result = (exponent <= 22) ? result * POW10[exponent] : result * pow(10.0, exponent);
+
+    result = negative ? -result : result;
+    *value = is_float ? (float)result : (float)(result / 255.0);
+
+    return text;
+}
+
+/**
+ * Reads the number of rows and columns at the start of a text bitmap
+ *
+ * @param   text        Start of the text
+ * @param   end         One past the last character of the text
+ * @param   num_row     Set to the number of rows
+ * @param   num_col     Set to the number of columns
+ *
+ * @return              Pointer to just after the header, NULL if the header is invalid or the image is too large for the pipeline
+ */
+const char* parseTextHeader(const char* text, const char* end, int* num_row, int* num_col)
+{
+    int dims[2] = { 0 };
+
+    for (int i = 0; i < 2; i++)
+    {
+        text = skipSeparators(text, end);
+
+        if (text == end || (unsigned)(*text - '0') >= 10)
+            return NULL;
+
+        for (; text < end && (unsigned)(*text - '0') < 10; text++)
+        {
+            if (dims[i] > 100000000)
+                return NULL;
+
+            dims[i] = dims[i] * 10 + (*text - '0');
+        }
+
+        if (text < end && !isSeparator(*text))
+            return NULL;
+    }
+
+    if (dims[0] <= 0 || dims[1] <= 0)
+        return NULL;
+
+    // The pipeline indexes pixels with an int, so the whole image has to fit in one (see checkBinaryHeader)
+    if ((uint64_t)dims[0] * dims[1] * NUM_CHANNELS > INT_MAX)
+    {
+        printf("Text bitmap is too large.\n");
+        return NULL;
+    }
+
+    *num_row = dims[0];
+    *num_col = dims[1];
+
+    return text;
+}
+
+/**
+ * Thread function that counts the samples in its chunk of text
+ *
+ * @param   vargs   Pointer to a struct parse_args
+ *
+ * @return          Sets num_tokens in the arguments
+ */
+void* countTokensWorker(void* vargs)
+{
+    struct parse_args* args = (struct parse_args*)vargs;
+
+    size_t num_tokens = 0;
+    int prev_separator = 1;
+
+    // A token starts at every separator -> non separator transition
+    for (const char* text = args->start; text < args->end; text++)
+    {
+        const int separator = isSeparator(*text);
+        num_tokens += prev_separator & !separator;
+        prev_separator = separator;
+    }
+
+    args->num_tokens = num_tokens;
+    return NULL;
+}
+
+/**
+ * Thread function that scans each sample of its chunk straight into its slot of the output image
+ *
+ * @param   vargs   Pointer to a struct parse_args, output must point to the slot of the first sample of the chunk
+ *
+ * @return          Sets error if a sample could not be scanned
+ */
+void* parseTokensWorker(void* vargs)
+{
+    struct parse_args* args = (struct parse_args*)vargs;
+
+    const char* text = skipSeparators(args->start, args->end);
+    float* output = args->output;
+
+    for (size_t i = 0; i < args->num_tokens; i++)
+    {
+        text = scanSample(text, args->end, &output[i]);
+
+        if (text == NULL)
+        {
+            args->error = 1;
+            return NULL;
+        }
+
+        text = skipSeparators(text, args->end);
+    }
+
+    return NULL;
+}
+
+/**
+ * Parses samples from text in parallel. The text is split into chunks that begin and end on separators, the samples
+ * in each chunk are counted, and then every chunk is scanned straight into its place in the output.
+ *
+ * @param   text            Start of the samples
+ * @param   end             One past the last character of the text
+ * @param   output          Array to store the samples in
+ * @param   num_samples     Number of samples expected in the text
+ * @param   num_threads     Number of threads to split the work over
+ *
+ * @return                  Returns 0 if exactly num_samples valid samples were read, -1 otherwise.
+ */
+int parseTextSamples(const char* text, const char* end, float* output, const size_t num_samples, int num_threads)
+{
+    const size_t length = (size_t)(end - text);
+    struct parse_args args[MAX_THREADS];
+
+    // Don't bother splitting up small files
+    if ((size_t)num_threads * MIN_PARSE_CHUNK > length)
+        num_threads = (int)(length / MIN_PARSE_CHUNK);
+
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+    num_threads = (num_threads > MAX_THREADS) ? MAX_THREADS : num_threads;
+
+    // Split on separators so no sample is shared between two chunks
+    const char* chunk_start = text;
+    for (int i = 0; i < num_threads; i++)
+    {
+        const char* chunk_end = (i == num_threads - 1) ? end : text + length * (i + 1) / num_threads;
+
+        while (chunk_end < end && !isSeparator(*chunk_end))
+            chunk_end++;
+
+        chunk_end = (chunk_end < chunk_start) ? chunk_start : chunk_end;
+
+        args[i].start = chunk_start;
+        args[i].end = chunk_end;
+        args[i].output = NULL;
+        args[i].num_tokens = 0;
+        args[i].error = 0;
+
+        chunk_start = chunk_end;
+    }
+
+    runParallel(countTokensWorker, args, sizeof(struct parse_args), num_threads);
+
+    // Turn the counts into the index of the first sample of every chunk
+    size_t total = 0;
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].output = &output[total < num_samples ? total : num_samples];
+        total += args[i].num_tokens;
+    }
+
+    if (total != num_samples)
+    {
+        printf("Expected %zu pixel values but found %zu.\n", num_samples, total);
+        return -1;
+    }
+
+    runParallel(parseTokensWorker, args, sizeof(struct parse_args), num_threads);
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        if (args[i].error)
+        {
+            printf("Invalid pixel value in chunk %d.\n", i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Reads a text bitmap by mapping it and parsing the samples on every core.
+ *
+ * @param   file_name       File name of the bitmap representing the image (.txt)
+ *
+ * @return                  Returns a structure with the number of rows, number of columns and a pointer to the planar RGB image.
+ *                          On failure the dimensions are -1 and the image is NULL.
+ */
+struct Image readImageText(const char file_name[])
+{
+    struct Image im = { -1, -1, NULL, NULL, 0 };
+
+    const double start = getWallTime();
+
+    size_t mapping_size = 0;
+    const char* mapping = mapImageFile(file_name, &mapping_size);
+
+    if (mapping == NULL)
+    {
+        printf("File was not opened\n");
+        return im;
+    }
+
+    const char* end = mapping + mapping_size;
+    int num_row = 0, num_col = 0;
+
+    const char* body = parseTextHeader(mapping, end, &num_row, &num_col);
+    if (body == NULL)
+    {
+        printf("Invalid image dimensions in the header.\n");
+        unmapImageFile((void*)mapping, mapping_size);
+        return im;
+    }
+
+    // Allocate memory for the image
+    const size_t num_rgb_pixels = (size_t)num_row * num_col * NUM_CHANNELS;
+    float* rgb_image = malloc(sizeof(float) * num_rgb_pixels);
+
+    if (rgb_image == NULL)
+    {
+        printf("Not enough memory to read the image.\n");
+        unmapImageFile((void*)mapping, mapping_size);
+        return im;
+    }
+
+    const int status = parseTextSamples(body, end, rgb_image, num_rgb_pixels, getNumThreads());
+    unmapImageFile((void*)mapping, mapping_size);
+
+    if (status != 0)
+    {
+        free(rgb_image);
+        return im;
+    }
+
+    im.num_row = num_row;
+    im.num_col = num_col;
+    im.rgb_image = rgb_image;
+
+    const double elapsed = getWallTime() - start;
+    const double megabytes = (double)mapping_size / (1024.0 * 1024.0);
+    printf("File was read successfully! (%.1f MB at %.1f MB/s)\n", megabytes, (elapsed > 0) ? megabytes / elapsed : 0.0);
+
+    return im;
+}
+
+/**
+ * Formats a single sample followed by a newline. TEXT_FLOAT6 gives the same text as printf("%.6f\n") without going through
+ * printf, TEXT_UINT8 clips the sample to [0,1] and writes the nearest 8 bit value like the input bitmaps.
+ *
+ * @param   text    Where to write the sample, needs room for MAX_SAMPLE_CHARS characters
+ * @param   value   Sample to format
+ * @param   format  TEXT_FLOAT6 or TEXT_UINT8
+ *
+ * @return          Pointer just past the newline
+ */
+char* formatSample(char* text, const float value, const enum TextFormat format)
+{
+    char digits[20];
+    int num_digits = 0;
+
+    if (format == TEXT_UINT8)
+    {
+        float pixel = (value > 0) ? value : 0;
+        pixel = (pixel > 1) ? 1 : pixel;
+
+        unsigned int quantized = (unsigned int)(pixel * 255.0f + 0.5f);
+
+        if (quantized >= 100)
+            *text++ = (char)('0' + quantized / 100);
+        if (quantized >= 10)
+            *text++ = (char)('0' + (quantized / 10) % 10);
+
+        *text++ = (char)('0' + quantized % 10);
+        *text++ = '\n';
+
+        return text;
+    }
+
+    // Leave anything that does not fit in the fixed point representation (including inf and NaN) to printf
+    const double magnitude = fabs((double)value);
+    if (!(magnitude < 1e12))
+        return text + snprintf(text, MAX_SAMPLE_CHARS, "%.6f\n", value);
+
+    // Fixed point with 6 decimals. A float times 1e6 is exact in double precision, so ties can be rounded to even like printf
+    const double exact = magnitude * 1e6;
+    uint64_t scaled = (uint64_t)exact;
+    const double remainder = exact - (double)scaled;
+
+    if (remainder > 0.5 || (remainder == 0.5 && (scaled & 1)))
+        scaled++;
+
+    uint64_t int_part = scaled / 1000000;
+    uint32_t frac_part = (uint32_t)(scaled % 1000000);
+
+    if (signbit(value))
+        *text++ = '-';
+
+    do
+    {
+        digits[num_digits++] = (char)('0' + int_part % 10);
+        int_part /= 10;
+    } while (int_part > 0);
+
+    while (num_digits > 0)
+        *text++ = digits[--num_digits];
+
+    *text++ = '.';
+
+    for (int i = 5; i >= 0; i--)
+    {
+        text[i] = (char)('0' + frac_part % 10);
+        frac_part /= 10;
+    }
+
+    text += 6;
+    *text++ = '\n';
+
+    return text;
+}
+
+/**
+ * Thread function that formats its chunk of samples into its own buffer
+ *
+ * @param   vargs   Pointer to a struct format_args, buffer must hold num_samples * MAX_SAMPLE_CHARS characters
+ *
+ * @return          Sets length to the number of characters written
+ */
+void* formatSamplesWorker(void* vargs)
+{
+    struct format_args* args = (struct format_args*)vargs;
+
+    char* text = args->buffer;
+
+    for (size_t i = 0; i < args->num_samples; i++)
+        text = formatSample(text, args->samples[i], args->format);
+
+    args->length = (size_t)(text - args->buffer);
+    return NULL;
+}
+
+/**
+ * Writes a text bitmap. The samples are formatted on every core, FORMAT_CHUNK_SAMPLES at a time per thread, and the chunks
+ * are written out in order with one large write each.
+ *
+ * @param   file_location   Full file name of the text bitmap
+ * @param   image           RGB image to be written
+ * @param   num_row         Number of rows in the image
+ * @param   num_col         Number of columns in the image
+ * @param   format          TEXT_FLOAT6 for floats between [0,1] or TEXT_UINT8 for 8 bit values (about a third of the size)
+ *
+ * @return                  Returns 0 if successful, -1 otherwise.
+ */
+int writeImageText(const char file_location[], float* image, const int num_row, const int num_col, const enum TextFormat format)
+{
+    const double start = getWallTime();
+    const size_t num_rgb_pixels = (size_t)num_row * num_col * NUM_CHANNELS;
+
+    int num_threads = getNumThreads();
+    struct format_args args[MAX_THREADS];
+
+    // Check if we can write to the file
+    FILE* image_file = fopen(file_location, "wb");
+    if (image_file == NULL)
+    {
+        printf("File could not be written to.\n");
+        return -1;
+    }
+
+    char* buffers = malloc((size_t)num_threads * FORMAT_CHUNK_SAMPLES * MAX_SAMPLE_CHARS);
+    if (buffers == NULL)
+    {
+        printf("Not enough memory to write the image.\n");
+        fclose(image_file);
+        return -1;
+    }
+
+    // Write the number of rows and columns
+    int status = (fprintf(image_file, "%d\n%d\n", num_row, num_col) > 0) ? 0 : -1;
+    size_t bytes_written = 0;
+
+    // Format a round of chunks in parallel, then write them out in order
+    for (size_t first = 0; first < num_rgb_pixels && status == 0; first += (size_t)num_threads * FORMAT_CHUNK_SAMPLES)
+    {
+        int num_chunks = 0;
+
+        for (size_t offset = first; offset < num_rgb_pixels && num_chunks < num_threads; offset += FORMAT_CHUNK_SAMPLES, num_chunks++)
+        {
+            args[num_chunks].samples = &image[offset];
+            args[num_chunks].num_samples = (num_rgb_pixels - offset < FORMAT_CHUNK_SAMPLES) ? num_rgb_pixels - offset : FORMAT_CHUNK_SAMPLES;
+            args[num_chunks].buffer = &buffers[(size_t)num_chunks * FORMAT_CHUNK_SAMPLES * MAX_SAMPLE_CHARS];
+            args[num_chunks].length = 0;
+            args[num_chunks].format = format;
+        }
+
+        runParallel(formatSamplesWorker, args, sizeof(struct format_args), num_chunks);
+
+        for (int i = 0; i < num_chunks && status == 0; i++)
+        {
+            if (fwrite(args[i].buffer, 1, args[i].length, image_file) != args[i].length)
+                status = -1;
+
+            bytes_written += args[i].length;
+        }
+    }
+
+    free(buffers);
+
+    if (fclose(image_file) != 0 || status != 0)
+    {
+        printf("Image was not written completely.\n");
+        return -1;
+    }
+
+    const double elapsed = getWallTime() - start;
+    const double megabytes = (double)bytes_written / (1024.0 * 1024.0);
+    printf("Image was written successfully! (%.1f MB at %.1f MB/s)\n", megabytes, (elapsed > 0) ? megabytes / elapsed : 0.0);
+
+    return 0;
+}
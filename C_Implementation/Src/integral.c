@@ -0,0 +1,297 @@
+#include "../Inc/integral.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * Returns the number of floats a summed-area table takes from a workspace (see takePlanes)
+ *
+ * @param   num_row     Number of rows in the image
+ * @param   num_col     Number of columns in the image
+ *
+ * @return              Number of floats to take
+ */
+size_t calcIntegralFloats(const int num_row, const int num_col)
+{
+    return 2 * (size_t)(num_row + 1) * (num_col + 1);
+}
+
+/**
+ * First phase of the build: the running sum along each row in [first, last)
+ */
+void* integralRowsWorker(void* vargs)
+{
+    struct integral_args* args = (struct integral_args*)vargs;
+    const size_t stride = (size_t)args->num_col + 1;
+
+    for (int y = args->first; y < args->last; y++)
+    {
+        const float* input = &args->plane[(size_t)y * args->num_col];
+        double* row = &args->table[(y + 1) * stride];
+        double sum = 0;
+
+        row[0] = 0;
+
+        for (int x = 0; x < args->num_col; x++)
+        {
+            sum += args->squared ? (double)input[x] * input[x] : input[x];
+            row[x + 1] = sum;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Second phase of the build: adds each row to the one below it for the columns in [first, last). Every thread
+ * walks down the rows in order, so its accesses stay sequential within its columns.
+ */
+void* integralColumnsWorker(void* vargs)
+{
+    struct integral_args* args = (struct integral_args*)vargs;
+    const size_t stride = (size_t)args->num_col + 1;
+
+    for (int y = 2; y <= args->num_row; y++)
+    {
+        double* row = &args->table[y * stride];
+        const double* above = &args->table[(y - 1) * stride];
+
+        for (int x = args->first; x < args->last; x++)
+            row[x] += above[x];
+    }
+
+    return NULL;
+}
+
+/**
+ * Builds the summed-area table of a plane (or of its squares) as a parallel prefix sum: the rows are summed on
+ * their own, then the columns, each phase split between the threads (see getNumThreads).
+ *
+ * @param   plane       The plane to sum up
+ * @param   table       Memory to place the (num_row + 1) x (num_col + 1) table to
+ * @param   num_row     Number of rows in the plane
+ * @param   num_col     Number of columns in the plane
+ * @param   squared     1 to sum up the squares of the pixels instead
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void buildIntegralImage(const float* plane, double* table, const int num_row, const int num_col, const int squared)
+{
+    struct integral_args args[MAX_THREADS];
+    const size_t num_pixels = (size_t)num_row * num_col;
+
+    int num_threads = (num_pixels >= MIN_PARALLEL_INTEGRAL) ? getNumThreads() : 1;
+    num_threads = (num_threads > num_row) ? num_row : num_threads;
+    num_threads = (num_threads > num_col) ? num_col : num_threads;
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+
+    // The first row of the table stays zero
+    for (int x = 0; x <= num_col; x++)
+        table[x] = 0;
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].plane = plane;
+        args[i].table = table;
+        args[i].num_row = num_row;
+        args[i].num_col = num_col;
+        args[i].first = (int)((long)num_row * i / num_threads);
+        args[i].last = (int)((long)num_row * (i + 1) / num_threads);
+        args[i].squared = squared;
+    }
+
+    runParallel(integralRowsWorker, args, sizeof(struct integral_args), num_threads);
+
+    // Column ranges of the table (column 0 is zero already)
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].first = 1 + (int)((long)num_col * i / num_threads);
+        args[i].last = 1 + (int)((long)num_col * (i + 1) / num_threads);
+    }
+
+    runParallel(integralColumnsWorker, args, sizeof(struct integral_args), num_threads);
+
+    return;
+}
+
+/**
+ * Sums up the pixels of a rectangle in constant time. The rectangle is clipped to the image, so windows hanging
+ * over the border only count the pixels inside it (the same as zero padding).
+ *
+ * @param   table       Summed-area table of the plane (see buildIntegralImage)
+ * @param   num_row     Number of rows in the plane
+ * @param   num_col     Number of columns in the plane
+ * @param   top         First row of the rectangle
+ * @param   left        First column of the rectangle
+ * @param   bottom      One past the last row of the rectangle
+ * @param   right       One past the last column of the rectangle
+ *
+ * @return              The sum of the pixels in rows [top, bottom) and columns [left, right)
+ */
+double calcBoxSum(const double* table, const int num_row, const int num_col, const int top, const int left, const int bottom, const int right)
+{
+    const size_t stride = (size_t)num_col + 1;
+
+    const int y0 = (top < 0) ? 0 : (top > num_row) ? num_row : top;
+    const int y1 = (bottom < 0) ? 0 : (bottom > num_row) ? num_row : bottom;
+    const int x0 = (left < 0) ? 0 : (left > num_col) ? num_col : left;
+    const int x1 = (right < 0) ? 0 : (right > num_col) ? num_col : right;
+
+    return table[y1 * stride + x1] - table[y0 * stride + x1] - table[y1 * stride + x0] + table[y0 * stride + x0];
+}
+
+/**
+ * Applies a (2 * radius + 1) x (2 * radius + 1) box blur with zero padding in constant time per pixel
+ *
+ * @param   plane       The plane to blur
+ * @param   output      Memory to place the result to, may be the same as the plane
+ * @param   num_row     Number of rows in the plane
+ * @param   num_col     Number of columns in the plane
+ * @param   radius      Number of pixels on each side of the center
+ * @param   table       Memory for the summed-area table (see calcIntegralFloats)
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void applyBoxBlurRef(float* plane, float* output, const int num_row, const int num_col, const int radius, double* table)
+{
+    const double scale = 1.0 / ((2.0 * radius + 1) * (2.0 * radius + 1));
+
+    buildIntegralImage(plane, table, num_row, num_col, 0);
+
+    // The table holds everything needed, so the output may overwrite the plane
+    for (int y = 0; y < num_row; y++)
+        for (int x = 0; x < num_col; x++)
+            output[(size_t)y * num_col + x] = (float)(calcBoxSum(table, num_row, num_col, y - radius, x - radius, y + radius + 1, x + radius + 1) * scale);
+
+    return;
+}
+
+/**
+ * Picks the box sizes whose stack best matches a Gaussian ("Fast Almost-Gaussian Filtering", Kovesi 2010):
+ * the lower odd width wl for the first boxes and wl + 2 for the rest, so the variances add up to sigma^2
+ *
+ * @param   sigma       Standard deviation of the Gaussian
+ * @param   radii       Memory to place the radius of each box to
+ *
+ * @return              The radius of the whole stack (sum of the box radii)
+ */
+int calcStackedBoxRadii(const float sigma, int radii[STACKED_BOXES])
+{
+    const double variance = (double)sigma * sigma;
+    const double n = STACKED_BOXES;
+
+    int lower = (int)floor(sqrt(12.0 * variance / n + 1.0));
+    lower = (lower % 2 == 0) ? lower - 1 : lower;
+    lower = (lower < 1) ? 1 : lower;
+
+    // Number of boxes that use the lower width
+    const int num_lower = (int)round((12.0 * variance - n * lower * lower - 4.0 * n * lower - 3.0 * n) / (-4.0 * lower - 4.0));
+
+    int total = 0;
+
+    for (int i = 0; i < STACKED_BOXES; i++)
+    {
+        radii[i] = ((i < num_lower) ? lower - 1 : lower + 1) / 2;
+        total += radii[i];
+    }
+
+    return total;
+}
+
+/**
+ * Approximates a Gaussian blur of every plane of a planar image with a stack of box blurs (see calcStackedBoxRadii).
+ * Each box costs the same whatever its size, so the blur does not get slower with sigma. The boxes run on a copy of
+ * the plane with a border of zeros as wide as the whole stack, so that only the input is zero padded like the direct
+ * convolution (padding between the boxes would darken the borders). Very small sigmas (below about 0.8) round to
+ * boxes of width one, which leave the image unchanged.
+ *
+ * @param   image           The planar image to be blurred, [R... G... B...]
+ * @param   output          Memory to place the planar result to, may be the same as the image
+ * @param   num_channels    Number of planes in the image
+ * @param	num_row		    Number of rows in the image
+ * @param	num_col		    Number of columns in the image
+ * @param   sigma           Standard deviation of the Gaussian
+ * @param   ws              Workspace for the bordered copy and its summed-area table, NULL to allocate them
+ *
+ * @return                  Utilizes existing memory for the result
+ */
+void applyStackedBoxBlurRef(float* image, float* output, const int num_channels, const int num_row, const int num_col, const float sigma, struct Workspace* ws)
+{
+    const size_t plane_size = (size_t)num_row * num_col;
+    int radii[STACKED_BOXES];
+
+    const int border = calcStackedBoxRadii(sigma, radii);
+    const int ext_row = num_row + 2 * border;
+    const int ext_col = num_col + 2 * border;
+
+    float* extended = takePlanes(ws, (size_t)ext_row * ext_col);
+    double* table = (double*)takePlanes(ws, calcIntegralFloats(ext_row, ext_col));
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        memset(extended, 0, sizeof(float) * ext_row * ext_col);
+
+        for (int y = 0; y < num_row; y++)
+            memcpy(&extended[(size_t)(y + border) * ext_col + border], &image[c * plane_size + (size_t)y * num_col], sizeof(float) * num_col);
+
+        // The boxes blur the copy in place, the border absorbs everything they spread outside the image
+        for (int i = 0; i < STACKED_BOXES; i++)
+            applyBoxBlurRef(extended, extended, ext_row, ext_col, radii[i], table);
+
+        for (int y = 0; y < num_row; y++)
+            memcpy(&output[c * plane_size + (size_t)y * num_col], &extended[(size_t)(y + border) * ext_col + border], sizeof(float) * num_col);
+    }
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)table);
+    releasePlanes(ws, extended);
+
+    return;
+}
+
+/**
+ * Calculates the mean and variance of the (2 * radius + 1) x (2 * radius + 1) window around every pixel in constant
+ * time per pixel. Windows at the border only cover the pixels inside the image.
+ *
+ * @param   plane       The plane to get the statistics of
+ * @param   mean        Memory to place the local means to
+ * @param   variance    Memory to place the local variances to
+ * @param   num_row     Number of rows in the plane
+ * @param   num_col     Number of columns in the plane
+ * @param   radius      Number of pixels on each side of the center
+ * @param   ws          Workspace for the two summed-area tables, NULL to allocate them
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void calcLocalStatsRef(float* plane, float* mean, float* variance, const int num_row, const int num_col, const int radius, struct Workspace* ws)
+{
+    double* sums = (double*)takePlanes(ws, calcIntegralFloats(num_row, num_col));
+    double* squares = (double*)takePlanes(ws, calcIntegralFloats(num_row, num_col));
+
+    buildIntegralImage(plane, sums, num_row, num_col, 0);
+    buildIntegralImage(plane, squares, num_row, num_col, 1);
+
+    for (int y = 0; y < num_row; y++)
+    {
+        const int top = (y - radius < 0) ? 0 : y - radius;
+        const int bottom = (y + radius + 1 > num_row) ? num_row : y + radius + 1;
+
+        for (int x = 0; x < num_col; x++)
+        {
+            const int left = (x - radius < 0) ? 0 : x - radius;
+            const int right = (x + radius + 1 > num_col) ? num_col : x + radius + 1;
+            const double count = (double)(bottom - top) * (right - left);
+
+            const double local_mean = calcBoxSum(sums, num_row, num_col, top, left, bottom, right) / count;
+            const double local_variance = calcBoxSum(squares, num_row, num_col, top, left, bottom, right) / count - local_mean * local_mean;
+
+            mean[(size_t)y * num_col + x] = (float)local_mean;
+            variance[(size_t)y * num_col + x] = (float)((local_variance > 0) ? local_variance : 0);
+        }
+    }
+
+    // Release in the reverse order they were taken
+    releasePlanes(ws, (float*)squares);
+    releasePlanes(ws, (float*)sums);
+
+    return;
+}
@@ -1,9 +1,152 @@
 #include "../Inc/imfusion.h"
+#include "../Inc/imnetpbm.h"
+#include "../Inc/imbatch.h"
+#include "../Inc/imstream.h"
+#include "../Inc/imstrip.h"
+#include "../Inc/imfixed.h"
 #include <stdio.h>
 
-int main()
+/**
+ * Batch usage: image_fusion --batch <directory | @file_list> <output directory> [--format txt|uwi|ppm|pgm] [--memory MB] [--workers N] [--text-u8]
+ */
+static int runBatchCommand(int argc, char* argv[])
 {
-	float* result = imageFusionSeqFull("03_bitmap.txt");
+	if (argc < 4)
+	{
+		printf("Usage: %s --batch <directory | @file_list> <output directory> [--format txt|uwi|ppm|pgm] [--memory MB] [--workers N] [--text-u8]\n", argv[0]);
+		return 1;
+	}
+
+	struct BatchOptions options = { argv[2], argv[3], NULL, TEXT_FLOAT6, (size_t)DEFAULT_MEMORY_BUDGET << 20, 0 };
+
+	for (int i = 4; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+			options.output_format = argv[++i];
+
+		else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+			options.memory_budget = (size_t)atol(argv[++i]) << 20;
+
+		else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+			options.num_workers = atoi(argv[++i]);
+
+		else if (strcmp(argv[i], "--text-u8") == 0)
+			options.text_format = TEXT_UINT8;
+
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	return (runBatch(&options) == 0) ? 0 : 1;
+}
+
+/**
+ * Streaming usage: image_fusion --stream <width> <height> [--frames N]
+ * Raw RGB24 frames are read from stdin and the enhanced frames are written to stdout
+ */
+static int runStreamCommand(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		printf("Usage: %s --stream <width> <height> [--frames N]\n", argv[0]);
+		return 1;
+	}
+
+	struct StreamOptions options = { atoi(argv[3]), atoi(argv[2]), 0 };
+
+	if (argc > 5 && strcmp(argv[4], "--frames") == 0)
+		options.max_frames = atol(argv[5]);
+
+	return (runStream(&options) == 0) ? 0 : 1;
+}
+
+/**
+ * Strip usage: image_fusion --strip <input image> <output image> [--memory MB]
+ * The image is processed in bands of rows so that memory use stays within the budget
+ */
+static int runStripCommand(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		printf("Usage: %s --strip <input image> <output image> [--memory MB]\n", argv[0]);
+		return 1;
+	}
+
+	size_t memory_budget = (size_t)DEFAULT_STRIP_BUDGET << 20;
+
+	if (argc > 5 && strcmp(argv[4], "--memory") == 0)
+		memory_budget = (size_t)atol(argv[5]) << 20;
+
+	// Writing the image to stdout moves the progress messages to stderr
+	if (strcmp(argv[3], NETPBM_STDIO) == 0)
+		getImageStdout();
+
+	return (enhanceImageStrips(argv[2], argv[3], memory_budget) == 0) ? 0 : 1;
+}
+
+/**
+ * Fixed point usage: image_fusion --fixed <input image> <output image> [--report]
+ * The report compares the result against the float pipeline
+ */
+static int runFixedCommand(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		printf("Usage: %s --fixed <input image> <output image> [--report]\n", argv[0]);
+		return 1;
+	}
+
+	const int report = (argc > 4 && strcmp(argv[4], "--report") == 0);
+
+	// Writing the image to stdout moves the progress messages to stderr
+	if (strcmp(argv[3], NETPBM_STDIO) == 0)
+		getImageStdout();
+
+	return (runFixed(argv[2], argv[3], report) == 0) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+		return runBatchCommand(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--stream") == 0)
+		return runStreamCommand(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--strip") == 0)
+		return runStripCommand(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--fixed") == 0)
+		return runFixedCommand(argc, argv);
+
+	// Usage: image_fusion --bench-conv
+	if (argc > 1 && strcmp(argv[1], "--bench-conv") == 0)
+		return (runConvBenchmark() == 0) ? 0 : 1;
+
+	// Usage: image_fusion --bench-blur
+	if (argc > 1 && strcmp(argv[1], "--bench-blur") == 0)
+		return (runBlurBenchmark() == 0) ? 0 : 1;
+
+	// Usage: image_fusion --bench-transfer
+	if (argc > 1 && strcmp(argv[1], "--bench-transfer") == 0)
+		return (runTransferBenchmark() == 0) ? 0 : 1;
+
+	// Usage: image_fusion --bench-math
+	if (argc > 1 && strcmp(argv[1], "--bench-math") == 0)
+		return (runMathBenchmark() == 0) ? 0 : 1;
+
+	// Usage: image_fusion [input image] [output image]
+	char* input = (argc > 1) ? argv[1] : "03_bitmap.txt";
+	char* output = (argc > 2) ? argv[2] : "underwater_bitmap";
+
+	// Writing the image to stdout moves the progress messages to stderr
+	if (strcmp(output, NETPBM_STDIO) == 0)
+		getImageStdout();
+
+	float* result = imageFusionSeqFull(input, output);
 	free(result);
 
 	return 0;
@@ -0,0 +1,116 @@
+#include "../Inc/parallel.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Limit set by setThreadLimit for the stages started from this thread, 0 for none
+static THREAD_LOCAL int thread_limit = 0;
+
+/**
+ * Returns the number of threads to use for parallel stages. This is the number of online cores, unless
+ * overridden by the UW_THREADS environment variable, and at most the limit of the calling thread (see setThreadLimit).
+ *
+ * @return      Number of threads between [1, MAX_THREADS]
+ */
+int getNumThreads(void)
+{
+    static int num_threads = 0;
+
+    if (num_threads > 0)
+        return (thread_limit > 0 && thread_limit < num_threads) ? thread_limit : num_threads;
+
+    const char* env = getenv("UW_THREADS");
+    int count = (env != NULL) ? atoi(env) : 0;
+
+    if (count <= 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        count = (int)info.dwNumberOfProcessors;
+#else
+        count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+
+    count = (count < 1) ? 1 : count;
+    count = (count > MAX_THREADS) ? MAX_THREADS : count;
+
+    num_threads = count;
+    return (thread_limit > 0 && thread_limit < num_threads) ? thread_limit : num_threads;
+}
+
+/**
+ * Caps the number of threads getNumThreads returns on the calling thread, so that a thread which is itself one of
+ * several workers (see batchWorker) does not start a full set of threads for every stage.
+ *
+ * @param   limit   Most threads per stage started from this thread, 0 to remove the cap
+ */
+void setThreadLimit(const int limit)
+{
+    thread_limit = (limit > 0) ? limit : 0;
+    return;
+}
+
+/**
+ * Runs a worker function once per argument on its own thread and waits for all of them to finish.
+ * The calling thread runs the first argument itself so a single thread never spawns anything.
+ *
+ * @param   worker          Function to run, it receives a pointer to its argument
+ * @param   args            Array of num_threads arguments, each arg_size bytes
+ * @param   arg_size        Size of a single argument in bytes
+ * @param   num_threads     Number of arguments / threads
+ *
+ * @return                  Returns 0 if successful, -1 if a thread could not be created (its work is then done on the calling thread)
+ */
+int runParallel(void* (*worker)(void*), void* args, const size_t arg_size, const int num_threads)
+{
+    pthread_t thread_id[MAX_THREADS];
+    int created[MAX_THREADS] = { 0 };
+    int status = 0;
+
+    char* arg_bytes = (char*)args;
+
+    for (int i = 1; i < num_threads && i < MAX_THREADS; i++)
+    {
+        if (pthread_create(&thread_id[i], NULL, worker, (void*)&arg_bytes[i * arg_size]) == 0)
+            created[i] = 1;
+
+        else
+        {
+            printf("Thread %d could not be created, running it sequentially.\n", i);
+            status = -1;
+        }
+    }
+
+    worker((void*)arg_bytes);
+
+    for (int i = 1; i < num_threads && i < MAX_THREADS; i++)
+    {
+        if (created[i])
+            pthread_join(thread_id[i], NULL);
+        else
+            worker((void*)&arg_bytes[i * arg_size]);
+    }
+
+    return status;
+}
+
+/**
+ * Returns a wall clock time stamp. Unlike clock(), this does not add up the time of every thread.
+ *
+ * @return      Time in seconds from an arbitrary starting point
+ */
+double getWallTime(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
@@ -0,0 +1,70 @@
+#include "../Inc/simd.h"
+
+/**
+ * Asks the CPU (and OS, for the wider registers) which instruction sets it supports
+ *
+ * @return      The widest level with a kernel
+ */
+enum SimdLevel detectSimdLevel(void)
+{
+#if SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD_AVX512;
+
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return SIMD_SSE2;
+#endif
+
+    return SIMD_SCALAR;
+}
+
+/**
+ * Returns the instruction set used by the dispatched kernels. It is detected on the first call, and can be lowered
+ * (but not raised past what the CPU supports) with the UW_SIMD environment variable: scalar, sse2, avx2 or avx512.
+ *
+ * @return      The level every dispatched kernel uses
+ */
+enum SimdLevel getSimdLevel(void)
+{
+    static int level = -1;
+
+    if (level >= 0)
+        return (enum SimdLevel)level;
+
+    enum SimdLevel detected = detectSimdLevel();
+    const char* requested = getenv("UW_SIMD");
+
+    if (requested != NULL)
+    {
+        for (int i = 0; i < NUM_SIMD_LEVELS; i++)
+        {
+            if (strcmp(requested, getSimdName((enum SimdLevel)i)) == 0)
+            {
+                if (i > (int)detected)
+                    printf("UW_SIMD=%s is not supported by this CPU, using %s.\n", requested, getSimdName(detected));
+
+                else
+                    detected = (enum SimdLevel)i;
+            }
+        }
+    }
+
+    level = detected;
+
+    return detected;
+}
+
+/**
+ * Returns the name of an instruction set level, as accepted by UW_SIMD
+ */
+const char* getSimdName(const enum SimdLevel level)
+{
+    static const char* names[NUM_SIMD_LEVELS] = { "scalar", "sse2", "avx2", "avx512" };
+
+    return (level >= 0 && level < NUM_SIMD_LEVELS) ? names[level] : "unknown";
+}
@@ -0,0 +1,533 @@
+#include "../Inc/simdmath.h"
+#include "../Inc/parallel.h"
+
+#include <math.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+
+// Contraction into FMAs would round differently from the scalar versions
+#define MATH_KERNEL_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+
+// Coefficients of 2^f = sum (f ln2)^k / k! for f in [-0.5, 0.5], the first term left out is below 4e-9
+#define EXP2_C1 0.693147182f
+#define EXP2_C2 0.240226507f
+#define EXP2_C3 0.0555041087f
+#define EXP2_C4 0.00961812911f
+#define EXP2_C5 0.00133335581f
+#define EXP2_C6 0.000154035304f
+#define EXP2_C7 1.52527339e-05f
+
+// log2(m) = 2 / ln2 * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172 for m in [sqrt(1/2), sqrt(2)), so the series
+// t + t^3 / 3 + ... + t^9 / 9 is accurate to 1e-9
+#define LOG2_C1 2.88539004f
+#define LOG2_C3 0.961796701f
+#define LOG2_C5 0.577078044f
+#define LOG2_C7 0.412198603f
+#define LOG2_C9 0.320598930f
+#define SQRT_HALF_BITS 0x3f3504f3u
+
+// First guess of the cube root from the bits of the input, 3 Newton steps take it from 4% to float precision
+#define CBRT_MAGIC 0x2a5137a0
+
+static inline uint32_t floatBits(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits;
+}
+
+static inline float bitsFloat(const uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+/**
+ * Approximates the cube root of a float (see simdmath.h for the error)
+ *
+ * @param   x       Input, zero, infinities and NaNs are returned as is
+ *
+ * @return          x^(1/3)
+ */
+float fastCbrt(const float x)
+{
+    const float a = fabsf(x);
+
+    if (a == 0 || a == INFINITY || a != a)
+        return x;
+
+    // Dividing the bits by three roughly divides the exponent by three
+    float y = bitsFloat((uint32_t)(int32_t)((float)(int32_t)floatBits(a) * (1.0f / 3.0f)) + CBRT_MAGIC);
+
+    for (int i = 0; i < 3; i++)
+        y = (y + y + a / (y * y)) * (1.0f / 3.0f);
+
+    return (x < 0) ? -y : y;
+}
+
+/**
+ * Approximates the base 2 logarithm of a positive normal float (see simdmath.h for the error)
+ *
+ * @param   x       Input, must be positive
+ *
+ * @return          log2(x)
+ */
+float fastLog2(const float x)
+{
+    const uint32_t bits = floatBits(x);
+
+    // Split into 2^exponent * m with m in [sqrt(1/2), sqrt(2))
+    const uint32_t shifted = bits - SQRT_HALF_BITS;
+    const int exponent = (int32_t)shifted >> 23;
+    const float m = bitsFloat((shifted & 0x7fffff) + SQRT_HALF_BITS);
+
+    const float t = (m - 1.0f) / (m + 1.0f);
+    const float t2 = t * t;
+
+    const float series = LOG2_C1 + t2 * (LOG2_C3 + t2 * (LOG2_C5 + t2 * (LOG2_C7 + t2 * LOG2_C9)));
+
+    return (float)exponent + t * series;
+}
+
+/**
+ * Approximates 2^y (see simdmath.h for the error)
+ *
+ * @param   y       Exponent, values below -126 give 0 and values from 128 up give infinity
+ *
+ * @return          2^y
+ */
+float fastExp2(const float y)
+{
+    const float clamped = (y < -126.0f) ? -126.0f : (y > 128.0f) ? 128.0f : y;
+    const float n = rintf(clamped);
+    const float f = clamped - n;
+
+    const float poly = 1.0f + f * (EXP2_C1 + f * (EXP2_C2 + f * (EXP2_C3 + f * (EXP2_C4 + f * (EXP2_C5 + f * (EXP2_C6 + f * EXP2_C7))))));
+
+    // Scale by 2^n in two halves so that neither one overflows for n = 128 (which rounds to infinity only when f >= 0)
+    const int32_t first = (int32_t)n / 2;
+    const float scale_first = bitsFloat((uint32_t)(first + 127) << 23);
+    const float scale_second = bitsFloat((uint32_t)((int32_t)n - first + 127) << 23);
+
+    if (y < -126.0f)
+        return 0;
+
+    return poly * scale_first * scale_second;
+}
+
+/**
+ * Approximates x^y as 2^(y log2(x)) (see simdmath.h for the error)
+ *
+ * @param   x       Base, zero gives zero and negative values NaN
+ * @param   y       Exponent
+ *
+ * @return          x^y
+ */
+float fastPow(const float x, const float y)
+{
+    if (x <= 0)
+        return (x == 0) ? 0 : NAN;
+
+    return fastExp2(y * fastLog2(x));
+}
+
+/**
+ * Approximates 1 / sqrt(x) with the bit trick of Q_rsqrt and three Newton steps (see simdmath.h for the error)
+ *
+ * @param   x       Input, must be positive
+ *
+ * @return          1 / sqrt(x)
+ */
+float fastRsqrt(const float x)
+{
+    const float half_x = x * 0.5f;
+    float y = bitsFloat(0x5f3759df - (floatBits(x) >> 1));
+
+    for (int i = 0; i < 3; i++)
+        y = y * (1.5f - half_x * y * y);
+
+    return y;
+}
+
+#if SIMD_X86
+/**
+ * 8 cube roots at a time with AVX2, the same steps as fastCbrt
+ */
+MATH_KERNEL_TARGET("avx2")
+static inline __m256 cbrtAVX2(const __m256 x)
+{
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 third = _mm256_set1_ps(1.0f / 3.0f);
+    const __m256 a = _mm256_andnot_ps(sign_mask, x);
+
+    __m256 y = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(a)), third);
+    y = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_cvttps_epi32(y), _mm256_set1_epi32(CBRT_MAGIC)));
+
+    for (int i = 0; i < 3; i++)
+        y = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(y, y), _mm256_div_ps(a, _mm256_mul_ps(y, y))), third);
+
+    // Zero, infinity and NaN pass through, everything else gets the sign back
+    const __m256 special = _mm256_or_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_EQ_OQ),
+        _mm256_cmp_ps(a, _mm256_set1_ps(INFINITY), _CMP_NLT_UQ));
+
+    return _mm256_blendv_ps(_mm256_or_ps(y, _mm256_and_ps(x, sign_mask)), x, special);
+}
+
+/**
+ * 8 base 2 logarithms at a time with AVX2, the same steps as fastLog2
+ */
+MATH_KERNEL_TARGET("avx2")
+static inline __m256 log2AVX2(const __m256 x)
+{
+    const __m256i sqrt_half = _mm256_set1_epi32((int)SQRT_HALF_BITS);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    const __m256i shifted = _mm256_sub_epi32(_mm256_castps_si256(x), sqrt_half);
+    const __m256 exponent = _mm256_cvtepi32_ps(_mm256_srai_epi32(shifted, 23));
+    const __m256 m = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_and_si256(shifted, _mm256_set1_epi32(0x7fffff)), sqrt_half));
+
+    const __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    const __m256 t2 = _mm256_mul_ps(t, t);
+
+    __m256 series = _mm256_set1_ps(LOG2_C9);
+    series = _mm256_add_ps(_mm256_set1_ps(LOG2_C7), _mm256_mul_ps(t2, series));
+    series = _mm256_add_ps(_mm256_set1_ps(LOG2_C5), _mm256_mul_ps(t2, series));
+    series = _mm256_add_ps(_mm256_set1_ps(LOG2_C3), _mm256_mul_ps(t2, series));
+    series = _mm256_add_ps(_mm256_set1_ps(LOG2_C1), _mm256_mul_ps(t2, series));
+
+    return _mm256_add_ps(exponent, _mm256_mul_ps(t, series));
+}
+
+/**
+ * 8 powers of two at a time with AVX2, the same steps as fastExp2
+ */
+MATH_KERNEL_TARGET("avx2")
+static inline __m256 exp2AVX2(const __m256 y)
+{
+    const __m256 low = _mm256_set1_ps(-126.0f);
+    const __m256 high = _mm256_set1_ps(128.0f);
+
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(y, low), high);
+    const __m256 n = _mm256_round_ps(clamped, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m256 f = _mm256_sub_ps(clamped, n);
+
+    __m256 poly = _mm256_set1_ps(EXP2_C7);
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C6), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C5), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C4), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C3), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C2), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(EXP2_C1), _mm256_mul_ps(f, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(f, poly));
+
+    // n / 2 rounded towards zero, like the scalar division
+    const __m256i whole = _mm256_cvttps_epi32(n);
+    const __m256i first = _mm256_srai_epi32(_mm256_add_epi32(whole, _mm256_srli_epi32(whole, 31)), 1);
+    const __m256i bias = _mm256_set1_epi32(127);
+
+    const __m256 scale_first = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(first, bias), 23));
+    const __m256 scale_second = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(whole, first), bias), 23));
+    const __m256 result = _mm256_mul_ps(_mm256_mul_ps(poly, scale_first), scale_second);
+
+    return _mm256_blendv_ps(result, _mm256_setzero_ps(), _mm256_cmp_ps(y, low, _CMP_LT_OQ));
+}
+
+MATH_KERNEL_TARGET("avx2")
+static void cbrtArrayAVX2(const float* input, float* output, const int num_values)
+{
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+        _mm256_storeu_ps(&output[i], cbrtAVX2(_mm256_loadu_ps(&input[i])));
+
+    for (; i < num_values; i++)
+        output[i] = fastCbrt(input[i]);
+
+    return;
+}
+
+MATH_KERNEL_TARGET("avx2")
+static void powArrayAVX2(const float* input, float* output, const int num_values, const float exponent)
+{
+    const __m256 y = _mm256_set1_ps(exponent);
+    const __m256 zero = _mm256_setzero_ps();
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(&input[i]);
+        __m256 result = exp2AVX2(_mm256_mul_ps(y, log2AVX2(x)));
+
+        // Zero gives zero, negatives NaN (like fastPow)
+        result = _mm256_blendv_ps(result, _mm256_set1_ps(NAN), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+        _mm256_storeu_ps(&output[i], _mm256_blendv_ps(result, zero, _mm256_cmp_ps(x, zero, _CMP_EQ_OQ)));
+    }
+
+    for (; i < num_values; i++)
+        output[i] = fastPow(input[i], exponent);
+
+    return;
+}
+
+MATH_KERNEL_TARGET("avx2")
+static void rsqrtArrayAVX2(const float* input, float* output, const int num_values)
+{
+    const __m256i magic = _mm256_set1_epi32(0x5f3759df);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three_halfs = _mm256_set1_ps(1.5f);
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(&input[i]);
+        const __m256 half_x = _mm256_mul_ps(x, half);
+        __m256 y = _mm256_castsi256_ps(_mm256_sub_epi32(magic, _mm256_srli_epi32(_mm256_castps_si256(x), 1)));
+
+        for (int j = 0; j < 3; j++)
+            y = _mm256_mul_ps(y, _mm256_sub_ps(three_halfs, _mm256_mul_ps(_mm256_mul_ps(half_x, y), y)));
+
+        _mm256_storeu_ps(&output[i], y);
+    }
+
+    for (; i < num_values; i++)
+        output[i] = fastRsqrt(input[i]);
+
+    return;
+}
+
+MATH_KERNEL_TARGET("avx2")
+static void sqrtArrayAVX2(const float* input, float* output, const int num_values, const double scale)
+{
+    int i = 0;
+
+    if (scale == 1.0)
+    {
+        for (; i + 8 <= num_values; i += 8)
+            _mm256_storeu_ps(&output[i], _mm256_sqrt_ps(_mm256_loadu_ps(&input[i])));
+    }
+
+    else
+    {
+        const __m256d factor = _mm256_set1_pd(scale);
+
+        for (; i + 4 <= num_values; i += 4)
+        {
+            const __m256d value = _mm256_mul_pd(factor, _mm256_cvtps_pd(_mm_loadu_ps(&input[i])));
+            _mm_storeu_ps(&output[i], _mm256_cvtpd_ps(_mm256_sqrt_pd(value)));
+        }
+    }
+
+    for (; i < num_values; i++)
+        output[i] = (scale == 1.0) ? sqrtf(input[i]) : (float)sqrt(scale * input[i]);
+
+    return;
+}
+#endif
+
+/**
+ * Cube root of every value (see fastCbrt), with AVX2 when the CPU has it
+ *
+ * @param   input       Input values
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of values
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void cbrtArray(const float* input, float* output, const int num_values)
+{
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        cbrtArrayAVX2(input, output, num_values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = fastCbrt(input[i]);
+
+    return;
+}
+
+/**
+ * Raises every value to the same power (see fastPow), with AVX2 when the CPU has it
+ *
+ * @param   input       Input values
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of values
+ * @param   exponent    Power to raise the values to
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void powArray(const float* input, float* output, const int num_values, const float exponent)
+{
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        powArrayAVX2(input, output, num_values, exponent);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = fastPow(input[i], exponent);
+
+    return;
+}
+
+/**
+ * Reciprocal square root of every value (see fastRsqrt), with AVX2 when the CPU has it
+ *
+ * @param   input       Input values
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of values
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void rsqrtArray(const float* input, float* output, const int num_values)
+{
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        rsqrtArrayAVX2(input, output, num_values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = fastRsqrt(input[i]);
+
+    return;
+}
+
+/**
+ * Square root of every value times a scale, (float)sqrt(scale * x) with the product in double precision like the
+ * scalar weight code. A scale of 1 takes the square root in single precision, which rounds to the same float.
+ *
+ * @param   input       Input values
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of values
+ * @param   scale       Factor applied before the square root
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void sqrtArray(const float* input, float* output, const int num_values, const double scale)
+{
+#if SIMD_X86
+    if (getSimdLevel() >= SIMD_AVX2)
+    {
+        sqrtArrayAVX2(input, output, num_values, scale);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = (scale == 1.0) ? sqrtf(input[i]) : (float)sqrt(scale * input[i]);
+
+    return;
+}
+
+/**
+ * Distance in ULP between an approximation and the correctly rounded result, both finite and of the same sign
+ */
+static double calcUlpError(const float value, const double exact)
+{
+    const float rounded = (float)exact;
+    const int32_t a = (int32_t)floatBits(value);
+    const int32_t b = (int32_t)floatBits(rounded);
+
+    return fabs((double)a - (double)b);
+}
+
+/**
+ * Times every function against glibc on 4M values and reports the largest error in ULP
+ *
+ * @return      Returns 0 if successful, -1 if memory ran out
+ */
+int runMathBenchmark(void)
+{
+    const int num_values = 1 << 22;
+    const char* names[] = { "cbrt", "pow 1.2", "pow 0.7", "rsqrt", "sqrt" };
+    const int num_functions = sizeof(names) / sizeof(names[0]);
+
+    float* input = malloc(sizeof(float) * num_values);
+    float* exact = malloc(sizeof(float) * num_values);
+    float* output = malloc(sizeof(float) * num_values);
+
+    if (input == NULL || exact == NULL || output == NULL)
+    {
+        printf("Not enough memory to benchmark the math functions.\n");
+        free(input);
+        free(exact);
+        free(output);
+        return -1;
+    }
+
+    // Pixel values in (0, 1], spread over the exponents so dark pixels count as much as bright ones
+    srand(1);
+    for (int i = 0; i < num_values; i++)
+        input[i] = exp2f(-20.0f * (rand() / (float)RAND_MAX));
+
+    printf("%d values in [2^-20, 1], %s\n", num_values, getSimdName(getSimdLevel()));
+    printf("%-8s %10s %10s %8s %10s\n", "function", "glibc ms", "simd ms", "speedup", "max ulp");
+
+    for (int f = 0; f < num_functions; f++)
+    {
+        const float exponent = (f == 1) ? 1.2f : 0.7f;
+
+        double start = getWallTime();
+        for (int i = 0; i < num_values; i++)
+        {
+            if (f == 0)
+                exact[i] = cbrtf(input[i]);
+
+            else if (f == 1 || f == 2)
+                exact[i] = powf(input[i], exponent);
+
+            else if (f == 3)
+                exact[i] = 1.0f / sqrtf(input[i]);
+
+            else
+                exact[i] = sqrtf(input[i]);
+        }
+        const double glibc_time = getWallTime() - start;
+
+        start = getWallTime();
+        if (f == 0)
+            cbrtArray(input, output, num_values);
+
+        else if (f == 1 || f == 2)
+            powArray(input, output, num_values, exponent);
+
+        else if (f == 3)
+            rsqrtArray(input, output, num_values);
+
+        else
+            sqrtArray(input, output, num_values, 1.0);
+        const double simd_time = getWallTime() - start;
+
+        // Errors against double precision libm rounded once
+        double max_ulp = 0;
+        for (int i = 0; i < num_values; i++)
+        {
+            const double x = input[i];
+            const double reference = (f == 0) ? cbrt(x) : (f <= 2) ? pow(x, exponent) : (f == 3) ? 1.0 / sqrt(x) : sqrt(x);
+            const double ulp = calcUlpError(output[i], reference);
+
+            max_ulp = (ulp > max_ulp) ? ulp : max_ulp;
+        }
+
+        printf("%-8s %10.2f %10.2f %8.2f %10.0f\n", names[f], glibc_time * 1e3, simd_time * 1e3, glibc_time / simd_time, max_ulp);
+    }
+
+    free(input);
+    free(exact);
+    free(output);
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+#include "../Inc/transfer.h"
+#include "../Inc/whitebalance.h"
+
+#include <math.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+
+// The vector kernel must round the same as the scalar lookup, so multiply adds are not contracted into FMAs
+#define TRANSFER_KERNEL_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+
+// Bits of the float 2^TRANSFER_MIN_EXPONENT, and the width of the table in the same units
+#define TRANSFER_BASE_BITS ((uint32_t)(127 + TRANSFER_MIN_EXPONENT) << 23)
+#define TRANSFER_SPAN_BITS ((uint32_t)(TRANSFER_MAX_EXPONENT - TRANSFER_MIN_EXPONENT) << 23)
+#define TRANSFER_FRACTION_BITS (23 - TRANSFER_MANTISSA_BITS)
+
+static struct TransferTable* transfer_cache[TRANSFER_CACHE_SIZE];
+static int transfer_cached = 0;
+static pthread_mutex_t transfer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Evaluates a transfer function with libm, exactly like the per sample code it replaces
+ *
+ * @param   function    Which transfer function
+ * @param   parameter   Exponent of TRANSFER_POWER, ignored by the others
+ * @param   value       Input sample
+ *
+ * @return              The transfer function of the sample
+ */
+float calcTransferExact(const enum TransferFunction function, const float parameter, const float value)
+{
+    if (function == TRANSFER_POWER)
+        return (float)pow(value, parameter);
+
+    else if (function == TRANSFER_SRGB_LINEAR)
+        return linearizerHelper(value);
+
+    else
+        return labFunction(value, 1.0f);
+}
+
+/**
+ * Returns the name of a transfer function for the benchmark
+ */
+const char* getTransferName(const enum TransferFunction function)
+{
+    if (function == TRANSFER_POWER)
+        return "power";
+
+    else if (function == TRANSFER_SRGB_LINEAR)
+        return "srgb";
+
+    else
+        return "lab";
+}
+
+/**
+ * Returns the input of entry "index" of a table, the first value of its segment
+ */
+static float getTransferInput(const int index)
+{
+    const uint32_t bits = TRANSFER_BASE_BITS + ((uint32_t)index << TRANSFER_FRACTION_BITS);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+/**
+ * Fills in the entries of a table and measures the error of the interpolation between them
+ */
+static void buildTransferTable(struct TransferTable* table, const enum TransferFunction function, const float parameter)
+{
+    // Points checked inside every segment, the error of a linear interpolation peaks in between the entries
+    const int num_checks = 8;
+
+    table->function = function;
+    table->parameter = parameter;
+    table->max_error = 0;
+    table->max_relative = 0;
+
+    for (int i = 0; i < TRANSFER_ENTRIES; i++)
+        table->values[i] = calcTransferExact(function, parameter, getTransferInput(i));
+
+    for (int i = 0; i < TRANSFER_ENTRIES - 1; i++)
+    {
+        const float low = getTransferInput(i);
+        const float high = getTransferInput(i + 1);
+
+        for (int j = 1; j < num_checks; j++)
+        {
+            const float value = low + (high - low) * j / num_checks;
+            const float exact = calcTransferExact(function, parameter, value);
+            const float error = fabsf(lookupTransfer(table, value) - exact);
+
+            table->max_error = (error > table->max_error) ? error : table->max_error;
+
+            if (exact != 0 && error / fabsf(exact) > table->max_relative)
+                table->max_relative = error / fabsf(exact);
+        }
+    }
+
+    return;
+}
+
+/**
+ * Returns the table of a transfer function, building it on first use. Tables are shared between threads and kept for
+ * the life of the process.
+ *
+ * @param   function    Which transfer function
+ * @param   parameter   Exponent of TRANSFER_POWER, ignored by the others
+ *
+ * @return              The table, NULL if TRANSFER_CACHE_SIZE tables exist already or memory ran out (use calcTransferExact)
+ */
+const struct TransferTable* getTransferTable(const enum TransferFunction function, const float parameter)
+{
+    const float key = (function == TRANSFER_POWER) ? parameter : 0;
+    struct TransferTable* table = NULL;
+
+    pthread_mutex_lock(&transfer_lock);
+
+    for (int i = 0; i < transfer_cached && table == NULL; i++)
+    {
+        if (transfer_cache[i]->function == function && transfer_cache[i]->parameter == key)
+            table = transfer_cache[i];
+    }
+
+    if (table == NULL && transfer_cached < TRANSFER_CACHE_SIZE)
+    {
+        table = malloc(sizeof(struct TransferTable));
+
+        if (table != NULL)
+        {
+            buildTransferTable(table, function, key);
+            transfer_cache[transfer_cached++] = table;
+        }
+    }
+
+    else if (table == NULL)
+        printf("Too many transfer tables, %s %.3f is computed exactly.\n", getTransferName(function), key);
+
+    pthread_mutex_unlock(&transfer_lock);
+
+    return table;
+}
+
+/**
+ * Looks up a single sample in a table, interpolating between the two nearest entries
+ *
+ * @param   table       Table from getTransferTable
+ * @param   value       Input sample
+ *
+ * @return              The transfer function of the sample, computed exactly outside the range of the table
+ */
+float lookupTransfer(const struct TransferTable* table, const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // Anything below the table (including zero and negatives, which wrap around) or above it is computed exactly
+    const uint32_t offset = bits - TRANSFER_BASE_BITS;
+
+    if (offset >= TRANSFER_SPAN_BITS)
+        return calcTransferExact(table->function, table->parameter, value);
+
+    const uint32_t index = offset >> TRANSFER_FRACTION_BITS;
+    const float fraction = (float)(offset & ((1u << TRANSFER_FRACTION_BITS) - 1)) * (1.0f / (1u << TRANSFER_FRACTION_BITS));
+
+    const float low = table->values[index];
+    const float high = table->values[index + 1];
+
+    return low + fraction * (high - low);
+}
+
+#if SIMD_X86
+/**
+ * Looks up 8 samples at a time with AVX2 gathers, groups with a sample outside the table go through lookupTransfer
+ */
+TRANSFER_KERNEL_TARGET("avx2")
+static void applyTransferAVX2(const struct TransferTable* table, const float* input, float* output, const int num_values)
+{
+    const __m256i base = _mm256_set1_epi32((int)TRANSFER_BASE_BITS);
+    const __m256i span = _mm256_set1_epi32((int)TRANSFER_SPAN_BITS);
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i fraction_mask = _mm256_set1_epi32((1 << TRANSFER_FRACTION_BITS) - 1);
+    const __m256 fraction_scale = _mm256_set1_ps(1.0f / (1 << TRANSFER_FRACTION_BITS));
+
+    int i = 0;
+
+    for (; i + 8 <= num_values; i += 8)
+    {
+        const __m256 value = _mm256_loadu_ps(&input[i]);
+        const __m256i offset = _mm256_sub_epi32(_mm256_castps_si256(value), base);
+
+        // Both comparisons are signed, the span is far below 2^31 so negative inputs wrap outside of it
+        const __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(offset, minus_one), _mm256_cmpgt_epi32(span, offset));
+
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(inside)) != 0xff)
+        {
+            for (int j = i; j < i + 8; j++)
+                output[j] = lookupTransfer(table, input[j]);
+
+            continue;
+        }
+
+        const __m256i index = _mm256_srli_epi32(offset, TRANSFER_FRACTION_BITS);
+        const __m256 fraction = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(offset, fraction_mask)), fraction_scale);
+
+        const __m256 low = _mm256_i32gather_ps(table->values, index, 4);
+        const __m256 high = _mm256_i32gather_ps(&table->values[1], index, 4);
+
+        _mm256_storeu_ps(&output[i], _mm256_add_ps(low, _mm256_mul_ps(fraction, _mm256_sub_ps(high, low))));
+    }
+
+    for (; i < num_values; i++)
+        output[i] = lookupTransfer(table, input[i]);
+
+    return;
+}
+#endif
+
+/**
+ * Applies a table to an array of samples, with AVX2 gathers when the level allows it. Both give the same result.
+ *
+ * @param   table       Table from getTransferTable
+ * @param   input       Input samples
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of samples
+ * @param   level       Instruction set to use, it must be supported by the CPU
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void applyTransferTable(const struct TransferTable* table, const float* input, float* output, const int num_values, const enum SimdLevel level)
+{
+#if SIMD_X86
+    if (level >= SIMD_AVX2)
+    {
+        applyTransferAVX2(table, input, output, num_values);
+        return;
+    }
+#else
+    (void)level;
+#endif
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = lookupTransfer(table, input[i]);
+
+    return;
+}
+
+/**
+ * Applies a transfer function to an array of samples through its table (see getTransferTable)
+ *
+ * @param   function    Which transfer function
+ * @param   parameter   Exponent of TRANSFER_POWER, ignored by the others
+ * @param   input       Input samples
+ * @param   output      Memory to place the result to, may be the same as the input
+ * @param   num_values  Number of samples
+ *
+ * @return              Utilizes existing memory for the result
+ */
+void applyTransfer(const enum TransferFunction function, const float parameter, const float* input, float* output, const int num_values)
+{
+    const struct TransferTable* table = getTransferTable(function, parameter);
+
+    if (table != NULL)
+    {
+        applyTransferTable(table, input, output, num_values, getSimdLevel());
+        return;
+    }
+
+    for (int i = 0; i < num_values; i++)
+        output[i] = calcTransferExact(function, parameter, input[i]);
+
+    return;
+}
+
+/**
+ * Times every transfer function of the pipeline on the samples of a 1920 x 1080 RGB frame, with libm, the scalar table
+ * and the SIMD table, and prints the largest error of each table against libm.
+ *
+ * @return      Returns 0 if successful, -1 if memory ran out
+ */
+int runTransferBenchmark(void)
+{
+    const int num_values = 1920 * 1080 * 3;
+    const enum TransferFunction functions[] = { TRANSFER_SRGB_LINEAR, TRANSFER_POWER, TRANSFER_POWER, TRANSFER_LAB };
+    const float parameters[] = { 0, 1.2f, 0.7f, 0 };
+    const int num_functions = sizeof(functions) / sizeof(functions[0]);
+    const enum SimdLevel level = getSimdLevel();
+
+    float* input = malloc(sizeof(float) * num_values);
+    float* exact = malloc(sizeof(float) * num_values);
+    float* output = malloc(sizeof(float) * num_values);
+
+    if (input == NULL || exact == NULL || output == NULL)
+    {
+        printf("Not enough memory to benchmark the transfer tables.\n");
+        free(input);
+        free(exact);
+        free(output);
+        return -1;
+    }
+
+    srand(1);
+    for (int i = 0; i < num_values; i++)
+        input[i] = rand() / (float)RAND_MAX;
+
+    printf("1920x1080 RGB frame, %d entries per table, %s\n", TRANSFER_ENTRIES, getSimdName(level));
+    printf("%-6s %6s %10s %10s %8s %10s %8s %12s %12s\n", "table", "param", "libm ms", "scalar ms", "speedup", "simd ms", "speedup",
+        "max error", "max relative");
+
+    for (int f = 0; f < num_functions; f++)
+    {
+        const struct TransferTable* table = getTransferTable(functions[f], parameters[f]);
+
+        if (table == NULL)
+            continue;
+
+        double start = getWallTime();
+        for (int i = 0; i < num_values; i++)
+            exact[i] = calcTransferExact(functions[f], parameters[f], input[i]);
+        const double exact_time = getWallTime() - start;
+
+        start = getWallTime();
+        applyTransferTable(table, input, output, num_values, SIMD_SCALAR);
+        const double scalar_time = getWallTime() - start;
+
+        start = getWallTime();
+        applyTransferTable(table, input, output, num_values, level);
+        const double simd_time = getWallTime() - start;
+
+        printf("%-6s %6.2f %10.2f %10.2f %8.2f %10.2f %8.2f %12.3e %12.3e\n", getTransferName(functions[f]), parameters[f], exact_time * 1e3,
+            scalar_time * 1e3, exact_time / scalar_time, simd_time * 1e3, exact_time / simd_time, table->max_error, table->max_relative);
+    }
+
+    free(input);
+    free(exact);
+    free(output);
+
+    return 0;
+}
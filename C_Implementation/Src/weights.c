@@ -11,39 +11,123 @@
  * @return				Allocates new memory for the combined weight map.
  */
 float* getWeights(float* image, const int num_row, const int num_col, const int lum_option)
+{
+	float* total_weight = malloc(sizeof(float) * num_row * num_col);
+	getWeightsRef(image, total_weight, num_row, num_col, lum_option, NULL);
+
+	return total_weight;
+}
+
+/**
+ * Computes, normalizes and combines the Laplacian, Saliency, and Saturation Weights by reference.
+ * 
+ * @param   input       The input image flattened out to 1D in column-row order. ie: left to right, top to bottom. Image is normalized between [0,1]
+ * @param	total_weight	Memory to place the combined weight map to
+ * @param	num_row		Number of rows in the image
+ * @param	num_col		Number of columns in the image
+ * @param	lum_option	Determines which method used to calculate luminance. 0: Standard, 1: Percieved option, 2: Percieved option exact
+ * @param	ws			Workspace for temporaries, NULL to allocate them
+ * 
+ * @return				Utilizes existing memory for the result
+ */
+void getWeightsRef(float* image, float* total_weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws)
 {
 	const int num_pixels = num_row * num_col;
 
-	float* lum = calcLuminance(image, num_pixels, lum_option);
+	float* lum = takePlanes(ws, num_pixels);
+	float* weight = takePlanes(ws, num_pixels);
 
-	// Obtain laplacian weight
-	float* w_lap = calcLaplacianWeight(lum, num_row, num_col);
-	normalizeWeight(w_lap, num_pixels);
+	calcLuminanceRef(image, lum, num_pixels, lum_option);
 
-	// Obtain the saturation weight
-	float* w_sat = calcSaturationWeight(image, lum, num_pixels);
-	normalizeWeight(w_sat, num_pixels);
+	// Obtain laplacian weight, it starts off the total and is normalized when the saliency weight is added
+	const float max_laplacian = calcLaplacianWeightRef(lum, total_weight, num_row, num_col, ws);
 
-	// We no longer need the luminance matrix
-	free(lum);
+	// Obtain the saliency weight and aggregate it, normalizing both weights on the way
+	calcSaliencyWeightRef(image, weight, num_row, num_col, ws);
+	const float max_saliency = calcMaxWeight(weight, num_pixels);
+
+	for (int i = 0; i < num_pixels; i++)
+		total_weight[i] = total_weight[i] / max_laplacian + weight[i] / max_saliency;
 
-	// Obtain the saliency weight
-	float* w_sal = calcSaliencyWeight(image, num_row, num_col);
-	normalizeWeight(w_sal, num_pixels);
+	// Obtain the saturation weight and aggregate it
+	calcSaturationWeightRef(image, lum, weight, num_pixels);
+	const float max_saturation = calcMaxWeight(weight, num_pixels);
 
-	// Aggregate the weights
-	float* total_weight = malloc(sizeof(float) * num_pixels);
 	for (int i = 0; i < num_pixels; i++)
-		total_weight[i] = w_lap[i] + w_sal[i] + w_sat[i];
-	
-	// Free more memory
-	free(w_lap);
-	free(w_sat);
-	free(w_sal);
+		total_weight[i] += weight[i] / max_saturation;
+
+	// Release in the reverse order they were taken
+	releasePlanes(ws, weight);
+	releasePlanes(ws, lum);
+
+	return;
+}
+
+/**
+ * Computes the combined weight like getWeights, but stores it as half floats (see half.h) and allocates memory for it.
+ * 
+ * @param   input       The input image flattened out to 1D in column-row order. ie: left to right, top to bottom. Image is normalized between [0,1]
+ * @param	num_row		Number of rows in the image
+ * @param	num_col		Number of columns in the image
+ * @param	lum_option	Determines which method used to calculate luminance. 0: Standard, 1: Percieved option, 2: Percieved option exact
+ * 
+ * @return				Allocates new memory for the combined half weight map.
+ */
+half* getWeightsHalf(float* image, const int num_row, const int num_col, const int lum_option)
+{
+	half* total_weight = malloc(sizeof(half) * num_row * num_col);
+	getWeightsHalfRef(image, total_weight, num_row, num_col, lum_option, NULL);
 
 	return total_weight;
 }
 
+/**
+ * Computes, normalizes and combines the Laplacian, Saliency, and Saturation Weights by reference into half floats.
+ * Each weight is still computed and normalized in float, only the running total is stored as halves.
+ * 
+ * @param   input       The input image flattened out to 1D in column-row order. ie: left to right, top to bottom. Image is normalized between [0,1]
+ * @param	total_weight	Memory to place the combined half weight map to
+ * @param	num_row		Number of rows in the image
+ * @param	num_col		Number of columns in the image
+ * @param	lum_option	Determines which method used to calculate luminance. 0: Standard, 1: Percieved option, 2: Percieved option exact
+ * @param	ws			Workspace for temporaries, NULL to allocate them
+ * 
+ * @return				Utilizes existing memory for the result
+ */
+void getWeightsHalfRef(float* image, half* total_weight, const int num_row, const int num_col, const int lum_option, struct Workspace* ws)
+{
+	const int num_pixels = num_row * num_col;
+
+	float* lum = takePlanes(ws, num_pixels);
+	float* weight = takePlanes(ws, num_pixels);
+
+	calcLuminanceRef(image, lum, num_pixels, lum_option);
+
+	// Obtain laplacian weight, it starts off the total
+	const float max_laplacian = calcLaplacianWeightRef(lum, weight, num_row, num_col, ws);
+
+	for (int i = 0; i < num_pixels; i++)
+		weight[i] /= max_laplacian;
+
+	packHalf(weight, total_weight, num_pixels);
+
+	// Obtain the saliency weight and aggregate it
+	calcSaliencyWeightRef(image, weight, num_row, num_col, ws);
+	normalizeWeight(weight, num_pixels);
+	addHalf(total_weight, weight, num_pixels);
+
+	// Obtain the saturation weight and aggregate it
+	calcSaturationWeightRef(image, lum, weight, num_pixels);
+	normalizeWeight(weight, num_pixels);
+	addHalf(total_weight, weight, num_pixels);
+
+	// Release in the reverse order they were taken
+	releasePlanes(ws, weight);
+	releasePlanes(ws, lum);
+
+	return;
+}
+
 /**
 * Calculates the laplacian weight of an image. This is calculated by applying a Laplacian filter to the luminance and taking the absolute value.
 *
@@ -55,16 +139,30 @@ float* getWeights(float* image, const int num_row, const int num_col, const int
 */
 float* calcLaplacianWeight(float* lum, const int num_row, const int num_col)
 {
-	const int num_pixels = num_row * num_col;
+	float* w_lap = malloc(sizeof(float) * num_row * num_col);
+	calcLaplacianWeightRef(lum, w_lap, num_row, num_col, NULL);
 
-	// Apply the Laplacian Filter
-	float* w_lap = applyLaplacian(lum, num_row, num_col);
+	return w_lap;
+}
 
-	// Take the absolute value of each entry
-	for (int i = 0; i < num_pixels; i++)
-		w_lap[i] = ABS(w_lap[i]);
+/**
+* Calculates the laplacian weight of an image by reference.
+*
+* @param	lum			The luminance of each pixel of the original image
+* @param	w_lap		Memory to place the laplacian weight to
+* @param	num_row		The number of rows of the image
+* @param	num_col		The number of columns of the image
+* @param	ws			Unused since the filter no longer needs temporaries, kept for the callers
+*
+* @return				Utilizes existing memory for the result, returns the largest weight so that callers can
+*						normalize it in their next pass over the weight instead of calling normalizeWeight
+*/
+float calcLaplacianWeightRef(float* lum, float* w_lap, const int num_row, const int num_col, struct Workspace* ws)
+{
+	(void)ws;
 
-	return w_lap;
+	// Apply the Laplacian Filter and take the absolute value of each entry in one pass
+	return applyLaplacianAbsRef(lum, w_lap, num_row, num_col);
 }
 
 /**
@@ -77,36 +175,70 @@ float* calcLaplacianWeight(float* lum, const int num_row, const int num_col)
 * @return				Laplacian weight which is an array of size num_pixels.
 */
 float* calcSaliencyWeight(float* image, const int num_row, const int num_col)
+{
+	float* sal_weight = malloc(sizeof(float) * num_row * num_col);
+	calcSaliencyWeightRef(image, sal_weight, num_row, num_col, NULL);
+
+	return sal_weight;
+}
+
+/**
+* Calculates the saliency weight of an image by reference.
+*
+* @param	image		The image to get the saliency weight from
+* @param	sal_weight	Memory to place the saliency weight to
+* @param	num_row		The number of rows of the image
+* @param	num_col		The number of columns of the image
+* @param	ws			Workspace for temporaries, NULL to allocate them
+*
+* @return				Utilizes existing memory for the result
+*/
+void calcSaliencyWeightRef(float* image, float* sal_weight, const int num_row, const int num_col, struct Workspace* ws)
 {
 	const int num_pixels = num_row * num_col;
 
-	// Blur the image
-	float* blurred = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+	// Blur the image, the LAB image is never stored
+	float* blurred = takePlanes(ws, num_pixels * NUM_CHANNELS);
+	calcSaliencyBlurRef(image, blurred, num_row, num_col, ws);
+
+	// Calculate the average of each dimension
+	double lab_sum[NUM_CHANNELS] = { 0 };
+	float lab_avg[NUM_CHANNELS];
+	calcLABSums(blurred, num_pixels, 0, num_pixels, lab_sum);
 
 	for (int i = 0; i < NUM_CHANNELS; i++)
-		applyGaussianBlurRef(image, &blurred[num_pixels*i], num_row, num_col);
+		lab_avg[i] = (float)(lab_sum[i] / num_pixels);
 
-	// Convert from RGB to LAB
-	float* lab = rgb2LAB(blurred, num_pixels);
-	float* l = lab;
-	float* a = &lab[num_pixels];
-	float* b = &lab[num_pixels * 2];
+	// Calculate the saliency weight, converting to LAB again on the way
+	calcLABDistanceRef(blurred, sal_weight, num_pixels, lab_avg);
 
-	free(blurred);
+	releasePlanes(ws, blurred);
 
-	// Calculate the average of each dimension
-	float l_avg = calcAverage(l, num_pixels);
-	float a_avg = calcAverage(a, num_pixels);
-	float b_avg = calcAverage(b, num_pixels);
+	return;
+}
 
-	// Calculate the saliency weight
-	float* sal_weight = malloc(sizeof(float) * num_pixels);
+/**
+* Blurs an image for the saliency weight (see SALIENCY_BLUR). As in the original per-channel loop, which passed the
+* image itself for every channel, the blurred red plane is used for all three channels.
+*
+* @param	image		The image to get the saliency weight from
+* @param	blurred		Memory to place the blurred image to
+* @param	num_row		The number of rows of the image
+* @param	num_col		The number of columns of the image
+* @param	ws			Workspace for temporaries, NULL to allocate them
+*
+* @return				Utilizes existing memory for the result
+*/
+void calcSaliencyBlurRef(float* image, float* blurred, const int num_row, const int num_col, struct Workspace* ws)
+{
+	const int num_pixels = num_row * num_col;
 
-	for (int i = 0; i < num_pixels; i++)
-		sal_weight[i] = sqrt(calcNormSquare(l[i], l_avg, a[i], a_avg, b[i], b_avg));
+	applyGaussianBlurModeRef(image, blurred, 1, num_row, num_col, GAUSSIAN_SIGMA, GAUSSIAN_RADIUS, SALIENCY_BLUR, ws);
 
-	free(lab);
-	return sal_weight;
+	for (int c = 1; c < NUM_CHANNELS; c++)
+		memcpy(&blurred[c * num_pixels], blurred, sizeof(float) * num_pixels);
+
+	return;
 }
 
 /**
@@ -119,23 +251,42 @@ float* calcSaliencyWeight(float* image, const int num_row, const int num_col)
 * @return				Saturation weight which is an array of size num_pixels
 */
 float* calcSaturationWeight(float* image, float* lum, const int num_pixels)
+{
+	// Allocate new memory for the weight map
+	float* sat_weight = malloc(sizeof(float) * num_pixels);
+	calcSaturationWeightRef(image, lum, sat_weight, num_pixels);
+
+	return sat_weight;
+}
+
+/**
+* Calculates the saturation weight of an image by reference.
+* 
+* @param	image		The processed image to calculate the saturation weight of
+* @param	lum			The luminance of each pixel of "image"
+* @param	sat_weight	Memory to place the saturation weight to
+* @param	num_pixels	The size of the image
+* 
+* @return				Utilizes existing memory for the result
+*/
+void calcSaturationWeightRef(float* image, float* lum, float* sat_weight, const int num_pixels)
 {
 	// Create pointers to keep track of RGB indices easier
 	float* red = image;
 	float* green = &image[num_pixels];
 	float* blue = &image[num_pixels * 2];
 
-	// Allocate new memory for the weight map
-	float* sat_weight = malloc(sizeof(float) * num_pixels);
-
 	// Calculate the luminance and saturation weight:
 	// sqrt(1/3 * (red-lum)^2 * (green-lum)^2 * (blue-lum)^2)
 	for (int i = 0; i < num_pixels; i++)
 	{
-		sat_weight[i] = sqrt((1.0 / 3.0) * calcNormSquare(red[i], lum[i], green[i], lum[i], blue[i], lum[i]));
+		sat_weight[i] = calcNormSquare(red[i], lum[i], green[i], lum[i], blue[i], lum[i]);
 	}
 
-	return sat_weight;
+	// The third is still applied in double precision, so the result is the same as the scalar sqrt
+	sqrtArray(sat_weight, sat_weight, num_pixels, 1.0 / 3.0);
+
+	return;
 }
 
 /**
@@ -147,13 +298,29 @@ float* calcSaturationWeight(float* image, float* lum, const int num_pixels)
 * @return				Calculated luminance of the given rgb pair using the specified luminance option
 */
 float* calcLuminance(float* image, const int num_pixels, const int lum_option)
+{
+	float* lum = malloc(sizeof(float) * num_pixels);
+	calcLuminanceRef(image, lum, num_pixels, lum_option);
+
+	return lum;
+}
+
+/**
+* Calculates the luminance of an RGB pair by reference (see calcLuminance)
+* 
+* @param	image		Input to calculate the luminance of 
+* @param	lum			Memory to place the luminance to
+* @param	num_pixels	The number of pixels in the image
+* @param	lum_option	Determines which method used to calculate luminance. 0: Standard, 1: Percieved option, 2: Percieved option exact
+*
+* @return				Utilizes existing memory for the result
+*/
+void calcLuminanceRef(float* image, float* lum, const int num_pixels, const int lum_option)
 {
 	float* red = image;
 	float* green = &image[num_pixels];
 	float* blue = &image[num_pixels * 2];
 
-	float* lum = malloc(sizeof(float) * num_pixels);
-
 	// 0: Standard luminance option
 	if (lum_option == 0)
 	{
@@ -175,7 +342,7 @@ float* calcLuminance(float* image, const int num_pixels, const int lum_option)
 			lum[i] = 0.299 * red[i] + 0.587 * green[i] + 0.114 * blue[i];
 	}
 
-	return lum;
+	return;
 }
 
 /**
@@ -189,9 +356,7 @@ float* calcLuminance(float* image, const int num_pixels, const int lum_option)
 void normalizeWeight(float* weight, const int num_pixels)
 {
 	// Find the maximum of the weight map
-	float max = weight[0];
-	for (int i = 1; i < num_pixels; i++)
-		max = MAX(max, weight[i]);
+	const float max = calcMaxWeight(weight, num_pixels);
 
 	// Apply the normalization
 	for (int i = 0; i < num_pixels; i++)
@@ -200,6 +365,23 @@ void normalizeWeight(float* weight, const int num_pixels)
 	return;
 }
 
+/**
+* Finds the maximum of a weight map, the value normalizeWeight divides by
+* 
+* @param	weight		The weight map
+* @param	num_pixels	The number of entries in the weight map
+* 
+* @return				The largest entry
+*/
+float calcMaxWeight(const float* weight, const int num_pixels)
+{
+	float max = weight[0];
+	for (int i = 1; i < num_pixels; i++)
+		max = MAX(max, weight[i]);
+
+	return max;
+}
+
 /**
 * Converts from an RGB image to a LAB color space. This conversion requires us to convert from: RGB -> XYZ -> LAB
 * 
@@ -210,15 +392,282 @@ void normalizeWeight(float* weight, const int num_pixels)
 */
 float* rgb2LAB(float* image, const int num_pixels)
 {
-	// RGB to XYZ Conversion
-	float* xyz_image = rgb2XYZ(image, num_pixels);
+	float* lab_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+	rgb2LABRef(image, lab_image, num_pixels, NULL);
 
-	// XYZ to LAB Conversion
-	float* lab_image = xyz2LAB(xyz_image, num_pixels);
+	return lab_image;
+}
 
-	free(xyz_image);
+/**
+* Converts from an RGB image to a LAB color space by reference.
+* 
+* @param	image		The RGB image to be converted
+* @param	lab_image	Memory to place the LAB image to
+* @param	num_pixels	The number of pixels in the RGB image
+* @param	ws			Unused since the conversion no longer stores the XYZ image, kept for the callers
+* 
+* @return				Utilizes existing memory for the result
+*/
+void rgb2LABRef(float* image, float* lab_image, const int num_pixels, struct Workspace* ws)
+{
+	(void)ws;
+	rgb2LABPlanesRef(image, lab_image, num_pixels, LAB_PLANES_ALL);
 
-	return lab_image;
+	return;
+}
+
+/**
+* Looks up the LAB transfer table for a stage, before its loops so the threads do not all go through the table cache
+*
+* @return				The table with TRANSFER_TABLES, NULL otherwise or if it could not be built
+*/
+const struct TransferTable* getLABTable(void)
+{
+#if TRANSFER_TABLES
+	return getTransferTable(TRANSFER_LAB, 0);
+#else
+	return NULL;
+#endif
+}
+
+/**
+* Converts the pixels [first, first + count) of an RGB image to LAB in one go, without an XYZ image. The operations
+* are the same as rgb2XYZRef followed by xyz2LABRef, but labFunction is evaluated once per component.
+*
+* @param	image		The RGB image
+* @param	num_pixels	The number of pixels in the image (the distance between its planes)
+* @param	first		First pixel to convert
+* @param	count		Number of pixels to convert, at most TRANSFER_BLOCK
+* @param	table		LAB transfer table from getLABTable
+* @param	lab			Arrays to place the L, A and B values to
+*
+* @return				Fills in lab
+*/
+static void rgb2LABBlock(const float* image, const int num_pixels, const int first, const int count, const struct TransferTable* table,
+	float lab[NUM_CHANNELS][TRANSFER_BLOCK])
+{
+#if !TRANSFER_TABLES
+	(void)table;
+#endif
+
+	// Reference white of xyz2LABRef
+	const float white[NUM_CHANNELS] = { 76.04f, 80.0f, 87.12f };
+
+	const float* red = &image[first];
+	const float* green = &image[num_pixels + first];
+	const float* blue = &image[num_pixels * 2 + first];
+
+	// X / Xn, Y / Yn and Z / Zn, then labFunction of each
+	float ratio[NUM_CHANNELS][TRANSFER_BLOCK];
+
+	for (int i = 0; i < count; i++)
+	{
+		ratio[0][i] = (0.412453f * red[i] + 0.357580f * green[i] + 0.180423f * blue[i]) / white[0];
+		ratio[1][i] = (0.212671f * red[i] + 0.715160f * green[i] + 0.072169f * blue[i]) / white[1];
+		ratio[2][i] = (0.019334f * red[i] + 0.119193f * green[i] + 0.950227f * blue[i]) / white[2];
+	}
+
+#if TRANSFER_TABLES || SIMD_MATH
+	float function[NUM_CHANNELS][TRANSFER_BLOCK];
+
+	for (int c = 0; c < NUM_CHANNELS; c++)
+	{
+#if TRANSFER_TABLES
+		// The table already includes the linear part of labFunction
+		if (table != NULL)
+			applyTransferTable(table, ratio[c], function[c], count, getSimdLevel());
+
+		else
+		{
+			for (int i = 0; i < count; i++)
+				function[c][i] = calcTransferExact(TRANSFER_LAB, 0, ratio[c][i]);
+		}
+#else
+		cbrtArray(ratio[c], function[c], count);
+
+		for (int i = 0; i < count; i++)
+			function[c][i] = (ratio[c][i] > 0.00856) ? function[c][i] : (float)(7.787 * ratio[c][i] + 16.0 / 116.0);
+#endif
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		const float l = (ratio[1][i] > 0.00856) ? 116 * function[1][i] - 16 : 903.3 * ratio[1][i];
+		const float a = 500 * function[0][i] - function[1][i];
+		const float b = 200 * function[1][i] - function[2][i];
+
+		lab[0][i] = l;
+		lab[1][i] = a;
+		lab[2][i] = b;
+	}
+#else
+	// L needs the cube root of Y / Yn in double precision, labFunction rounds it to float
+	for (int i = 0; i < count; i++)
+	{
+		float function[NUM_CHANNELS];
+		double root_y = 0;
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			if (ratio[c][i] > 0.00856)
+			{
+				const double cube_root = pow(ratio[c][i], (1.0 / 3.0));
+				root_y = (c == 1) ? cube_root : root_y;
+				function[c] = (float)cube_root;
+			}
+
+			else
+				function[c] = (float)(7.787 * ratio[c][i] + 16.0 / 116.0);
+		}
+
+		lab[0][i] = (ratio[1][i] > 0.00856) ? 116 * root_y - 16 : 903.3 * ratio[1][i];
+		lab[1][i] = 500 * function[0] - function[1];
+		lab[2][i] = 200 * function[1] - function[2];
+	}
+#endif
+
+	return;
+}
+
+/**
+* Converts the pixels [first, last) of an RGB image to LAB a block at a time, the argument is a struct lab_args.
+* Writes either the requested LAB planes or, when distance is set, the saliency distance to lab_avg.
+*/
+void* rgb2LABWorker(void* vargs)
+{
+	struct lab_args* args = (struct lab_args*)vargs;
+	const int num_pixels = args->num_pixels;
+
+	float lab[NUM_CHANNELS][TRANSFER_BLOCK];
+
+	for (int first = args->first; first < args->last; first += TRANSFER_BLOCK)
+	{
+		const int count = (args->last - first < TRANSFER_BLOCK) ? args->last - first : TRANSFER_BLOCK;
+		rgb2LABBlock(args->image, num_pixels, first, count, args->table, lab);
+
+		if (args->distance != NULL)
+		{
+			const float* lab_avg = args->lab_avg;
+			float* distance = &args->distance[first];
+
+			// Euclidean distance of each pixel to the average LAB value, with vectorized square roots that round the same
+			// as sqrt in double precision
+			for (int i = 0; i < count; i++)
+				distance[i] = calcNormSquare(lab[0][i], lab_avg[0], lab[1][i], lab_avg[1], lab[2][i], lab_avg[2]);
+
+			sqrtArray(distance, distance, count, 1.0);
+			continue;
+		}
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			if (args->planes & (1 << c))
+				memcpy(&args->lab[num_pixels * c + first], lab[c], sizeof(float) * count);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+* Splits a fused RGB to LAB kernel between the threads (see getNumThreads)
+*/
+static void runLABThreads(const float* image, float* lab_image, float* distance, const float* lab_avg, const int num_pixels, const int planes)
+{
+	struct lab_args args[MAX_THREADS];
+	const struct TransferTable* table = getLABTable();
+
+	int num_threads = (num_pixels >= MIN_PARALLEL_LAB) ? getNumThreads() : 1;
+	num_threads = (num_threads < 1) ? 1 : num_threads;
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		args[i].image = image;
+		args[i].lab = lab_image;
+		args[i].distance = distance;
+		args[i].lab_avg = lab_avg;
+		args[i].num_pixels = num_pixels;
+		args[i].first = (int)((long)num_pixels * i / num_threads);
+		args[i].last = (int)((long)num_pixels * (i + 1) / num_threads);
+		args[i].planes = planes;
+		args[i].table = table;
+	}
+
+	runParallel(rgb2LABWorker, args, sizeof(struct lab_args), num_threads);
+
+	return;
+}
+
+/**
+* Converts from an RGB image to LAB in a single pass split between the threads, writing only some of the planes
+*
+* @param	image		The RGB image to be converted
+* @param	lab_image	Memory for the LAB image, plane c is written to lab_image[c * num_pixels] when requested
+* @param	num_pixels	The number of pixels in the RGB image
+* @param	planes		Which planes to write, a combination of LAB_PLANE_L, LAB_PLANE_A and LAB_PLANE_B
+*
+* @return				Utilizes existing memory for the result
+*/
+void rgb2LABPlanesRef(const float* image, float* lab_image, const int num_pixels, const int planes)
+{
+	runLABThreads(image, lab_image, NULL, NULL, num_pixels, planes);
+
+	return;
+}
+
+/**
+* Adds up the L, A and B values of the pixels [first, last) of an RGB image without storing them. The pixels are added
+* in order onto running sums kept in doubles (see calcChannelAverages), so sums over consecutive ranges match one sum over
+* the whole image.
+*
+* @param	image		The RGB image
+* @param	num_pixels	The number of pixels in the image (the distance between its planes)
+* @param	first		First pixel to add
+* @param	last		One past the last pixel to add
+* @param	lab_sum		Running sums of the L, A and B planes to add to
+*
+* @return				Updates lab_sum
+*/
+void calcLABSums(const float* image, const int num_pixels, const int first, const int last, double* lab_sum)
+{
+	float lab[NUM_CHANNELS][TRANSFER_BLOCK];
+	const struct TransferTable* table = getLABTable();
+
+	for (int start = first; start < last; start += TRANSFER_BLOCK)
+	{
+		const int count = (last - start < TRANSFER_BLOCK) ? last - start : TRANSFER_BLOCK;
+		rgb2LABBlock(image, num_pixels, start, count, table, lab);
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			double total = lab_sum[c];
+
+			for (int i = 0; i < count; i++)
+				total += lab[c][i];
+
+			lab_sum[c] = total;
+		}
+	}
+
+	return;
+}
+
+/**
+* Calculates the saliency distance, the distance of each pixel to the average LAB value, straight from an RGB image,
+* converting each pixel to LAB on the fly instead of reading a stored LAB image
+*
+* @param	image		The blurred RGB image
+* @param	distance	Memory to place the saliency weight to
+* @param	num_pixels	The number of pixels in the image
+* @param	lab_avg		Average of the L, A and B planes over the whole image
+*
+* @return				Utilizes existing memory for the result
+*/
+void calcLABDistanceRef(const float* image, float* distance, const int num_pixels, const float* lab_avg)
+{
+	runLABThreads(image, NULL, distance, lab_avg, num_pixels, 0);
+
+	return;
 }
 
 /**
@@ -230,6 +679,23 @@ float* rgb2LAB(float* image, const int num_pixels)
 * @return				The converted LAB image is dynamically allocated and a pointer to its first entry is returned
 */
 float* xyz2LAB(float* image, const int num_pixels)
+{
+	float* lab_image = malloc(sizeof(float) * num_pixels * 3);
+	xyz2LABRef(image, lab_image, num_pixels);
+
+	return lab_image;
+}
+
+/**
+* Performs the conversion from the XYZ to LAB color space by reference.
+*
+* @param	image		The XYZ image
+* @param	lab_image	Memory to place the LAB image to
+* @param	num_pixels	The number of pixels in the image
+*
+* @return				Utilizes existing memory for the result
+*/
+void xyz2LABRef(float* image, float* lab_image, const int num_pixels)
 {
 	// Constants
 	const float xn = 76.04;
@@ -242,7 +708,6 @@ float* xyz2LAB(float* image, const int num_pixels)
 	float* z = &image[num_pixels * 2];
 
 	// XYZ to LAB Conversion
-	float* lab_image = malloc(sizeof(float) * num_pixels * 3);
 	float* l = lab_image;
 	float* a = &lab_image[num_pixels];
 	float* b = &lab_image[num_pixels * 2];
@@ -260,7 +725,7 @@ float* xyz2LAB(float* image, const int num_pixels)
 		b[i] = 200 * labFunction(y[i], yn) - labFunction(z[i], zn);
 	}
 
-	return lab_image;
+	return;
 }
 
 /**
@@ -276,6 +741,23 @@ float* xyz2LAB(float* image, const int num_pixels)
 * @return				The converted XYZ image is dynamically allocated and a pointer to its first entry is returned
 */
 float* rgb2XYZ(float* image, const int num_pixels)
+{
+	float* xyz_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+	rgb2XYZRef(image, xyz_image, num_pixels);
+
+	return xyz_image;
+}
+
+/**
+* Performs the conversion from the RGB to XYZ color space by reference (see rgb2XYZ).
+* 
+* @param	image		The RGB image
+* @param	xyz_image	Memory to place the XYZ image to
+* @param	num_pixels	The number of pixels in the image
+* 
+* @return				Utilizes existing memory for the result
+*/
+void rgb2XYZRef(float* image, float* xyz_image, const int num_pixels)
 {
 	// Helper pointers to RGB
 	float* red = image;
@@ -283,7 +765,6 @@ float* rgb2XYZ(float* image, const int num_pixels)
 	float* blue = &image[num_pixels * 2];
 
 	// RGB to XYZ Conversion
-	float* xyz_image = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
 	float* x = xyz_image;
 	float* y = &xyz_image[num_pixels];
 	float* z = &xyz_image[num_pixels * 2];
@@ -296,7 +777,7 @@ float* rgb2XYZ(float* image, const int num_pixels)
 		z[i] = 0.019334f * red[i] + 0.119193f * green[i] + 0.950227f * blue[i];
 	}
 
-	return xyz_image;
+	return;
 }
 
 /**
@@ -312,14 +793,30 @@ float* rgb2XYZ(float* image, const int num_pixels)
 * @return				The converted RGB image is dynamically allocated and a pointer to its first entry is returned
 */
 float* xyz2rgb(float* image, const int num_pixels)
+{
+	float* rgb = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+	xyz2rgbRef(image, rgb, num_pixels);
+
+	return rgb;
+}
+
+/**
+* Performs the conversion from the XYZ to RGB color space by reference (see xyz2rgb).
+*
+* @param	image		The XYZ image
+* @param	rgb			Memory to place the RGB image to
+* @param	num_pixels	The number of pixels in the image
+*
+* @return				Utilizes existing memory for the result
+*/
+void xyz2rgbRef(float* image, float* rgb, const int num_pixels)
 {
 	// Helper pointers to RGB
 	float* x = image;
 	float* y = &image[num_pixels];
 	float* z = &image[num_pixels * 2];
 
-	// RGB to XYZ Conversion
-	float* rgb = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+	// XYZ to RGB Conversion
 	float* red = rgb;
 	float* green = &rgb[num_pixels];
 	float* blue = &rgb[num_pixels * 2];
@@ -337,7 +834,7 @@ float* xyz2rgb(float* image, const int num_pixels)
 
 	}
 
-	return rgb;
+	return;
 }
 
 /**
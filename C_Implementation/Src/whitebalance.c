@@ -12,15 +12,245 @@
 */
 float* applyWhiteBalance(float* image, const int num_row, const int num_col, const float alpha)
 {
+    float* corrected = malloc(sizeof(float) * num_row * num_col * NUM_CHANNELS);
+    applyWhiteBalanceRef(image, corrected, num_row, num_col, alpha, NULL);
+
+    return corrected;
+}
+
+/**
+* Applies white balance on an image by reference (see applyWhiteBalance)
+*
+* The steps are the same as compensateChannels, linearizeRGB and applyGreyWorldFullRef, but since the illuminant is fixed
+* the transform is known up front, so after one pass for the channel averages every pixel is finished in a single pass.
+*
+* @param   image       RGB image normalized on the interval [0,1]
+* @param   corrected   Memory to place the white balanced image to, may be the same as the image
+* @param   num_row     Number of rows in the image
+* @param   num_col     Number of columns in the image
+* @param   alpha       Multiplicative factor to control the amount of compensation (default should be 1)
+* @param   ws          Unused since the single pass needs no temporaries, kept for the callers
+*
+* @return              Utilizes existing memory for the result
+*/
+void applyWhiteBalanceRef(float* image, float* corrected, const int num_row, const int num_col, const float alpha, struct Workspace* ws)
+{
+    (void)ws;
     const int num_pixels = num_row * num_col;
 
+    float averages[NUM_CHANNELS];
+    calcChannelAverages(image, num_pixels, averages);
+
+    // Grey World with the fixed illuminant (see applyGreyWorldFullRef)
+    float illuminants[NUM_CHANNELS] = { FIXED_ILLUMINANT_RED, FIXED_ILLUMINANT_GREEN, FIXED_ILLUMINANT_BLUE };
+    float transformation[NUM_CHANNELS * NUM_CHANNELS] = { 0 };
+    calcGreyWorldTransform(illuminants, transformation);
+
+    applyWhiteBalancePixels(image, corrected, num_pixels, averages, alpha, transformation);
+    //applyGreyWorld(image, num_pixels);
+
+    return;
+}
+
+/**
+* Converts a linear RGB pixel to XYZ, applies the chromatic adaptation transform and converts it back to RGB.
+* Every step does the same operations in the same order as the full image functions, so the result is bit identical.
+*/
+static inline void adaptPixel(const float* rgb, float* output, const float* transformation)
+{
+    const float red = rgb[0];
+    const float green = rgb[1];
+    const float blue = rgb[2];
+
+    // RGB to XYZ (see rgb2XYZRef)
+    float xyz[NUM_CHANNELS];
+    xyz[0] = 0.412453f * red + 0.357580f * green + 0.180423f * blue;
+    xyz[1] = 0.212671f * red + 0.715160f * green + 0.072169f * blue;
+    xyz[2] = 0.019334f * red + 0.119193f * green + 0.950227f * blue;
+
+    // Chromatic adaptation, summed in the order of multiplyFlatMatrixRef
+    float trans_xyz[NUM_CHANNELS];
+
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        trans_xyz[i] = 0;
+
+        for (int j = 0; j < NUM_CHANNELS; j++)
+            trans_xyz[i] += transformation[i * NUM_CHANNELS + j] * xyz[j];
+    }
+
+    // XYZ to RGB (see xyz2rgbRef)
+    const float new_red = 3.2404542 * trans_xyz[0] - 1.5371385 * trans_xyz[1] - 0.4985314 * trans_xyz[2];
+    const float new_green = -0.9692660 * trans_xyz[0] + 1.8760108 * trans_xyz[1] + 0.0415560 * trans_xyz[2];
+    const float new_blue = 0.0556434 * trans_xyz[0] - 0.2040259 * trans_xyz[1] + 1.0572252 * trans_xyz[2];
+
+    output[0] = ABS(new_red);
+    output[1] = ABS(new_green);
+    output[2] = ABS(new_blue);
+
+    return;
+}
+
+/**
+* White balances the pixels [first, last) of an image, the argument is a struct white_args. The pixels go through
+* compensation, linearization and adaptation one block at a time so that each step works on data in cache.
+*/
+void* whiteBalanceWorker(void* vargs)
+{
+    struct white_args* args = (struct white_args*)vargs;
+    const int num_pixels = args->num_pixels;
+    const float* averages = args->averages;
+    const float alpha = args->alpha;
+
+    const float* red = args->image;
+    const float* green = &args->image[num_pixels];
+    const float* blue = &args->image[num_pixels * 2];
+
+    float* out_red = args->output;
+    float* out_green = &args->output[num_pixels];
+    float* out_blue = &args->output[num_pixels * 2];
+
+    float block[NUM_CHANNELS][TRANSFER_BLOCK];
+    float rgb[NUM_CHANNELS];
+    float corrected[NUM_CHANNELS];
+
+#if TRANSFER_TABLES
+    const struct TransferTable* srgb = getTransferTable(TRANSFER_SRGB_LINEAR, 0);
+#endif
+
+    for (int first = args->first; first < args->last; first += TRANSFER_BLOCK)
+    {
+        const int count = (args->last - first < TRANSFER_BLOCK) ? args->last - first : TRANSFER_BLOCK;
+
+        // Compensation (see compensateChannels)
+        for (int i = 0; i < count; i++)
+        {
+            block[0][i] = red[first + i] + alpha * (averages[1] - averages[0]) * (1 - red[first + i]) * green[first + i];
+            block[1][i] = green[first + i];
+            block[2][i] = blue[first + i] + alpha * (averages[1] - averages[2]) * (1 - blue[first + i]) * green[first + i];
+        }
+
+        // Linearization (see linearizeRGB)
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+#if TRANSFER_TABLES
+            if (srgb != NULL)
+            {
+                applyTransferTable(srgb, block[c], block[c], count, getSimdLevel());
+                continue;
+            }
+#endif
+            for (int i = 0; i < count; i++)
+                block[c][i] = linearizerHelper(block[c][i]);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            rgb[0] = block[0][i];
+            rgb[1] = block[1][i];
+            rgb[2] = block[2][i];
+
+            adaptPixel(rgb, corrected, args->transformation);
+
+            out_red[first + i] = corrected[0];
+            out_green[first + i] = corrected[1];
+            out_blue[first + i] = corrected[2];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+* Applies the whole white balance to every pixel in a single pass split between the threads (see getNumThreads).
+* The result is the same as compensateChannels, linearizeRGB and applyGreyWorldTransformRef one after the other.
+*
+* @param   image           RGB image normalized on the interval [0,1], it is not modified unless it is also the output
+* @param   output          Memory to place the white balanced image to, may be the same as the image
+* @param   num_pixels      Number of pixels in the image
+* @param   averages        Average of the red, green and blue channels used for the compensation (see calcChannelAverages)
+* @param   alpha           Multiplicative factor to control the amount of compensation (default should be 1)
+* @param   transformation  3 x 3 transform from calcGreyWorldTransform
+*
+* @return                  Utilizes existing memory for the result
+*/
+void applyWhiteBalancePixels(const float* image, float* output, const int num_pixels, const float* averages, const float alpha, const float* transformation)
+{
+    struct white_args args[MAX_THREADS];
+
+    int num_threads = (num_pixels >= MIN_PARALLEL_WHITE) ? getNumThreads() : 1;
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].image = image;
+        args[i].output = output;
+        args[i].num_pixels = num_pixels;
+        args[i].first = (int)((long)num_pixels * i / num_threads);
+        args[i].last = (int)((long)num_pixels * (i + 1) / num_threads);
+        args[i].averages = averages;
+        args[i].alpha = alpha;
+        args[i].transformation = transformation;
+    }
+
+    runParallel(whiteBalanceWorker, args, sizeof(struct white_args), num_threads);
+
+    return;
+}
+
+/**
+* Calculates the average of each channel in a single pass. The sums are kept in doubles, a float sum stops growing
+* once it is about 2^24 times the samples added to it, which large images reach long before their last pixel.
+*
+* @param   image       RGB image stored as [R1 R2 R3 ..., G1 G2 G3 ..., B1 B2 B3 ...]
+* @param   num_pixels  Number of pixels in the image
+* @param   averages    Array of 3 averages to fill in
+*
+* @return              Stores the averages in the caller's array
+*/
+void calcChannelAverages(const float* image, const int num_pixels, float* averages)
+{
+    const float* red = image;
+    const float* green = &image[num_pixels];
+    const float* blue = &image[num_pixels * 2];
+
+    double sum_R = 0;
+    double sum_G = 0;
+    double sum_B = 0;
+
+    for (int i = 0; i < num_pixels; i++)
+    {
+        sum_R += red[i];
+        sum_G += green[i];
+        sum_B += blue[i];
+    }
+
+    averages[0] = (float)(sum_R / num_pixels);
+    averages[1] = (float)(sum_G / num_pixels);
+    averages[2] = (float)(sum_B / num_pixels);
+
+    return;
+}
+
+/**
+* Compensates the red and blue channels using the channel averages of the whole image
+*
+* @param   image       RGB image normalized on the interval [0,1]
+* @param   num_pixels  Number of pixels in the image
+* @param   averages    Average of the red, green and blue channels of the whole image
+* @param   alpha       Multiplicative factor to control the amount of compensation (default should be 1)
+*
+* @return              Modifies the original image
+*/
+void compensateChannels(float* image, const int num_pixels, const float* averages, const float alpha)
+{
     float* red = image;
     float* green = &image[num_pixels];
     float* blue = &image[num_pixels * 2];
 
-    float avg_R = calcAverage(red, num_pixels);
-    float avg_G = calcAverage(green, num_pixels);
-    float avg_B = calcAverage(blue, num_pixels);
+    const float avg_R = averages[0];
+    const float avg_G = averages[1];
+    const float avg_B = averages[2];
 
     // Apply Red Channel Compensation
     // This accounts for the fact that longer wavelength light is attentuated with water depth
@@ -36,11 +266,7 @@ float* applyWhiteBalance(float* image, const int num_row, const int num_col, con
         blue[i] += alpha * (avg_G - avg_B) * (1 - blue[i]) * green[i];
     }
 
-    // Apply Grey World and swap out the memory from the original image
-    float* corrected = applyGreyWorldFull(image, num_pixels, 20);
-    //applyGreyWorld(image, num_pixels);
-
-    return corrected;
+    return;
 }
 
 /**
@@ -125,37 +351,73 @@ float linearizerHelper(const float pixel)
  * @return              Returns a newly allocated array represented the color correted image (used to be by reference but this caused sync issues)
  */
 float* applyGreyWorldFull(float* image, const int num_pixels, const int percentile)
+{
+    float* output = malloc(sizeof(float) * num_pixels * NUM_CHANNELS);
+    applyGreyWorldFullRef(image, output, num_pixels, percentile, NULL);
+
+    return output;
+}
+
+/** Applies the full Grey World Algorithm based on illuminants by reference (see applyGreyWorldFull).
+ * 
+ * @param   image       The flattened 2D image normalized between [0,1], linearized in place
+ * @param   output      Memory to place the color corrected image to
+ * @param   num_pixels  Number of pixels in the image   
+ * @param   percentile  Determines the upper and lower percentile of pixel values used to calculate the illuminant. 
+ * @param   ws          Workspace for the XYZ temporary, NULL to allocate it
+ * 
+ * @return              Utilizes existing memory for the result
+ */
+void applyGreyWorldFullRef(float* image, float* output, const int num_pixels, const int percentile, struct Workspace* ws)
+{
+    // Convert the image to Linear RGB
+    linearizeRGB(image, num_pixels);
+
+    // Calculate the illuminant of the linearized RGB image
+    float illuminants[NUM_CHANNELS];
+    calcIlluminantRGB(image, num_pixels, percentile, illuminants);
+    illuminants[0] = FIXED_ILLUMINANT_RED;
+    illuminants[1] = FIXED_ILLUMINANT_GREEN;
+    illuminants[2] = FIXED_ILLUMINANT_BLUE;
+
+    float transformation[NUM_CHANNELS * NUM_CHANNELS] = { 0 };
+    calcGreyWorldTransform(illuminants, transformation);
+
+    applyGreyWorldTransformRef(image, output, num_pixels, transformation, ws);
+
+    return;
+}
+
+/**
+ * Calculates the chromatic adaptation transform from the illuminant to the D65 white point using the Bradford method
+ * 
+ * @param   illuminants     Illuminant of each channel (see calcIlluminantRGB)
+ * @param   transformation  3 x 3 matrix to place the transform to, must be zeroed
+ * 
+ * @return                  Fills in transformation
+ */
+void calcGreyWorldTransform(float* illuminants, float* transformation)
 {
     // Reference XYZ White Trismus Values for D65 Illuminant
-    const float TARGET_WHITE[3] = { 0.95047,	1.00000,	1.08883 };
+    float TARGET_WHITE[3] = { 0.95047,	1.00000,	1.08883 };
 
     // Constant Bradford matrices used to calculate the final transformation matrices
-    const float bradford[9] = {
+    float bradford[9] = {
         0.8951000, 0.266400, -0.161400,
         -0.750200, 1.7135000, 0.0367000,
         0.0389000, -0.0685000, 1.0296000 };
 
-    const float bradford_inv[9] = {
+    float bradford_inv[9] = {
         0.9869929, -0.1470543, 0.1599627,
         0.4323053, 0.5183603, 0.0492912,
         -0.0085287, 0.0400428, 0.9684867 };
 
-    // Convert the image to Linear RGB, then to XYZ
-    linearizeRGB(image, num_pixels);
-    float* xyz_image = rgb2XYZ(image, num_pixels);
-    float* x = &xyz_image[0];
-    float* y = &xyz_image[num_pixels];
-    float* z = &xyz_image[num_pixels * 2];
-
-    // Calculate the illuminant of the linearized RGB image
-    float* illuminants = calcIlluminantRGB(image, num_pixels, percentile);
-    illuminants[0] = 0.689697867312801;
-    illuminants[1] = 1.0;
-    illuminants[2] = 0.844054675120857;
-
     // Calculate the cone values ie: bradford(3x3) * (x, y, z)^T
-    float* source_cone = multiplyFlatMatrix(bradford, illuminants, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, 1);
-    float* target_cone = multiplyFlatMatrix(bradford, TARGET_WHITE, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, 1);
+    // The 3x3 products are small enough to live on the stack
+    float source_cone[NUM_CHANNELS] = { 0 };
+    float target_cone[NUM_CHANNELS] = { 0 };
+    multiplyFlatMatrixRef(bradford, illuminants, source_cone, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, 1);
+    multiplyFlatMatrixRef(bradford, TARGET_WHITE, target_cone, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, 1);
 
     /*
     Construct the middle diagonal matrix:
@@ -164,19 +426,37 @@ float* applyGreyWorldFull(float* image, const int num_pixels, const int percenti
                   0                   source_cone[1] / target_cone[1]                     0
                   0                               0                           source_cone[2] / target_cone[2]
     */
-    float* diag = calloc(NUM_CHANNELS * NUM_CHANNELS, sizeof(float));
+    float diag[NUM_CHANNELS * NUM_CHANNELS] = { 0 };
     for (int i = 0; i < NUM_CHANNELS; i++)
         diag[4 * i] = target_cone[i] / source_cone[i];
-    
-    // Free the cone data
-    free(source_cone);
-    free(target_cone);
 
     // Get the entire transofrmation matrix
-    float* intermediate = multiplyFlatMatrix(bradford_inv, diag, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS);
-    free(diag);
-    float* transformation = multiplyFlatMatrix(intermediate, bradford, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS);
-    free(intermediate);
+    float intermediate[NUM_CHANNELS * NUM_CHANNELS] = { 0 };
+    multiplyFlatMatrixRef(bradford_inv, diag, intermediate, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS);
+    multiplyFlatMatrixRef(intermediate, bradford, transformation, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS, NUM_CHANNELS);
+
+    return;
+}
+
+/**
+ * Applies a chromatic adaptation transform to a linear RGB image in the XYZ color space
+ * 
+ * @param   image           The linearized RGB image
+ * @param   output          Memory to place the color corrected image to
+ * @param   num_pixels      Number of pixels in the image
+ * @param   transformation  3 x 3 transform from calcGreyWorldTransform
+ * @param   ws              Workspace for the XYZ temporary, NULL to allocate it
+ * 
+ * @return                  Utilizes existing memory for the result
+ */
+void applyGreyWorldTransformRef(float* image, float* output, const int num_pixels, float* transformation, struct Workspace* ws)
+{
+    // Convert to XYZ
+    float* xyz_image = takePlanes(ws, num_pixels * NUM_CHANNELS);
+    rgb2XYZRef(image, xyz_image, num_pixels);
+    float* x = &xyz_image[0];
+    float* y = &xyz_image[num_pixels];
+    float* z = &xyz_image[num_pixels * 2];
 
     // Apply the transformation to each XYZ pair
     float xyz_pair[NUM_CHANNELS];
@@ -201,16 +481,14 @@ float* applyGreyWorldFull(float* image, const int num_pixels, const int percenti
         z[i] = trans_xyz[2];
     }
 
-    free(transformation);
+    xyz2rgbRef(xyz_image, output, num_pixels);
+    releasePlanes(ws, xyz_image);
 
-    float* output = xyz2rgb(xyz_image, num_pixels);
-    free(xyz_image);
-
-    return output;
+    return;
 }
 
 /**
- * Calculates the illuminant of a color channel by quantizing pixel values in a histogram (2^10 bins) and finding the average of pixels in a percentile range.
+ * Calculates the illuminant of a color channel by quantizing pixel values in a histogram (NUM_BINS bins) and finding the average of pixels in a percentile range.
  * 
  * @param   image       The flattened 2D image normalized between [0,1]. Note that for RGB images, apply this function on each channel individually
  * @param   num_pixels  Number of pixels in the image
@@ -221,94 +499,166 @@ float* applyGreyWorldFull(float* image, const int num_pixels, const int percenti
  */
 float calcIlluminant(float* image, const int num_pixels, const int percentile)
 {
-    // Create the historgram of RGB values
-    int* histogram = calloc(NUM_BINS, sizeof(int));
-    int* cum_sum_forward = calloc(NUM_BINS, sizeof(int));
-    int* cum_sum_backward = calloc(NUM_BINS, sizeof(int));
+    float illuminant = 0;
+    calcIlluminants(image, num_pixels, 1, percentile, &illuminant);
 
-    const double step = 1.0 / (NUM_BINS);
-    int idx_high = -1;
-    int idx_low = -1;
-
-    // Loop thorugh all pixel values, note that we multiply by 255 to get an integer representaton
-    for (int i = 0; i < num_pixels; i++)
-    {
-        histogram[(int)(image[i] / step) % (NUM_BINS)]++;
-    }
+    return illuminant;
+}
 
-    // Thresholds to determine the mask
-    float low_threshold = num_pixels * percentile / 100.0f;
-    float high_threshold = num_pixels * (100.0f - percentile) / 100.0f;
+/**
+ * Helper function to loop through each color channel and calculate the illuminant of each one.
+ * 
+ * @param   image       The flattened 2D image normalized between [0,1]. Note that for RGB images, apply this function on each channel individually
+ * @param   num_pixels  Number of pixels in the image
+ * @param   percentile  Determines the upper and lower percentile of pixel values used to calculate the illuminant. 
+ *                      For example if percentile = 20, consider pixels in the 20th and 80th percentile.
+ * 
+ * @param   illuminants Array of 3 illuminants to fill in. One for each color channel.
+ * 
+ * @return              Stores the illuminants in the caller's array (a static array here is not safe once several images are processed at once)
+ */
+void calcIlluminantRGB(float* image, const int num_pixels, const int percentile, float* illuminants)
+{
+    calcIlluminants(image, num_pixels, NUM_CHANNELS, percentile, illuminants);
 
-    // Initialize the values of the indexes that satisfy the thershold requirement
-    cum_sum_forward[0] = histogram[0];
-    cum_sum_backward[0] = histogram[(NUM_BINS) - 1];
+    return;
+}
 
-    if (cum_sum_forward[0] > low_threshold)
-        idx_low = 0;
+/**
+ * Finds the upper end of the illuminant's range from the cumulative counts. The backward sums this replaces counted
+ * the last bin twice (it started at the last bin and then added bins NUM_BINS - i for i = 1, 2, ...), so the same
+ * count is kept here, along with a first match giving index 0.
+ *
+ * @param   hist        Histogram of the channels (see calcIlluminants)
+ * @param   channel     Channel to search
+ * @param   threshold   Number of values the backward sum has to exceed
+ *
+ * @return              Index of the upper bin, -1 if the threshold is never exceeded
+ */
+static int findIlluminantHigh(const struct Histogram* hist, const int channel, const float threshold)
+{
+    const int* cumulative = hist->cumulative[channel];
+    const int last = hist->num_bins - 1;
+    const int total = cumulative[last];
+    const int top = hist->counts[channel][last];
 
-    if (cum_sum_backward[0] > high_threshold)
-        idx_high = 0;
+    if (top > threshold)
+        return 0;
 
-    // Loop through the histogram
-    // Get the cumulative sum going forward and backwards
-    for (int i = 1; i < (NUM_BINS); i++)
+    for (int i = 1; i < hist->num_bins; i++)
     {
-        // Calculate the cumulative sums and update the indexes
-        cum_sum_forward[i] = cum_sum_forward[i - 1] + histogram[i];
-        cum_sum_backward[i] = cum_sum_backward[i - 1] + histogram[(NUM_BINS) - i];
-
-        if (idx_low == -1 && cum_sum_forward[i] > low_threshold)
-            idx_low = i;
-
-        if (idx_high == -1 && cum_sum_backward[i] > high_threshold)
-            idx_high = ((NUM_BINS)-i);
+        if (top + total - cumulative[last - i] > threshold)
+            return hist->num_bins - i;
     }
 
-    // Get the L1 norm of the pixels within our new range
-    float eps = 1e-3;
-    float sum = 0;
-    int count = 0;
+    return -1;
+}
 
-    for (int i = 0; i < num_pixels; i++)
+/**
+ * Adds up the values within the range of each channel for the pixels [first, last), the argument is a struct illuminant_args
+ */
+void* illuminantWorker(void* vargs)
+{
+    struct illuminant_args* args = (struct illuminant_args*)vargs;
+
+    for (int c = 0; c < args->num_channels; c++)
     {
-        if (image[i] <= (3.0/2*step)*idx_high + eps && image[i] >= (3.0 / 2 * step)* idx_low - eps)
+        const float* plane = &args->image[(size_t)c * args->num_pixels];
+        float sum = 0;
+        int count = 0;
+
+        for (int i = args->first; i < args->last; i++)
         {
-            sum += ABS(image[i]);
-            count++;
+            if (plane[i] <= args->high[c] && plane[i] >= args->low[c])
+            {
+                sum += ABS(plane[i]);
+                count++;
+            }
         }
-    }
 
-    free(histogram);
-    free(cum_sum_backward);
-    free(cum_sum_forward);
+        args->sum[c] = sum;
+        args->count[c] = count;
+    }
 
-    // Special cases for count = 0 to avoid infinity
-    if (count == 0)
-        return 0;
-    else
-        return (sum / count);
+    return NULL;
 }
 
 /**
- * Helper function to loop through each color channel and calculate the illuminant of each one.
- * 
- * @param   image       The flattened 2D image normalized between [0,1]. Note that for RGB images, apply this function on each channel individually
- * @param   num_pixels  Number of pixels in the image
- * @param   percentile  Determines the upper and lower percentile of pixel values used to calculate the illuminant. 
- *                      For example if percentile = 20, consider pixels in the 20th and 80th percentile.
- * 
- * @return              Returns an array of 3 illuminants. One for each color channel.
+ * Calculates the illuminant of each channel of an image (see calcIlluminant). The histograms of all the channels are
+ * built in one pass (see buildHistogram), both ends of each range come from the same cumulative counts, and the values
+ * within the ranges are added up by the threads and combined in order.
+ *
+ * @param   image           The image normalized between [0,1], channel c starts at image[c * num_pixels]
+ * @param   num_pixels      Number of pixels in the image
+ * @param   num_channels    Number of channels, at most NUM_CHANNELS
+ * @param   percentile      Determines the upper and lower percentile of pixel values used to calculate the illuminant
+ * @param   illuminants     Memory to place the illuminant of each channel to
+ *
+ * @return                  Utilizes existing memory for the result
  */
-float* calcIlluminantRGB(float* image, const int num_pixels, const int percentile)
+void calcIlluminants(const float* image, const int num_pixels, const int num_channels, const int percentile, float* illuminants)
 {
-    // Since we pass this as a return value, it needs to be static... I learned this the hard way.
-    static float illuminants[NUM_CHANNELS] = { 0 };
+    struct Histogram hist;
+    struct illuminant_args args[MAX_THREADS];
 
-    for (int i = 0; i < NUM_CHANNELS; i++)
-        illuminants[i] = calcIlluminant(&image[i * num_pixels], num_pixels, percentile);
+    // Quantize each channel in NUM_BINS bins, value * NUM_BINS is exactly the value / step of the bin index
+    initHistogram(&hist, NUM_BINS, num_channels, (float)NUM_BINS);
+    buildHistogram(&hist, image, num_pixels, 0, num_pixels, NULL);
+
+    const double step = 1.0 / (NUM_BINS);
+    const float eps = 1e-3;
+
+    // Thresholds to determine the mask
+    float low_threshold = num_pixels * percentile / 100.0f;
+    float high_threshold = num_pixels * (100.0f - percentile) / 100.0f;
+
+    // Range of values averaged in each channel
+    double low[NUM_CHANNELS];
+    double high[NUM_CHANNELS];
+
+    for (int c = 0; c < num_channels; c++)
+    {
+        const int idx_low = findHistogramBin(&hist, c, low_threshold);
+        const int idx_high = findIlluminantHigh(&hist, c, high_threshold);
+
+        low[c] = (3.0 / 2 * step) * idx_low - eps;
+        high[c] = (3.0 / 2 * step) * idx_high + eps;
+    }
 
-    return illuminants;
+    int num_threads = (num_pixels >= MIN_PARALLEL_WHITE) ? getNumThreads() : 1;
+    num_threads = (num_threads < 1) ? 1 : num_threads;
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        args[i].image = image;
+        args[i].num_pixels = num_pixels;
+        args[i].first = (int)((long)num_pixels * i / num_threads);
+        args[i].last = (int)((long)num_pixels * (i + 1) / num_threads);
+        args[i].num_channels = num_channels;
+        memcpy(args[i].low, low, sizeof(low));
+        memcpy(args[i].high, high, sizeof(high));
+    }
+
+    runParallel(illuminantWorker, args, sizeof(struct illuminant_args), num_threads);
+
+    // Get the L1 norm of the pixels within the range, the partial sums are combined in order so the result only
+    // depends on the number of threads
+    for (int c = 0; c < num_channels; c++)
+    {
+        float sum = 0;
+        int count = 0;
+
+        for (int i = 0; i < num_threads; i++)
+        {
+            sum += args[i].sum[c];
+            count += args[i].count[c];
+        }
+
+        // Special cases for count = 0 to avoid infinity
+        illuminants[c] = (count == 0) ? 0 : (sum / count);
+    }
+
+    return;
 }
 
 /**
@@ -0,0 +1,121 @@
+#include "../Inc/workspace.h"
+
+/**
+ * Rounds a size up to the workspace alignment
+ */
+static size_t alignUp(const size_t bytes)
+{
+    return (bytes + WORKSPACE_ALIGNMENT - 1) & ~(size_t)(WORKSPACE_ALIGNMENT - 1);
+}
+
+/**
+ * Allocates the memory of a workspace. This is the only allocation made, so do it once and reuse the workspace for every frame.
+ *
+ * @param   ws          The workspace to initialize
+ * @param   capacity    Number of bytes the workspace can hand out (see calcFusionWorkspace)
+ *
+ * @return              Returns 0 if successful, -1 otherwise.
+ */
+int initWorkspace(struct Workspace* ws, const size_t capacity)
+{
+    ws->capacity = alignUp(capacity);
+    ws->offset = 0;
+    ws->peak = 0;
+
+    // malloc only guarantees 16 byte alignment, so over allocate and align by hand (portable unlike aligned_alloc)
+    ws->memory = malloc(ws->capacity + WORKSPACE_ALIGNMENT);
+
+    if (ws->memory == NULL)
+    {
+        printf("Not enough memory for a %zu MB workspace.\n", capacity >> 20);
+        ws->base = NULL;
+        ws->capacity = 0;
+        return -1;
+    }
+
+    ws->base = (uint8_t*)alignUp((size_t)ws->memory);
+
+    return 0;
+}
+
+/**
+ * Releases the memory of a workspace
+ */
+void freeWorkspace(struct Workspace* ws)
+{
+    free(ws->memory);
+
+    ws->memory = NULL;
+    ws->base = NULL;
+    ws->capacity = 0;
+    ws->offset = 0;
+
+    return;
+}
+
+/**
+ * Returns the number of bytes a workspace needs per plane. A plane is sized for a 3 x 3 padded copy of the image
+ * plus alignment slack, so any block of k image sized planes fits in k of these.
+ *
+ * @param   num_row     Number of rows in the image
+ * @param   num_col     Number of columns in the image
+ *
+ * @return              Bytes per plane
+ */
+size_t calcPlaneBytes(const int num_row, const int num_col)
+{
+    return alignUp(sizeof(float) * (size_t)(num_row + 2) * (num_col + 2)) + WORKSPACE_ALIGNMENT;
+}
+
+/**
+ * Takes an aligned block of floats from the top of the workspace
+ *
+ * @param   ws          The workspace, or NULL to allocate with malloc
+ * @param   num_floats  Number of floats in the block
+ *
+ * @return              Pointer to the block. If the workspace is full the block falls back to malloc (with a warning)
+ */
+float* takePlanes(struct Workspace* ws, const size_t num_floats)
+{
+    const size_t bytes = alignUp(sizeof(float) * num_floats);
+
+    if (ws == NULL)
+        return malloc(bytes);
+
+    if (ws->offset + bytes > ws->capacity)
+    {
+        printf("Workspace is too small (%zu of %zu bytes used), allocating %zu bytes instead.\n", ws->offset, ws->capacity, bytes);
+        return malloc(bytes);
+    }
+
+    float* planes = (float*)&ws->base[ws->offset];
+
+    ws->offset += bytes;
+    ws->peak = (ws->offset > ws->peak) ? ws->offset : ws->peak;
+
+    return planes;
+}
+
+/**
+ * Releases a block taken with takePlanes. For a workspace this also releases every block taken after it.
+ *
+ * @param   ws          The workspace the block came from, or NULL
+ * @param   planes      The block to release
+ *
+ * @return              Returns the block to the workspace (or the heap)
+ */
+void releasePlanes(struct Workspace* ws, float* planes)
+{
+    uint8_t* block = (uint8_t*)planes;
+
+    // Blocks outside of the workspace came from malloc
+    if (ws == NULL || ws->base == NULL || block < ws->base || block >= ws->base + ws->capacity)
+    {
+        free(planes);
+        return;
+    }
+
+    ws->offset = (size_t)(block - ws->base);
+
+    return;
+}